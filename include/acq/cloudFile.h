@@ -0,0 +1,137 @@
+#ifndef ACQ_CLOUDFILE_H
+#define ACQ_CLOUDFILE_H
+
+#include "acq/decoratedCloud.h"
+#include "acq/mappedFile.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace acq {
+
+class CloudIndex;
+
+/** \addtogroup IO
+ *  @{
+ */
+
+/** \brief Binary point cloud file, loaded without parsing or copying.
+ *
+ * Layout (native byte order, checked on load):
+ *  - a 128 byte header with the counts and the byte offset of every section,
+ *  - the vertices as a column-major N x 3 double block,
+ *  - optionally the faces as a column-major M x K int block,
+ *  - optionally the normals as a column-major N x 3 double block,
+ *  - optionally the KD-tree over the vertices, as saved by \ref CloudIndex::save().
+ *
+ * Every section starts at a multiple of 64 bytes, so the blocks are cache line aligned
+ * in the page aligned mapping and are used in place through Eigen::Map.
+ * Write with \ref writeCloudFile(), convert meshes with the \c cloudConvert tool.
+ */
+class CloudFile {
+public:
+    //! Zero-copy view of the vertex block.
+    typedef Eigen::Map<CloudT const>   VerticesMapT;
+    //! Zero-copy view of the face block.
+    typedef Eigen::Map<FacesT const>   FacesMapT;
+    //! Zero-copy view of the normal block.
+    typedef Eigen::Map<NormalsT const> NormalsMapT;
+
+    /** \brief Constructor leaving the file closed. */
+    CloudFile();
+
+    /** \brief Constructor opening \p path, check \ref isOpen() for success. */
+    explicit CloudFile(std::string const& path);
+
+    /** \brief Maps \p path and validates its header and section bounds.
+     *
+     * \return False, if the file could not be mapped or is not a valid cloud file.
+     */
+    bool open(std::string const& path);
+
+    /** \brief True, if a valid file is mapped. */
+    bool isOpen() const { return _file.isOpen(); }
+
+    /** \brief Size of the mapped file in bytes. */
+    size_t getFileSize() const { return _file.size(); }
+
+    /** \brief Vertices in rows, valid while the file is open. */
+    VerticesMapT getVertices() const;
+
+    /** \brief Faces in rows, empty if the file has none. */
+    FacesMapT getFaces() const;
+    /** \brief Check, if the file has faces. */
+    bool hasFaces() const { return _nFaces != 0; }
+
+    /** \brief Normals in rows, empty if the file has none. */
+    NormalsMapT getNormals() const;
+    /** \brief Check, if the file has normals. */
+    bool hasNormals() const { return _normalsOffset != 0; }
+
+    /** \brief Check, if the file has a KD-tree section. */
+    bool hasIndex() const { return _indexOffset != 0; }
+
+    /** \brief Restores the stored KD-tree over the mapped vertices, without rebuilding it.
+     *
+     * \param[in] maxLeafs Leaf size the tree has to be built with.
+     *
+     * \return The index, valid while the file is open, or nullptr, if the file has no
+     *         index section, or it was saved for other points, leaf size or build.
+     */
+    std::unique_ptr<CloudIndex> loadIndex(int const maxLeafs = 10) const;
+
+    /** \brief Copies the sections once into \p cloud, replacing everything it held.
+     *
+     * Owning clouds need the copy, \ref getVertices(), \ref getFaces() and \ref getNormals()
+     * view the mapping without one.
+     */
+    void copyTo(DecoratedCloud &cloud) const;
+
+protected:
+    MappedFile _file;           //!< Mapping of the whole file.
+    int64_t    _nVertices;      //!< Vertex count.
+    int64_t    _nFaces;         //!< Face count.
+    int64_t    _faceSize;       //!< Vertices per face.
+    uint64_t   _verticesOffset; //!< Byte offset of the vertex block.
+    uint64_t   _facesOffset;    //!< Byte offset of the face block, 0 if none.
+    uint64_t   _normalsOffset;  //!< Byte offset of the normal block, 0 if none.
+    uint64_t   _indexOffset;    //!< Byte offset of the index section, 0 if none.
+    uint64_t   _indexSize;      //!< Size of the index section in bytes.
+}; //...class CloudFile
+
+/** \brief Writes \p vertices, \p faces, \p normals and \p indexData in the \ref CloudFile layout.
+ *
+ * \param[in] path      Output file.
+ * \param[in] vertices  N x 3 points.
+ * \param[in] faces     M x K vertex indices, may be empty.
+ * \param[in] normals   N x 3 normals, may be empty.
+ * \param[in] indexData \ref CloudIndex::save() of \p vertices, may be empty.
+ *
+ * \return False, if the file could not be written.
+ */
+bool
+writeCloudFile(
+    std::string const& path,
+    CloudT      const& vertices,
+    FacesT      const& faces     = FacesT(),
+    NormalsT    const& normals   = NormalsT(),
+    std::string const& indexData = std::string());
+
+/** \brief Writes the vertices, faces and normals of \p cloud, see \ref writeCloudFile().
+ *
+ * \param[in] path      Output file.
+ * \param[in] cloud     Cloud to store.
+ * \param[in] maxLeafs  Leaf size of a KD-tree built and stored along, 0 stores none.
+ */
+bool
+writeCloudFile(
+    std::string    const& path,
+    DecoratedCloud const& cloud,
+    int            const  maxLeafs = 0);
+
+/** @} (IO) */
+
+} //...ns acq
+
+#endif //ACQ_CLOUDFILE_H
@@ -0,0 +1,130 @@
+#ifndef ACQ_CLOUDINDEX_H
+#define ACQ_CLOUDINDEX_H
+
+#include "acq/hash.h"
+#include "acq/typedefs.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace acq {
+
+/** \brief KD-tree over the rows of a point cloud for nearest neighbour queries.
+ *
+ * The tree is built once on construction and refers to the points without copying them,
+ * so the cloud has to outlive the index and must not be modified while it is in use.
+ * Queries are const and can be issued from multiple threads at the same time.
+ */
+class CloudIndex {
+public:
+    //! Read-only, copy-free view of an N x 3 cloud.
+    typedef Eigen::Map<CloudT const> PointsT;
+
+    /** \brief Builds the tree over \p cloud.
+     *
+     * \param[in] cloud    N x 3 matrix containing points in rows.
+     * \param[in] maxLeafs FLANN parameter, maximum number of points in a leaf.
+     */
+    explicit CloudIndex(CloudT const& cloud, int const maxLeafs = 10);
+
+    /** \brief Builds the tree over memory owned by someone else (e.g. a mapped file). */
+    explicit CloudIndex(PointsT const& points, int const maxLeafs = 10);
+
+    ~CloudIndex();
+
+    /** \brief Serializes the tree, not the points, for \ref load().
+     *
+     * The header records the number of points, \p pointsHash and the leaf size,
+     * the tree itself is stored as laid out in memory, so it can only be loaded by the same build.
+     *
+     * \param[in] pointsHash \ref hashMatrix() of the indexed points.
+     *
+     * \return The serialized index, e.g. for a file or a \ref CloudFile index section.
+     */
+    std::string save(HashT const pointsHash) const;
+
+    /** \brief Restores a tree saved by \ref save() over the same points, without rebuilding it.
+     *
+     * \param[in] points     The points the tree was built over, not owned.
+     * \param[in] pointsHash \ref hashMatrix() of \p points.
+     * \param[in] maxLeafs   Leaf size the tree has to be built with.
+     * \param[in] data       Output of \ref save(), e.g. a mapped file.
+     * \param[in] size       Number of bytes at \p data.
+     *
+     * \return The index, or nullptr, if \p data is invalid or was saved for other points or leaf size.
+     */
+    static std::unique_ptr<CloudIndex> load(
+        PointsT const& points,
+        HashT   const  pointsHash,
+        int     const  maxLeafs,
+        char    const* data,
+        size_t  const  size);
+
+    /** \brief Finds the closest indexed point to \p query.
+     *
+     * \param[in ] query     3D query point.
+     * \param[out] pointId   Row-index of the closest point.
+     * \param[out] distSqr   Squared distance to the closest point.
+     *
+     * \return False, if the index is empty.
+     */
+    bool findNearest(Eigen::Vector3d const& query, size_t &pointId, double &distSqr) const;
+
+    /** \brief Finds the \p k closest points to \p query, sorted by distance.
+     *
+     * \return The number of neighbours found (less than \p k for tiny clouds).
+     */
+    size_t findNeighbours(
+        Eigen::Vector3d     const& query,
+        size_t              const  k,
+        std::vector<size_t>      & pointIds,
+        std::vector<double>      & distsSqr) const;
+
+    /** \brief Finds the points closer than \p radius to \p query, sorted by distance.
+     *
+     * \param[in ] query    3D query point.
+     * \param[in ] radius   Search radius, points at exactly this distance are excluded.
+     * \param[in ] maxCount Keep only the closest this many points, 0 keeps all. A cap also
+     *                      lets the search prune the tree, as in \ref findNeighbours().
+     * \param[out] pointIds Row-indices of the points found.
+     * \param[out] distsSqr Squared distances of the points found.
+     *
+     * \return The number of points found.
+     */
+    size_t findInRadius(
+        Eigen::Vector3d     const& query,
+        double              const  radius,
+        size_t              const  maxCount,
+        std::vector<size_t>      & pointIds,
+        std::vector<double>      & distsSqr) const;
+
+    /** \brief Coordinates of the indexed point in row \p pointId. */
+    Eigen::Vector3d getPoint(size_t const pointId) const { return _points.row(pointId).transpose(); }
+
+    /** \brief The indexed points. */
+    PointsT const& getPoints() const { return _points; }
+
+    /** \brief Number of indexed points. */
+    size_t size() const { return static_cast<size_t>(_points.rows()); }
+
+    /** \brief FLANN parameter the tree was built with. */
+    int getMaxLeafs() const { return _maxLeafs; }
+
+private:
+    CloudIndex(CloudIndex const&);            //!< Not copyable, the tree refers to this object.
+    CloudIndex& operator=(CloudIndex const&); //!< Not copyable, the tree refers to this object.
+
+    /** \brief Constructor creating the tree, built only if \p build is set, see \ref load(). */
+    CloudIndex(PointsT const& points, int const maxLeafs, bool const build);
+
+    struct Tree; //!< Hides nanoflann from the includers of this header.
+
+    PointsT               _points;   //!< The indexed points, not owned.
+    int                   _maxLeafs; //!< FLANN parameter.
+    std::unique_ptr<Tree> _tree;     //!< KD-tree over \ref _points.
+}; //...class CloudIndex
+
+} //...ns acq
+
+#endif //ACQ_CLOUDINDEX_H
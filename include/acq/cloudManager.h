@@ -6,6 +6,9 @@
 #define ACQ_CLOUDMANAGER_H
 
 #include "acq/decoratedCloud.h"
+#include "acq/meshIO.h"
+#include <functional>
+#include <string>
 #include <vector>
 
 namespace acq {
@@ -25,6 +28,36 @@ public:
     /** \brief Get cloud with specific index (const version). */
     DecoratedCloud const& getCloud(int index) const;
 
+    /** \brief Number of clouds, including empty ones. */
+    int getCloudCount() const { return static_cast<int>(_clouds.size()); }
+
+    /** \brief Grows the list to at least \p count clouds with empty ones, so slots stay put while filled concurrently. */
+    void reserveClouds(int const count);
+
+    //! Called with the position of a path in the list and its statistics, once it was read.
+    typedef std::function<void(size_t pathId, ReadStats const& stats)> LoadCallbackT;
+
+    /** \brief Reads OFF, PLY or cloud files concurrently, each straight into its final slot.
+     *
+     * The file at \p paths[i] ends up at index \p firstIndex + i, the list grows to
+     * fit them before any file is read, so no cloud is copied. Files are read in
+     * parallel, large OFF files are additionally split between the remaining threads.
+     *
+     * \param[in]  paths      OFF, PLY or cloud files, see \ref readMesh().
+     * \param[in]  firstIndex Slot of the first file, later slots are overwritten.
+     * \param[out] stats      Optional per-file size and parse time, in the order of \p paths.
+     * \param[in]  onLoaded   Optional progress callback, called in completion order, one call at a time.
+     * \param[in]  nThreads   Number of threads to use, 0 uses all cores.
+     *
+     * \return Number of files that could not be read, their slots are left empty.
+     */
+    size_t loadClouds(
+        std::vector<std::string> const& paths,
+        int                      const  firstIndex,
+        std::vector<ReadStats>        * stats    = nullptr,
+        LoadCallbackT            const& onLoaded = LoadCallbackT(),
+        unsigned                 const  nThreads = 0);
+
 protected:
     std::vector<DecoratedCloud> _clouds; //!< List of clouds possibly with normals and faces.
 
@@ -5,15 +5,34 @@
 #ifndef ACQ_DECORATEDCLOUD_H
 #define ACQ_DECORATEDCLOUD_H
 
+#include "acq/normalEstimation.h"
 #include "acq/typedefs.h"
 
+#include <cmath>
+#include <limits>
+#include <vector>
+
 namespace acq {
 
-/** \brief Simple class to keep track of points normals and faces for a point cloud or mesh. */
+/** \brief Simple class to keep track of points normals and faces for a point cloud or mesh.
+ *
+ * Normals and curvatures are derived from the points, and the cloud keeps track of
+ * when they go stale: a rigid \ref transform() rotates the normals along and keeps
+ * the curvatures, while \ref setVertices() marks the points it moves dirty, so
+ * \ref updateNormals() only re-estimates the points whose neighbourhoods they left or
+ * entered. Meshes can take their normals from the faces instead, see
+ * \ref estimateNormalsFromFaces(). Edits through the non-const \ref getVertices() are not
+ * seen, call \ref markDirty() for the points before changing them.
+ */
 class DecoratedCloud {
 public:
+    //! Neighbours to estimate with, if the normals were not estimated by \ref estimateNormals().
+    static int const DEFAULT_NORMAL_NEIGHBOURS = 10;
+    //! Neighbours to average the local point spacing over, see \ref estimateSpacing().
+    static int const DEFAULT_SPACING_NEIGHBOURS = 6;
+
     /** \brief Default constructor leaving fields empty. */
-    explicit DecoratedCloud() {}
+    explicit DecoratedCloud();
 
     /** \brief Constructor filling point information only. */
     explicit DecoratedCloud(CloudT const& vertices);
@@ -27,14 +46,28 @@ public:
     /** \brief Constructor filling point, face and normal information. */
     explicit DecoratedCloud(CloudT const& vertices, FacesT const& faces, NormalsT const& normals);
 
-    /** \brief Getter for point cloud. */
+    /** \brief Getter for point cloud, e.g. to read a file in place. */
+    CloudT      & getVertices() { return _vertices; }
+    /** \brief Getter for point cloud (const version). */
     CloudT const& getVertices() const { return _vertices; }
-    /** \brief Setter for point cloud. */
-    void setVertices(CloudT const& vertices) { _vertices = vertices; }
+    /** \brief Setter for point cloud, a non-rigid edit.
+     *
+     * With the same number of points, the points that moved get their derived attributes
+     * marked dirty, see \ref updateNormals(). Otherwise normals and curvatures are dropped.
+     * The point spacing is dropped either way.
+     */
+    void setVertices(CloudT const& vertices);
+    /** \brief Moves the points rigidly, rotating the normals along, curvatures and spacing stay valid.
+     *
+     * \param[in] pose Rigid transformation applied to the points, e.g. an ICP result.
+     */
+    void transform(PoseT const& pose);
     /** \brief Check, if any points stored. */
     bool hasVertices() const { return static_cast<bool>(_vertices.size()); }
 
-    /** \brief Getter for face indices list. */
+    /** \brief Getter for face indices list, e.g. to read a file in place. */
+    FacesT      & getFaces() { return _faces; }
+    /** \brief Getter for face indices list (const version). */
     FacesT const& getFaces() const { return _faces; }
     /** \brief Setter for face indices list. */
     void setFaces(FacesT const& faces) { _faces = faces; }
@@ -45,15 +78,99 @@ public:
     NormalsT      & getNormals() { return _normals; }
     /** \brief Getter for normals (const version). */
     NormalsT const& getNormals() const { return _normals; }
-    /** \brief Setter for normals. */
-    void setNormals(NormalsT const& normals) { _normals = normals; }
+    /** \brief Setter for normals, valid for all points, curvatures are dropped. */
+    void setNormals(NormalsT const& normals);
     /** \brief Check, if any normals stored. */
     bool hasNormals() const { return static_cast<bool>(_normals.size()); }
 
+    /** \brief Per-vertex surface variation, see \ref calculateCloudNormals(), empty if unknown. */
+    Eigen::VectorXd const& getCurvatures() const { return _curvatures; }
+    /** \brief Check, if curvatures stored. */
+    bool hasCurvatures() const { return static_cast<bool>(_curvatures.size()); }
+
+    /** \brief Per-vertex local point spacing, see \ref calculatePointSpacing(), empty if unknown. */
+    Eigen::VectorXd const& getSpacing() const { return _spacing; }
+    /** \brief Check, if the point spacing is stored. */
+    bool hasSpacing() const { return static_cast<bool>(_spacing.size()); }
+    /** \brief Mean of \ref getSpacing(), 0 if unknown. */
+    double getAverageSpacing() const { return hasSpacing() ? _spacing.mean() : 0.; }
+    /** \brief Estimates the local point spacing once, e.g. on read, to size neighbourhoods with.
+     *
+     * \param[in] k        Neighbours to average over.
+     * \param[in] nThreads Number of threads to use, 0 means \ref defaultThreadCount().
+     */
+    void estimateSpacing(
+        int      const k        = DEFAULT_SPACING_NEIGHBOURS,
+        unsigned const nThreads = 0);
+
+    /** \brief Estimates normals and curvatures of all points from \p k neighbours each.
+     *
+     * \param[in] k        How many neighbours to use (Typically: 5..15), kept for \ref updateNormals().
+     * \param[in] maxDist  Maximum distance between vertex and neighbour, kept for \ref updateNormals().
+     * \param[in] nThreads Number of threads to use, 0 means \ref defaultThreadCount().
+     */
+    void estimateNormals(
+        int      const k,
+        float    const maxDist  = std::sqrt(std::numeric_limits<float>::max()) - 1.f,
+        unsigned const nThreads = 0);
+
+    /** \brief Computes the normals from the faces, several times cheaper than \ref estimateNormals().
+     *
+     * See \ref calculateCloudNormalsFromFaces(). The orientation is repaired along the face edges
+     * only if the faces are wound inconsistently. Curvatures are dropped.
+     *
+     * \param[in] weighting Weights of the face normals, kept for \ref updateNormals().
+     * \param[in] nThreads  Number of threads to use, 0 means \ref defaultThreadCount().
+     *
+     * \return Number of normals flipped by the repair.
+     */
+    int estimateNormalsFromFaces(
+        FaceWeighting const weighting = FACE_WEIGHT_AREA,
+        unsigned      const nThreads  = 0);
+
+    /** \brief Re-estimates the normals and curvatures of the dirty points and of the points
+     *         whose neighbourhoods they were or are in.
+     *
+     * A point is re-estimated, if the position a dirty point was marked at or its current one is
+     * within the radius of the point's neighbourhood, so the result matches \ref estimateNormals()
+     * on the whole cloud up to orientation, and up to the choice between equally far neighbours.
+     * The radii are kept from the last estimate, and found once on the current points for normals
+     * given otherwise.
+     * Uses the neighbourhood size of \ref estimateNormals(), or \ref DEFAULT_NORMAL_NEIGHBOURS.
+     * Normals from \ref estimateNormalsFromFaces() are recomputed from the faces as a whole.
+     * Re-estimated normals keep the orientation they had. Everything is re-estimated,
+     * if most points are dirty.
+     *
+     * \param[in] nThreads Number of threads to use, 0 means \ref defaultThreadCount().
+     *
+     * \return Number of points re-estimated.
+     */
+    size_t updateNormals(unsigned const nThreads = 0);
+
+    /** \brief Marks the derived attributes of point \p pointId stale, e.g. before editing it in place.
+     *
+     * The first call since the last update keeps the position of the point, so the points near
+     * it are re-estimated by \ref updateNormals() as well, see there.
+     */
+    void markDirty(size_t const pointId);
+    /** \brief Check, if the derived attributes of point \p pointId are stale. */
+    bool isDirty(size_t const pointId) const { return !_dirty.empty() && _dirty[pointId]; }
+    /** \brief Number of points with stale derived attributes. */
+    size_t getDirtyCount() const;
+
 protected:
-    CloudT   _vertices; //!< Point cloud, N x 3 matrix where N is the number of points.
-    FacesT   _faces;    //!< Faces stored as rows of vertex indices (referring to \ref _vertices).
-    NormalsT _normals;  //!< Per-vertex normals, associated with \ref _vertices by row ID.
+    CloudT                     _vertices;         //!< Point cloud, N x 3 matrix where N is the number of points.
+    FacesT                     _faces;            //!< Faces stored as rows of vertex indices (referring to \ref _vertices).
+    NormalsT                   _normals;          //!< Per-vertex normals, associated with \ref _vertices by row ID.
+    Eigen::VectorXd            _curvatures;       //!< Per-vertex surface variation, empty if unknown.
+    Eigen::VectorXd            _spacing;          //!< Per-vertex mean distance to the nearest points, empty if unknown.
+    std::vector<unsigned char> _dirty;            //!< Per-vertex stale flags of \ref _normals, empty if none stale.
+    CloudT                     _dirtyFrom;        //!< Positions of the dirty points when marked, rows of the others unused.
+    Eigen::VectorXd            _normalRadiiSqr;   //!< Per-vertex squared radius of the neighbourhood of \ref _normals, empty if unknown.
+    int                        _normalNeighbours; //!< Neighbourhood size of \ref _normals, 0 if not estimated here.
+    float                      _normalMaxDist;    //!< Neighbour distance limit of \ref _normals.
+    bool                       _normalsFromFaces; //!< Whether \ref _normals were computed from \ref _faces.
+    FaceWeighting              _faceWeighting;    //!< Face normal weights of \ref _normals, if from faces.
 
 public:
     // See https://eigen.tuxfamily.org/dox-devel/group__TopicStructHavingEigenMembers.html
@@ -0,0 +1,93 @@
+#ifndef ACQ_HALFEDGES_H
+#define ACQ_HALFEDGES_H
+
+#include "acq/neighbours.h"
+#include "acq/typedefs.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace acq {
+
+/** \addtogroup NormalEstimation
+ *  @{
+ */
+
+/** \brief Half-edge connectivity of a mesh with faces of equal size.
+ *
+ * Half-edge h is corner h % faceSize of face h / faceSize, running from that corner to the
+ * next one, so faces, next and previous half-edges are implicit and only the start vertices
+ * and the twins are stored. Twins are found by radix sorting the directed edges, see
+ * \ref parallelRadixSort(). A half-edge without twin is a boundary, so are faces wound
+ * against their neighbours.
+ */
+class HalfEdges {
+public:
+    //! Vertex and half-edge index type.
+    typedef Neighbours::IdT IdT;
+
+    /** \brief Constructor leaving the structure empty. */
+    HalfEdges();
+
+    /** \brief Builds the half-edges of \p faces.
+     *
+     * \param[in] faces    Vertex indices of a face in each row, at least 3 columns.
+     * \param[in] nPoints  Number of vertices, at least one more than the largest index, 0 to use that.
+     * \param[in] nThreads Number of threads to use, 0 means \ref defaultThreadCount().
+     *
+     * \return The half-edges, twins and boundary flags.
+     */
+    static HalfEdges fromFaces(
+        FacesT   const& faces,
+        size_t   const  nPoints  = 0,
+        unsigned const  nThreads = 0);
+
+    /** \brief Number of half-edges, face count times face size. */
+    size_t size() const { return _starts.size(); }
+
+    /** \brief Number of vertices. */
+    size_t getVertexCount() const { return _outgoing.size(); }
+
+    /** \brief Face of half-edge \p h, a row of the faces built from. */
+    IdT getFace(IdT const h) const { return h / _faceSize; }
+
+    /** \brief Next half-edge around the face of \p h. */
+    IdT getNext(IdT const h) const { return h % _faceSize == _faceSize - 1 ? h - _faceSize + 1 : h + 1; }
+
+    /** \brief Previous half-edge around the face of \p h. */
+    IdT getPrev(IdT const h) const { return h % _faceSize ? h - 1 : h + _faceSize - 1; }
+
+    /** \brief Opposite half-edge of the neighbouring face, -1 on the boundary. */
+    IdT getTwin(IdT const h) const { return _twins[h]; }
+
+    /** \brief Vertex \p h starts at. */
+    IdT getStart(IdT const h) const { return _starts[h]; }
+
+    /** \brief Vertex \p h ends at. */
+    IdT getEnd(IdT const h) const { return _starts[getNext(h)]; }
+
+    /** \brief Check, if \p h has no twin. */
+    bool isBoundary(IdT const h) const { return _twins[h] < 0; }
+
+    /** \brief A half-edge leaving \p vertexId, a boundary one if there is any, -1 for vertices in no face. */
+    IdT getOutgoing(size_t const vertexId) const { return _outgoing[vertexId]; }
+
+    /** \brief Check, if a boundary half-edge leaves \p vertexId. */
+    bool isBoundaryVertex(size_t const vertexId) const { return _boundary[vertexId] != 0; }
+
+    /** \brief Number of half-edges without twin. */
+    size_t getBoundaryCount() const;
+
+protected:
+    IdT                        _faceSize; //!< Corners per face.
+    std::vector<IdT>           _starts;   //!< Start vertex of each half-edge.
+    std::vector<IdT>           _twins;    //!< Opposite half-edge of each half-edge, -1 if none.
+    std::vector<IdT>           _outgoing; //!< A half-edge leaving each vertex, -1 if none.
+    std::vector<unsigned char> _boundary; //!< Per-vertex flag, set if a boundary half-edge leaves it.
+}; //...class HalfEdges
+
+/** @} (NormalEstimation) */
+
+} //...ns acq
+
+#endif //ACQ_HALFEDGES_H
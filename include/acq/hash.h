@@ -0,0 +1,64 @@
+#ifndef ACQ_HASH_H
+#define ACQ_HASH_H
+
+#include "Eigen/Core"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace acq {
+
+/** \addtogroup Hashing
+ *  @{
+ */
+
+//! 64-bit content hash.
+typedef uint64_t HashT;
+
+//! Starting value of a 64-bit FNV-1a hash, pass it as seed to start a new hash.
+HashT const FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+/** \brief Extends the 64-bit FNV-1a hash \p seed by \p size bytes at \p data.
+ *
+ * Chaining calls hashes the concatenation of their inputs, so composite keys
+ * are built by passing each result as the seed of the next call.
+ *
+ * \param[in] data Bytes to hash.
+ * \param[in] size Number of bytes.
+ * \param[in] seed Hash of the preceding data, or \ref FNV_OFFSET_BASIS.
+ *
+ * \return The extended hash.
+ */
+HashT
+hashBytes(
+    void   const* data,
+    size_t const  size,
+    HashT  const  seed = FNV_OFFSET_BASIS);
+
+/** \brief Extends \p seed by the bytes of a trivially copyable \p value.
+ *
+ * \tparam _T Concept: trivially copyable without padding, e.g. int or double.
+ */
+template <typename _T>
+HashT
+hashValue(
+    _T    const& value,
+    HashT const  seed = FNV_OFFSET_BASIS);
+
+/** \brief Extends \p seed by the dimensions and the column-major coefficients of \p matrix.
+ *
+ * The hash does not depend on the storage, e.g. a matrix and a Map of the same data agree.
+ *
+ * \tparam _Derived Concept: Eigen dense expression of a padding-free scalar type.
+ */
+template <typename _Derived>
+HashT
+hashMatrix(
+    Eigen::DenseBase<_Derived> const& matrix,
+    HashT                      const  seed = FNV_OFFSET_BASIS);
+
+/** @} (Hashing) */
+
+} //...ns acq
+
+#endif //ACQ_HASH_H
@@ -0,0 +1,185 @@
+#ifndef ACQ_ICP_H
+#define ACQ_ICP_H
+
+#include "acq/typedefs.h"
+
+namespace acq {
+
+/** \addtogroup Registration
+ *  @{
+ */
+
+/** \brief Settings of a pairwise point-to-point ICP run. */
+struct IcpParams {
+    int    maxIterations;  //!< Hard cap on the number of iterations.
+    int    stepSize;       //!< Only every stepSize-th source point is matched.
+    double maxDistSqr;     //!< Correspondences further apart (squared) are rejected.
+    double minError;       //!< Converged, once the mean squared distance drops below this.
+    double minImprovement; //!< Converged, once an iteration improves the error less than this.
+
+    IcpParams()
+        : maxIterations(250), stepSize(1), maxDistSqr(0.01),
+          minError(0.000018), minImprovement(0.)
+    {}
+}; //...struct IcpParams
+
+/** \brief Outcome of a pairwise ICP run. */
+struct IcpResult {
+    PoseT  pose;            //!< Transforms source points onto the target.
+    double error;           //!< Mean squared distance of the correspondences at \ref pose.
+    int    iterations;      //!< Number of iterations run.
+    size_t correspondences; //!< Number of accepted correspondences at \ref pose.
+
+    IcpResult() : pose(PoseT::Identity()), error(0.), iterations(0), correspondences(0) {}
+
+public:
+    // See https://eigen.tuxfamily.org/dox-devel/group__TopicStructHavingEigenMembers.html
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+}; //...struct IcpResult
+
+/** \brief Correspondences between two scans at a fixed relative pose. */
+struct CorrespondenceStats {
+    size_t       sampled;     //!< Number of source points tested.
+    size_t       matched;     //!< Number of source points with a target point closer than the threshold.
+    double       error;       //!< Mean squared distance of the matched points.
+    InformationT information; //!< Sum of J^T J over matched points, J = [ -[s]x  I ], s in source coordinates.
+
+    CorrespondenceStats() : sampled(0), matched(0), error(0.), information(InformationT::Zero()) {}
+
+    /** \brief Fraction of sampled source points that found a partner. */
+    double getOverlap() const { return sampled ? static_cast<double>(matched) / sampled : 0.; }
+
+public:
+    // See https://eigen.tuxfamily.org/dox-devel/group__TopicStructHavingEigenMembers.html
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+}; //...struct CorrespondenceStats
+
+/** \brief Running sums over point correspondences p -> q, enough to solve for the rigid
+ *         motion aligning them (Kabsch) without storing the pairs.
+ *
+ * Sums of disjoint sets of pairs add up, so the correspondences can be gathered in any
+ * number of pieces, e.g. per thread or per tile of a cloud that does not fit into memory.
+ */
+struct CorrespondenceSums {
+    Eigen::Vector3d sumP;       //!< Sum of the source points.
+    Eigen::Vector3d sumQ;       //!< Sum of the target points.
+    Eigen::Matrix3d sumPQ;      //!< Sum of p * q^T.
+    double          sumDistSqr; //!< Sum of the squared distances.
+    size_t          count;      //!< Number of pairs.
+
+    CorrespondenceSums()
+        : sumP(Eigen::Vector3d::Zero()), sumQ(Eigen::Vector3d::Zero()),
+          sumPQ(Eigen::Matrix3d::Zero()), sumDistSqr(0.), count(0)
+    {}
+
+    /** \brief Adds the pair \p p -> \p q, \p distSqr apart. */
+    void add(Eigen::Vector3d const& p, Eigen::Vector3d const& q, double const distSqr) {
+        sumP       += p;
+        sumQ       += q;
+        sumPQ      += p * q.transpose();
+        sumDistSqr += distSqr;
+        ++count;
+    }
+
+    /** \brief Adds the pairs summed in \p other. */
+    CorrespondenceSums& operator+=(CorrespondenceSums const& other);
+
+    /** \brief Mean squared distance of the pairs. */
+    double getError() const { return count ? sumDistSqr / count : 0.; }
+
+    /** \brief The rotation and translation best moving the source points onto the target points. */
+    PoseT solve() const;
+}; //...struct CorrespondenceSums
+
+/** \brief Runs point-to-point ICP iterations on the correspondences gathered by \p match.
+ *
+ * Every iteration calls \p match with the current pose, solves for the increment from the
+ * returned sums and stops on convergence, divergence or after \p params.maxIterations.
+ * Separates the iteration logic from how the points are stored, see \ref alignPointToPoint().
+ *
+ * \tparam _MatchT Concept: <tt>CorrespondenceSums(PoseT const& pose)</tt>, pairing the source
+ *                 points moved by pose with their nearest target points.
+ *
+ * \param[in] initialPose Starting guess transforming the source onto the target.
+ * \param[in] params      Iteration settings, \p match applies the sampling and rejection ones.
+ * \param[in] match       Gathers the correspondences at a pose.
+ *
+ * \return The best pose found, and its residual.
+ */
+template <typename _MatchT>
+IcpResult
+iterateIcp(
+    PoseT     const& initialPose,
+    IcpParams const& params,
+    _MatchT   const& match);
+
+/** \brief Rigidly aligns \p source to \p target by point-to-point ICP.
+ *
+ * The target is only queried, never rebuilt, so the same index can be shared
+ * by concurrent runs against the same target.
+ *
+ * \tparam _SourceT Concept: acq::CloudT, an Eigen::Map of one, or an acq::QuantizedCloud.
+ * \tparam _TargetT Concept: acq::CloudIndex or acq::QuantizedIndex, i.e. provides
+ *                  <tt>bool findNearest(Eigen::Vector3d const&, size_t&, double&) const</tt>
+ *                  and <tt>Eigen::Vector3d getPoint(size_t) const</tt>.
+ *
+ * \param[in] source      N x 3 points to move.
+ * \param[in] target      Nearest neighbour index of the fixed points.
+ * \param[in] initialPose Starting guess transforming \p source onto \p target.
+ * \param[in] params      Iteration and rejection settings.
+ *
+ * \return The best pose found, and its residual.
+ */
+template <typename _SourceT, typename _TargetT>
+IcpResult
+alignPointToPoint(
+    _SourceT  const& source,
+    _TargetT  const& target,
+    PoseT     const& initialPose,
+    IcpParams const& params);
+
+/** \brief Matches \p source at \p pose to \p target and measures how well the scans agree.
+ *
+ * The information matrix approximates the inverse covariance of the relative pose
+ * estimated from these correspondences, see \ref PoseGraph.
+ *
+ * \tparam _SourceT Concept: acq::CloudT.
+ * \tparam _TargetT Concept: acq::CloudIndex, see \ref alignPointToPoint().
+ *
+ * \param[in] source N x 3 points to match.
+ * \param[in] target Nearest neighbour index of the fixed points.
+ * \param[in] pose   Transforms \p source onto \p target.
+ * \param[in] params Sampling step and rejection distance, iteration settings are unused.
+ *
+ * \return Overlap, residual and information of the correspondences.
+ */
+template <typename _SourceT, typename _TargetT>
+CorrespondenceStats
+measureCorrespondences(
+    _SourceT  const& source,
+    _TargetT  const& target,
+    PoseT     const& pose,
+    IcpParams const& params);
+
+/** \brief Inverse of the rigid transformation \p pose. */
+PoseT
+invertPose(
+    PoseT const& pose);
+
+/** \brief Applies \p pose to every row of \p cloud.
+ *
+ * \param[in] cloud N x 3 points in rows.
+ * \param[in] pose  Rigid transformation to apply.
+ *
+ * \return The transformed N x 3 points.
+ */
+CloudT
+transformCloud(
+    CloudT const& cloud,
+    PoseT  const& pose);
+
+/** @} (Registration) */
+
+} //...ns acq
+
+#endif //ACQ_ICP_H
@@ -0,0 +1,34 @@
+#ifndef ACQ_HASH_HPP
+#define ACQ_HASH_HPP
+
+#include "acq/hash.h"
+
+namespace acq {
+
+template <typename _T>
+HashT
+hashValue(
+    _T    const& value,
+    HashT const  seed
+) {
+    return hashBytes(&value, sizeof(_T), seed);
+} //...hashValue()
+
+template <typename _Derived>
+HashT
+hashMatrix(
+    Eigen::DenseBase<_Derived> const& matrix,
+    HashT                      const  seed
+) {
+    HashT hash = hashValue(static_cast<int64_t>(matrix.rows()), seed);
+    hash       = hashValue(static_cast<int64_t>(matrix.cols()), hash);
+
+    for (Eigen::Index col = 0; col != matrix.cols(); ++col)
+        for (Eigen::Index row = 0; row != matrix.rows(); ++row)
+            hash = hashValue(static_cast<typename _Derived::Scalar>(matrix(row, col)), hash);
+    return hash;
+} //...hashMatrix()
+
+} //...ns acq
+
+#endif //ACQ_HASH_HPP
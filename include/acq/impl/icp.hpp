@@ -0,0 +1,130 @@
+#ifndef ACQ_ICP_HPP
+#define ACQ_ICP_HPP
+
+#include "acq/icp.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace acq {
+
+template <typename _MatchT>
+IcpResult
+iterateIcp(
+    PoseT     const& initialPose,
+    IcpParams const& params,
+    _MatchT   const& match
+) {
+    IcpResult best;
+    best.pose  = initialPose;
+    best.error = std::numeric_limits<double>::max();
+
+    PoseT pose = initialPose;
+    for (int iteration = 0; iteration < params.maxIterations; ++iteration) {
+        CorrespondenceSums const sums = match(pose);
+
+        // Nothing to align to
+        if (sums.count < 3)
+            break;
+
+        double const error = sums.getError();
+        ++best.iterations;
+
+        // Stop, if getting worse, keeping the previous pose
+        if (error > best.error - params.minImprovement) {
+            if (error < best.error) {
+                best.pose            = pose;
+                best.error           = error;
+                best.correspondences = sums.count;
+            }
+            break;
+        }
+        best.pose            = pose;
+        best.error           = error;
+        best.correspondences = sums.count;
+        if (error < params.minError)
+            break;
+
+        // Compose increment with current pose
+        pose = sums.solve() * pose;
+    } //...for iterations
+
+    return best;
+} //...iterateIcp()
+
+template <typename _SourceT, typename _TargetT>
+IcpResult
+alignPointToPoint(
+    _SourceT  const& source, // N x 3
+    _TargetT  const& target,
+    PoseT     const& initialPose,
+    IcpParams const& params
+) {
+    size_t const stepSize = static_cast<size_t>(std::max(params.stepSize, 1));
+
+    return iterateIcp(initialPose, params, [&](PoseT const& pose) {
+        Eigen::Matrix3d const R = pose.topLeftCorner<3, 3>();
+        Eigen::Vector3d const t = pose.topRightCorner<3, 1>();
+
+        // Accumulate correspondence statistics instead of storing the matched pairs
+        CorrespondenceSums sums;
+        for (size_t row = 0; row < static_cast<size_t>(source.rows()); row += stepSize) {
+            // Source point at current pose
+            Eigen::Vector3d const p = R * source.row(row).transpose() + t;
+
+            size_t nearestId;
+            double distSqr;
+            if (!target.findNearest(p, nearestId, distSqr) || distSqr >= params.maxDistSqr)
+                continue;
+
+            sums.add(p, target.getPoint(nearestId), distSqr);
+        } //...for sampled source points
+        return sums;
+    });
+} //...alignPointToPoint()
+
+template <typename _SourceT, typename _TargetT>
+CorrespondenceStats
+measureCorrespondences(
+    _SourceT  const& source, // N x 3
+    _TargetT  const& target,
+    PoseT     const& pose,
+    IcpParams const& params
+) {
+    size_t const stepSize = static_cast<size_t>(std::max(params.stepSize, 1));
+
+    Eigen::Matrix3d const R = pose.topLeftCorner<3, 3>();
+    Eigen::Vector3d const t = pose.topRightCorner<3, 1>();
+
+    CorrespondenceStats stats;
+    double sumDistSqr = 0.;
+    for (size_t row = 0; row < static_cast<size_t>(source.rows()); row += stepSize) {
+        ++stats.sampled;
+        Eigen::Vector3d const s = source.row(row).transpose();
+        Eigen::Vector3d const p = R * s + t;
+
+        size_t nearestId;
+        double distSqr;
+        if (!target.findNearest(p, nearestId, distSqr) || distSqr >= params.maxDistSqr)
+            continue;
+
+        // Jacobian of the residual w.r.t. a small motion [rotation, translation] applied in the
+        // source frame, pose * exp(xi), as the pose graph perturbs its edge errors. The residual
+        // Jacobian is R * J, and R drops out of J^T R^T R J.
+        Eigen::Matrix<double, 3, 6> J;
+        J << 0.  ,  s(2), -s(1), 1., 0., 0.,
+            -s(2),  0.  ,  s(0), 0., 1., 0.,
+             s(1), -s(0),  0.  , 0., 0., 1.;
+        stats.information += J.transpose() * J;
+        sumDistSqr        += distSqr;
+        ++stats.matched;
+    } //...for sampled source points
+
+    if (stats.matched)
+        stats.error = sumDistSqr / stats.matched;
+    return stats;
+} //...measureCorrespondences()
+
+} //...ns acq
+
+#endif //ACQ_ICP_HPP
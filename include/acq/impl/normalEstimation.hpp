@@ -7,16 +7,20 @@
 
 #include "acq/normalEstimation.h"
 
+#include "acq/impl/parallel.hpp"
 #include "Eigen/Eigenvalues"        // SelfAdjointEigenSolver
 
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
+#include <utility>
 
 namespace acq {
 
-template <typename _NeighbourIdListT>
+template <typename _CloudT, typename _NeighbourIdListT>
 Eigen::Matrix <typename CloudT::Scalar, 3, 1>
 calculatePointNormal(
-    CloudT            const& cloud, // N x 3
+    _CloudT           const& cloud, // N x 3
     int               const  pointIndex,
     _NeighbourIdListT const& neighbourIndices
 ) {
@@ -72,52 +76,49 @@ calculatePointNormal(
 template <typename _FacesT>
 NeighboursT
 calculateCloudNeighboursFromFaces(
-    _FacesT   const& faces
+    _FacesT   const& faces,
+    unsigned  const  nThreads
 ) {
-    // calculate neighbours from faces' edge lists
-    NeighboursT neighbours;
-    // for each face
-    for (int row = 0; row != faces.rows(); ++row) {
+    typedef Neighbours::IdT IdT;
+    if (!faces.size())
+        return Neighbours();
+    if (faces.minCoeff() < 0) {
+        std::cerr << "[calculateCloudNeighboursFromFaces] Negative vertex index " << faces.minCoeff() << "\n";
+        throw new std::runtime_error("Negative face vertex index");
+    }
+    size_t const nPoints  = static_cast<size_t>(faces.maxCoeff()) + 1;
+    size_t const nCorners = static_cast<size_t>(faces.cols());
+
+    // Both directions of each face edge into a flat array:
+    // vertex => next vertex, next vertex => vertex
+    std::vector<uint64_t> keys(2 * faces.size());
+    parallelFor(static_cast<size_t>(faces.rows()), [&](size_t const row) {
         // for each face vertex
-        for (int vxId = 0; vxId != faces.cols(); ++vxId) {
-            // id of "incoming" edge's start vertex
-            int const leftNeighbourId =
-                (vxId != 0) ? vxId - 1
-                           : faces.cols() - 1;
+        for (size_t vxId = 0; vxId != nCorners; ++vxId) {
             // id of "outgoing" edge's end vertex
-            int const rightNeighbourId =
-                (vxId < faces.cols() - 1) ? vxId + 1
-                                         : 0;
-            // store vertex has left neighbour as neighbour
-            neighbours[faces(row, vxId)].insert(
-                faces(row, leftNeighbourId)
-            );
-            // store left neighbour has vertex as neighbour
-            neighbours[faces(row, leftNeighbourId)].insert(
-                faces(row, vxId)
-            );
-            // store vertex has right neighbour as neighbour
-            neighbours[faces(row, vxId)].insert(
-                faces(row, rightNeighbourId)
-            );
-            // store right neighbour has vertex as neighbour
-            neighbours[faces(row, rightNeighbourId)].insert(
-                faces(row, vxId)
-            );
+            size_t const rightNeighbourId = (vxId < nCorners - 1) ? vxId + 1 : 0;
+            IdT const from = static_cast<IdT>(faces(row, vxId));
+            IdT const to   = static_cast<IdT>(faces(row, rightNeighbourId));
+            keys[2 * (row * nCorners + vxId)]     = Neighbours::edgeKey(from, to, nPoints);
+            keys[2 * (row * nCorners + vxId) + 1] = Neighbours::edgeKey(to, from, nPoints);
         } //...for each vertex in face
-    } //...for each face
+    }, 4096, nThreads);
 
-    return neighbours;
-} //...orientCloudNormalsFromFaces()
+    // edges shared by two faces are merged
+    return Neighbours::fromEdgeKeys(std::move(keys), nPoints, nThreads);
+} //...calculateCloudNeighboursFromFaces()
 
 template <typename _NormalsT, typename _FacesT>
 int orientCloudNormalsFromFaces(
     _FacesT  const& faces,
-   _NormalsT      & normals
+   _NormalsT      & normals,
+    unsigned const  nThreads
 ) {
     return orientCloudNormals(
-        calculateCloudNeighboursFromFaces(faces),
-        normals
+        calculateCloudNeighboursFromFaces(faces, nThreads),
+        normals,
+        nullptr,
+        nThreads
     );
 } //...orientCloudNormalsFromFaces()
 
@@ -0,0 +1,41 @@
+#ifndef ACQ_OVERLAP_HPP
+#define ACQ_OVERLAP_HPP
+
+#include "acq/overlap.h"
+
+#include <algorithm>
+
+namespace acq {
+
+template <typename _SourceT, typename _TargetT>
+double
+estimateOverlap(
+    _SourceT      const& source, // N x 3
+    _TargetT      const& target,
+    PoseT         const& pose,
+    OverlapParams const& params
+) {
+    size_t const nPoints = static_cast<size_t>(source.rows());
+    if (!nPoints)
+        return 0.;
+    size_t const step = std::max(nPoints / std::max(params.nSamples, size_t(1)), size_t(1));
+
+    Eigen::Matrix3d const R = pose.topLeftCorner<3, 3>();
+    Eigen::Vector3d const t = pose.topRightCorner<3, 1>();
+
+    size_t sampled = 0, overlapping = 0;
+    for (size_t row = 0; row < nPoints; row += step) {
+        ++sampled;
+        size_t nearestId;
+        double distSqr;
+        if (target.findNearest(R * source.row(row).transpose() + t, nearestId, distSqr) &&
+            distSqr < params.maxDistSqr)
+            ++overlapping;
+    } //...for samples
+
+    return static_cast<double>(overlapping) / sampled;
+} //...estimateOverlap()
+
+} //...ns acq
+
+#endif //ACQ_OVERLAP_HPP
@@ -0,0 +1,73 @@
+#ifndef ACQ_PARALLEL_HPP
+#define ACQ_PARALLEL_HPP
+
+#include "acq/parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace acq {
+
+template <typename _FuncT>
+void
+parallelFor(
+    size_t   const  count,
+    _FuncT   const& func,
+    size_t   const  grain,
+    unsigned const  nThreads
+) {
+    if (!count)
+        return;
+
+    // Never start more threads than there are blocks
+    size_t const blockSize = std::max(grain, size_t(1));
+    size_t const nBlocks   = (count + blockSize - 1) / blockSize;
+    unsigned const nWorkers =
+        static_cast<unsigned>(
+            std::min<size_t>(nThreads ? nThreads : defaultThreadCount(), nBlocks)
+        );
+
+    // Next unprocessed element
+    std::atomic<size_t> next(0);
+    // First error encountered, rethrown after joining
+    std::exception_ptr error;
+    std::mutex         errorMutex;
+
+    auto const worker = [&]() {
+        try {
+            for (size_t start = next.fetch_add(blockSize);
+                 start < count;
+                 start = next.fetch_add(blockSize)) {
+                size_t const end = std::min(start + blockSize, count);
+                for (size_t i = start; i != end; ++i)
+                    func(i);
+            } //...while blocks left
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+                error = std::current_exception();
+            // Make the other workers stop early
+            next.store(count);
+        }
+    }; //...worker
+
+    // Calling thread works too
+    std::vector<std::thread> threads;
+    threads.reserve(nWorkers - 1);
+    for (unsigned threadId = 1; threadId < nWorkers; ++threadId)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &thread : threads)
+        thread.join();
+
+    if (error)
+        std::rethrow_exception(error);
+} //...parallelFor()
+
+} //...ns acq
+
+#endif //ACQ_PARALLEL_HPP
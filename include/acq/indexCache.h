@@ -0,0 +1,67 @@
+#ifndef ACQ_INDEXCACHE_H
+#define ACQ_INDEXCACHE_H
+
+#include "acq/cloudIndex.h"
+#include "acq/hash.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace acq {
+
+/** \addtogroup Registration
+ *  @{
+ */
+
+/** \brief Stores built KD-trees on disk by a hash of their points, so they are built only once.
+ *
+ * One file per point hash and leaf size in a directory. A lookup maps the file and restores
+ * the tree without rebuilding it, a missing, stale or corrupt file is rebuilt and replaced.
+ * Reference models aligned to over and over across runs are thus indexed once.
+ * Safe to use from multiple threads.
+ */
+class IndexCache {
+public:
+    /** \brief Constructor.
+     *
+     * \param[in] directory Where trees are stored, created if missing.
+     */
+    explicit IndexCache(std::string const& directory);
+
+    /** \brief Loads the tree of \p points, or builds and stores it.
+     *
+     * \param[in] points     Points to index, have to outlive the index.
+     * \param[in] pointsHash \ref hashMatrix() of \p points.
+     * \param[in] maxLeafs   FLANN parameter.
+     *
+     * \return The index over \p points.
+     */
+    std::unique_ptr<CloudIndex> getIndex(
+        CloudIndex::PointsT const& points,
+        HashT               const  pointsHash,
+        int                 const  maxLeafs = 10);
+
+    /** \brief Hashes \p cloud and returns its tree, see above. */
+    std::unique_ptr<CloudIndex> getIndex(CloudT const& cloud, int const maxLeafs = 10);
+
+    /** \brief Number of trees loaded instead of built. */
+    size_t getHits() const { return _hits; }
+
+    /** \brief Number of trees built. */
+    size_t getMisses() const { return _misses; }
+
+protected:
+    /** \brief Path of the file storing the tree of \p pointsHash with leaf size \p maxLeafs. */
+    std::string getPath(HashT const pointsHash, int const maxLeafs) const;
+
+    std::string         _directory; //!< Where trees are stored.
+    std::atomic<size_t> _hits;      //!< Trees loaded.
+    std::atomic<size_t> _misses;    //!< Trees built.
+}; //...class IndexCache
+
+/** @} (Registration) */
+
+} //...ns acq
+
+#endif //ACQ_INDEXCACHE_H
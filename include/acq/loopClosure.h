@@ -0,0 +1,88 @@
+#ifndef ACQ_LOOPCLOSURE_H
+#define ACQ_LOOPCLOSURE_H
+
+#include "acq/typedefs.h"
+
+namespace acq {
+
+/** \addtogroup Registration
+ *  @{
+ */
+
+//! Pose invariant summary of a scan's shape, a normalized histogram.
+typedef Eigen::VectorXd GlobalDescriptorT;
+
+/** \brief Settings of loop closure detection, see \ref RegistrationPipeline::closeLoops(). */
+struct LoopClosureParams {
+    double maxDistSqr;        //!< Points closer (squared) than this count as overlapping.
+    double minOverlap;        //!< Verified pairs have to overlap at least this much after ICP.
+    double minEstimate;       //!< Pairs estimated to overlap this much before ICP are proposed.
+    int    maxDescriptorPairs;//!< Per scan, this many most similar (by descriptor) scans are proposed too.
+    int    icpIterations;     //!< Cap on the verification ICP iterations.
+    int    graphIterations;   //!< Maximum Gauss-Newton iterations on the pose graph.
+
+    LoopClosureParams()
+        : maxDistSqr(0.00001), minOverlap(0.3), minEstimate(0.1), maxDescriptorPairs(1),
+          icpIterations(30), graphIterations(20)
+    {}
+}; //...struct LoopClosureParams
+
+/** \brief A proposed non-sequential pair and the outcome of its verification. */
+struct LoopClosure {
+    int    source;   //!< Scan that was moved.
+    int    target;   //!< Scan it was aligned to.
+    double estimate; //!< Overlap estimated at the starting poses.
+    double overlap;  //!< Overlap after the verification ICP.
+    double error;    //!< Mean squared distance of the overlapping points after ICP.
+    bool   accepted; //!< True, if added to the pose graph.
+    PoseT  relative; //!< Verified relative pose, \ref source to \ref target coordinates.
+
+public:
+    // See https://eigen.tuxfamily.org/dox-devel/group__TopicStructHavingEigenMembers.html
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+}; //...struct LoopClosure
+
+/** \brief Shape distribution (D2) descriptor: histogram of distances between random point pairs.
+ *
+ * Invariant to the pose of the scan, so similar views can be proposed as loop closures
+ * even when drift has moved them far apart.
+ *
+ * \param[in] cloud    N x 3 points in rows.
+ * \param[in] nBins    Histogram resolution.
+ * \param[in] nSamples Number of random point pairs.
+ *
+ * \return Histogram over [0, bounding box diagonal] summing to 1.
+ */
+GlobalDescriptorT
+computeGlobalDescriptor(
+    CloudT const& cloud,
+    int    const  nBins    = 32,
+    int    const  nSamples = 20000);
+
+/** \brief L1 distance of two descriptors, 0 for identical shapes, at most 2. */
+double
+compareDescriptors(
+    GlobalDescriptorT const& a,
+    GlobalDescriptorT const& b);
+
+/** \brief Initial alignments of two scans independent of their poses, by their principal axes.
+ *
+ * Moves the mean of \p source onto the mean of \p target and its principal axes onto
+ * the target's, once for each of the four right-handed choices of the axis signs.
+ * Meant as seeds of an ICP for similar views, e.g. the same part scanned twice.
+ *
+ * \param[in] source N x 3 points to move.
+ * \param[in] target M x 3 points to move onto.
+ *
+ * \return Four relative poses, source to target coordinates, none for fewer than 3 points.
+ */
+PosesT
+computePrincipalAlignments(
+    CloudT const& source,
+    CloudT const& target);
+
+/** @} (Registration) */
+
+} //...ns acq
+
+#endif //ACQ_LOOPCLOSURE_H
@@ -0,0 +1,65 @@
+#ifndef ACQ_MAPPEDFILE_H
+#define ACQ_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace acq {
+
+/** \addtogroup IO
+ *  @{
+ */
+
+/** \brief Read-only view of a whole file mapped into memory.
+ *
+ * Pages are loaded by the operating system on first access, so opening is
+ * instantaneous and only the touched parts of a file are ever read.
+ * Uses mmap on POSIX systems and file mappings on Windows.
+ */
+class MappedFile {
+public:
+    /** \brief Constructor leaving the view closed. */
+    MappedFile();
+
+    /** \brief Constructor mapping \p path, check \ref isOpen() for success. */
+    explicit MappedFile(std::string const& path);
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    /** \brief Unmaps the file. */
+    ~MappedFile();
+
+    /** \brief Maps \p path, closing the previous file.
+     *
+     * \return False, if the file could not be opened or mapped.
+     */
+    bool open(std::string const& path);
+
+    /** \brief Unmaps the file. */
+    void close();
+
+    /** \brief True, if a file is mapped. */
+    bool isOpen() const { return _open; }
+
+    /** \brief First byte of the file, nullptr if closed or empty. */
+    char const* data() const { return _data; }
+
+    /** \brief Size of the file in bytes. */
+    size_t size() const { return _size; }
+
+protected:
+    char const* _data;    //!< Start of the mapping.
+    size_t      _size;    //!< Length of the mapping.
+    bool        _open;    //!< Whether a file is mapped.
+#ifdef _WIN32
+    void*       _file;    //!< File handle.
+    void*       _mapping; //!< File mapping handle.
+#endif
+}; //...class MappedFile
+
+/** @} (IO) */
+
+} //...ns acq
+
+#endif //ACQ_MAPPEDFILE_H
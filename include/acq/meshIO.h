@@ -0,0 +1,82 @@
+#ifndef ACQ_MESHIO_H
+#define ACQ_MESHIO_H
+
+#include "acq/decoratedCloud.h"
+
+#include <string>
+
+namespace acq {
+
+/** \addtogroup IO
+ *  @{
+ */
+
+/** \brief Size and timing of a file read, e.g. by \ref readOff(). */
+struct ReadStats {
+    size_t bytes;   //!< Size of the file.
+    size_t chunks;  //!< Number of chunks parsed independently.
+    double seconds; //!< Wall-clock time of the whole read.
+
+    ReadStats() : bytes(0), chunks(0), seconds(0.) {}
+
+    /** \brief Read throughput in MB/s. */
+    double getThroughput() const { return seconds > 0. ? bytes / seconds / (1024. * 1024.) : 0.; }
+}; //...struct ReadStats
+
+/** \brief Reads an ASCII OFF (or NOFF, COFF) mesh in parallel.
+ *
+ * Drop-in replacement for igl::readOFF: the file is memory mapped, split into
+ * line aligned chunks and all chunks are parsed concurrently straight into the
+ * preallocated outputs. Data lines are numbered by counting them per chunk and
+ * taking the prefix sum, so each chunk knows which vertices or faces it holds.
+ * Numbers are parsed exactly (correctly rounded, as by strtod), typical scan
+ * coordinates without the C library. Comment lines (#) and colours are skipped.
+ * All faces need the same number of vertices, as for igl::readOFF into matrices.
+ *
+ * \param[in]  path     OFF file.
+ * \param[out] vertices N x 3 points.
+ * \param[out] faces    M x K vertex indices.
+ * \param[out] stats    Optional size and timing of the read.
+ * \param[in]  nThreads Number of threads to use, 0 uses all cores.
+ *
+ * \return False, if the file could not be read or is not a valid OFF file.
+ */
+bool
+readOff(
+    std::string const& path,
+    CloudT           & vertices,
+    FacesT           & faces,
+    ReadStats        * stats    = nullptr,
+    unsigned    const  nThreads = 0);
+
+/** \brief Reads an OFF mesh straight into \p cloud, keeping the normals of NOFF files, see \ref readOff(). */
+bool
+readOff(
+    std::string const& path,
+    DecoratedCloud   & cloud,
+    ReadStats        * stats    = nullptr,
+    unsigned    const  nThreads = 0);
+
+/** \brief Lower case extension of \p path without the dot, empty if none. */
+std::string
+getExtension(std::string const& path);
+
+/** \brief Reads an OFF, PLY or \ref CloudFile (.acqc) mesh into \p cloud, chosen by the extension of \p path.
+ *
+ * \param[in]  path     OFF, PLY or cloud file.
+ * \param[out] cloud    Vertices, faces and, if the file has them, normals.
+ * \param[out] stats    Optional size and timing of the read.
+ * \param[in]  nThreads Number of threads to use for OFF files, 0 uses all cores.
+ */
+bool
+readMesh(
+    std::string const& path,
+    DecoratedCloud   & cloud,
+    ReadStats        * stats    = nullptr,
+    unsigned    const  nThreads = 0);
+
+/** @} (IO) */
+
+} //...ns acq
+
+#endif //ACQ_MESHIO_H
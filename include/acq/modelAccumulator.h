@@ -0,0 +1,104 @@
+#ifndef ACQ_MODELACCUMULATOR_H
+#define ACQ_MODELACCUMULATOR_H
+
+#include "acq/typedefs.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
+namespace acq {
+
+/** \brief Growing model of registered scans with a dynamic nearest neighbour index.
+ *
+ * Registered scans are appended without moving the points already stored, and the index is
+ * updated incrementally (logarithmic method of nanoflann's dynamic KD-tree): the new points of
+ * a scan are inserted as one block, which merges and rebuilds only the sub-trees smaller than
+ * the resulting one. Adding a scan therefore costs amortised O(log^2 n) per point,
+ * not time proportional to the whole model, though a single scan may still rebuild a sub-tree
+ * as large as the model.
+ * Can be used as the target of \ref alignPointToPoint().
+ *
+ * With a positive voxel size, points falling into the same cell of a sparse voxel grid
+ * are merged into one model point, averaging positions and normals. The model then grows
+ * with the scanned surface area instead of the number of scans. Merged points move within
+ * their voxel after they were indexed, so nearest neighbours are exact only up to the voxel
+ * diagonal in this mode.
+ */
+class ModelAccumulator {
+public:
+    /** \brief Constructor creating an empty model.
+     *
+     * \param[in] voxelSize Edge length of the merging voxels, 0 appends every point.
+     * \param[in] maxLeafs  FLANN parameter, maximum number of points in a leaf.
+     */
+    explicit ModelAccumulator(double const voxelSize = 0., int const maxLeafs = 10);
+
+    ~ModelAccumulator();
+
+    /** \brief Moves \p vertices by \p pose and appends them to the model.
+     *
+     * \param[in] vertices N x 3 points of the scan in scan coordinates.
+     * \param[in] pose     Registered pose of the scan.
+     *
+     * \return The model index of the first added point.
+     */
+    size_t addScan(CloudT const& vertices, PoseT const& pose = PoseT::Identity());
+
+    /** \brief Moves \p vertices and \p normals by \p pose and merges them into the model.
+     *
+     * \param[in] vertices N x 3 points of the scan in scan coordinates.
+     * \param[in] normals  N x 3 normals of the points, may be empty.
+     * \param[in] pose     Registered pose of the scan.
+     *
+     * \return The number of model points before adding the scan.
+     */
+    size_t addScan(CloudT const& vertices, NormalsT const& normals, PoseT const& pose = PoseT::Identity());
+
+    /** \brief Finds the closest model point to \p query.
+     *
+     * \return False, if the model is empty.
+     */
+    bool findNearest(Eigen::Vector3d const& query, size_t &pointId, double &distSqr) const;
+
+    /** \brief Coordinates of model point \p pointId. */
+    Eigen::Vector3d const& getPoint(size_t const pointId) const { return _points[pointId]; }
+
+    /** \brief Number of points in the model. */
+    size_t size() const { return _points.size(); }
+
+    /** \brief Edge length of the merging voxels, 0, if every point is kept. */
+    double getVoxelSize() const { return _voxelSize; }
+
+    /** \brief Copies the model into an N x 3 matrix. */
+    CloudT getVertices() const;
+
+    /** \brief Check, if every added scan came with normals. */
+    bool hasNormals() const { return _hasNormals && !_points.empty(); }
+
+    /** \brief Unit length (averaged) model normals, N x 3. */
+    NormalsT getNormals() const;
+
+protected:
+    /** \brief Key of the voxel containing \p point. */
+    uint64_t getVoxelKey(Eigen::Vector3d const& point) const;
+
+    ModelAccumulator(ModelAccumulator const&);            //!< Not copyable, the tree refers to this object.
+    ModelAccumulator& operator=(ModelAccumulator const&); //!< Not copyable, the tree refers to this object.
+
+    struct Tree; //!< Hides nanoflann from the includers of this header.
+
+    double                      _voxelSize;  //!< Merging voxel edge length, 0 to keep all points.
+    std::deque<Eigen::Vector3d> _points;     //!< Model points, never relocated on append.
+    std::deque<Eigen::Vector3d> _normals;    //!< Sum of the normals merged into each point.
+    std::deque<Eigen::Vector3d> _sums;       //!< Sum of the positions merged into each voxel.
+    std::deque<unsigned>        _counts;     //!< Number of points merged into each voxel.
+    std::unordered_map<uint64_t, size_t> _voxels; //!< { voxelKey => model point id }.
+    bool                        _hasNormals; //!< False, once a scan without normals was added.
+    std::unique_ptr<Tree>       _tree;       //!< Dynamic KD-tree over \ref _points.
+}; //...class ModelAccumulator
+
+} //...ns acq
+
+#endif //ACQ_MODELACCUMULATOR_H
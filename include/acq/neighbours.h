@@ -0,0 +1,157 @@
+#ifndef ACQ_NEIGHBOURS_H
+#define ACQ_NEIGHBOURS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace acq {
+
+/** \addtogroup NormalEstimation
+ *  @{
+ */
+
+/** \brief Neighbour lists of all points of a cloud in compressed sparse row (CSR) layout.
+ *
+ * The neighbours of point i are <tt>ids[offsets[i] .. offsets[i + 1])</tt>, sorted by id
+ * and without duplicates or i itself, optionally with their squared distances from i
+ * in a parallel array. Three flat arrays instead of a tree node per neighbour, so
+ * lookups are two reads, and rows can be filled independently, see \ref fromRows().
+ */
+class Neighbours {
+public:
+    //! Point index type, 4 bytes per stored neighbour.
+    typedef int IdT;
+
+    /** \brief Read-only view of the neighbours of one point, usable in range-based for loops. */
+    class Range {
+    public:
+        Range(IdT const* first, IdT const* last) : _first(first), _last(last) {}
+
+        IdT const* begin() const { return _first; }
+        IdT const* end()   const { return _last; }
+        size_t     size()  const { return static_cast<size_t>(_last - _first); }
+        bool       empty() const { return _first == _last; }
+        IdT        operator[](size_t const i) const { return _first[i]; }
+
+    private:
+        IdT const* _first; //!< First neighbour.
+        IdT const* _last;  //!< One past the last neighbour.
+    }; //...class Range
+
+    /** \brief Constructor leaving the lists empty. */
+    Neighbours();
+
+    /** \brief Constructor taking over finished CSR arrays.
+     *
+     * \param[in] offsets  N + 1 row starts into \p ids, starting with 0, non-decreasing.
+     * \param[in] ids      Neighbour ids of all points, each row sorted.
+     * \param[in] distsSqr Squared distances parallel to \p ids, or empty.
+     */
+    Neighbours(
+        std::vector<size_t> offsets,
+        std::vector<IdT>    ids,
+        std::vector<double> distsSqr = std::vector<double>());
+
+    /** \brief Packs rows of a fixed capacity into CSR layout.
+     *
+     * Each point owns \p stride slots of \p ids, so threads can fill the rows of different
+     * points without synchronisation, and report how many slots they used in \p counts.
+     *
+     * \param[in] stride   Slots per point in \p ids and \p distsSqr.
+     * \param[in] counts   Used slots of each point, at most \p stride, N entries.
+     * \param[in] ids      N x \p stride neighbour ids, each row sorted.
+     * \param[in] distsSqr N x \p stride squared distances, or empty.
+     * \param[in] nThreads Threads copying rows, 0 means \ref defaultThreadCount().
+     *
+     * \return The packed lists.
+     */
+    static Neighbours fromRows(
+        size_t              const  stride,
+        std::vector<size_t> const& counts,
+        std::vector<IdT>    const& ids,
+        std::vector<double> const& distsSqr = std::vector<double>(),
+        unsigned            const  nThreads = 0);
+
+    /** \brief Builds the lists from directed edges, each edge making its end a neighbour of its start.
+     *
+     * \param[in] edges    (start, end) pairs in any order, duplicates and self-loops are dropped.
+     * \param[in] nPoints  Number of lists, larger than every start and end.
+     * \param[in] nThreads Threads sorting the edges, 0 means \ref defaultThreadCount().
+     *
+     * \return The lists of \p nPoints points, without distances.
+     */
+    static Neighbours fromEdges(
+        std::vector<std::pair<IdT, IdT> > const& edges,
+        size_t                            const  nPoints,
+        unsigned                          const  nThreads = 0);
+
+    /** \brief Directed edge from \p start to \p end packed for \ref fromEdgeKeys(), ordered by start, then end. */
+    static uint64_t edgeKey(IdT const start, IdT const end, size_t const nPoints) {
+        return static_cast<uint64_t>(start) * nPoints + static_cast<uint64_t>(end);
+    }
+
+    /** \brief Builds the lists from a flat array of directed edges, see \ref edgeKey().
+     *
+     * The keys are radix sorted in parallel, see \ref parallelRadixSort(), then duplicates
+     * and self-loops are dropped and the row starts found, all on \p nThreads threads.
+     *
+     * \param[in] keys     Directed edges of \p nPoints points in any order, consumed.
+     * \param[in] nPoints  Number of lists.
+     * \param[in] nThreads Number of threads to use, 0 means \ref defaultThreadCount().
+     *
+     * \return The lists of \p nPoints points, without distances.
+     */
+    static Neighbours fromEdgeKeys(
+        std::vector<uint64_t>        keys,
+        size_t                const  nPoints,
+        unsigned              const  nThreads = 0);
+
+    /** \brief Undirected version of these lists: j is a neighbour of i, if either is a neighbour of the other.
+     *
+     * \param[in] nPoints  Number of lists of the result, at least \ref size() and larger than every id.
+     * \param[in] nThreads Number of threads to use, 0 means \ref defaultThreadCount().
+     */
+    Neighbours symmetrized(size_t const nPoints, unsigned const nThreads = 0) const;
+
+    /** \brief Number of points with a (possibly empty) list. */
+    size_t size() const { return _offsets.size() - 1; }
+
+    /** \brief Number of neighbours over all points. */
+    size_t getNeighbourCount() const { return _ids.size(); }
+
+    /** \brief Number of neighbours of point \p pointId. */
+    size_t count(size_t const pointId) const { return _offsets[pointId + 1] - _offsets[pointId]; }
+
+    /** \brief Neighbours of point \p pointId, sorted by id. */
+    Range operator[](size_t const pointId) const {
+        return Range(_ids.data() + _offsets[pointId], _ids.data() + _offsets[pointId + 1]);
+    }
+
+    /** \brief Check, if squared distances are stored. */
+    bool hasDistances() const { return !_distsSqr.empty(); }
+
+    /** \brief Squared distances of the neighbours of point \p pointId, parallel to operator[](). */
+    double const* getDistancesSqr(size_t const pointId) const { return _distsSqr.data() + _offsets[pointId]; }
+
+    /** \brief Row starts, N + 1 entries. */
+    std::vector<size_t> const& getOffsets() const { return _offsets; }
+
+    /** \brief Neighbour ids of all points, row after row. */
+    std::vector<IdT> const& getIds() const { return _ids; }
+
+    /** \brief Squared distances parallel to \ref getIds(), empty if not stored. */
+    std::vector<double> const& getDistancesSqr() const { return _distsSqr; }
+
+protected:
+    std::vector<size_t> _offsets;  //!< N + 1 row starts into \ref _ids.
+    std::vector<IdT>    _ids;      //!< Neighbour ids, row after row.
+    std::vector<double> _distsSqr; //!< Squared distances parallel to \ref _ids, or empty.
+}; //...class Neighbours
+
+/** @} (NormalEstimation) */
+
+} //...ns acq
+
+#endif //ACQ_NEIGHBOURS_H
@@ -5,29 +5,41 @@
 #ifndef ACQ_NORMALESTIMATION_H
 #define ACQ_NORMALESTIMATION_H
 
+#include "acq/neighbours.h"
 #include "acq/typedefs.h"
 #include <limits.h>
 #include <vector>
 
 namespace acq {
 
+class CloudIndex;
+class QuantizedCloud;
+
 /** \addtogroup NormalEstimation
  *  @{
  */
 
+/** \brief How the normals of the faces around a vertex are weighted, see \ref calculateCloudNormalsFromFaces(). */
+enum FaceWeighting {
+    FACE_WEIGHT_AREA, //!< By face area, favours large faces, cheapest.
+    FACE_WEIGHT_ANGLE //!< By the corner angle of the face at the vertex, independent of the tessellation.
+};
+
 /** \brief Estimates the normal of a single point
  *         given its ID and the ID of its neighbours.
  *
+ * \tparam _CloudT Concept: acq::CloudT, or an acq::QuantizedCloud.
+ *
  * \param[in] cloud             N x 3 matrix containing points in rows.
  * \param[in] pointIndex        Row-index of point.
- * \param[in] neighbourIndices  List of row-indices of neighbours.
+ * \param[in] neighbourIndices  List of row-indices of neighbours, e.g. a \ref Neighbours::Range.
  *
  * \return A 3D vector that is the normal of point with ID \p pointIndex.
  */
-template <typename _NeighbourIdListT>
+template <typename _CloudT, typename _NeighbourIdListT>
 Eigen::Matrix <typename CloudT::Scalar, 3, 1>
 calculatePointNormal(
-    CloudT            const& cloud,
+    _CloudT           const& cloud,
     int               const  pointIndex,
     _NeighbourIdListT const& neighbourIndices);
 
@@ -35,73 +47,238 @@ calculatePointNormal(
 /** \brief Estimates the neighbours of all points in cloud
  *         returning \p k neighbours max each.
  *
+ * The points are queried in parallel blocks, each filling its rows of a flat
+ * N x k buffer, which is packed afterwards. The result does not depend on \p nThreads.
+ *
  * \param[in] k         How many neighbours too look for in point.
  * \param[in] maxDist   Maximum distance between vertex and neighbour.
  * \param[in] maxLeafs  FLANN parameter, maximum kdTree depth.
+ * \param[in] nThreads  Number of threads to use, 0 means \ref defaultThreadCount().
  *
- * \return An associative container with the varying length lists of neighbours.
+ * \return The varying length lists of neighbours, sorted by id, with their squared distances.
  */
 NeighboursT
 calculateCloudNeighbours(
     CloudT               const& cloud,
     int                  const  k,
-    float                const  maxDist = std::sqrt(std::numeric_limits<float>::max()) - 1.f,
-    int                  const  maxLeafs = 10);
+    float                const  maxDist  = std::sqrt(std::numeric_limits<float>::max()) - 1.f,
+    int                  const  maxLeafs = 10,
+    unsigned             const  nThreads = 0);
+
+/** \brief Finds the neighbours of all points in cloud closer than \p radius.
+ *
+ * Fixed-radius version of \ref calculateCloudNeighbours(): rows have as many
+ * neighbours as the density gives, so dense regions should set a cap.
+ *
+ * \param[in] radius        Maximum distance between vertex and neighbour.
+ * \param[in] maxNeighbours Keep only the closest this many, 0 keeps all.
+ * \param[in] maxLeafs      FLANN parameter, maximum kdTree depth.
+ * \param[in] nThreads      Number of threads to use, 0 means \ref defaultThreadCount().
+ *
+ * \return The varying length lists of neighbours, sorted by id, with their squared distances.
+ */
+NeighboursT
+calculateCloudNeighboursInRadius(
+    CloudT               const& cloud,
+    float                const  radius,
+    int                  const  maxNeighbours = 0,
+    int                  const  maxLeafs      = 10,
+    unsigned             const  nThreads      = 0);
+
+/** \brief Finds the neighbours of all points in cloud within a radius of their own.
+ *
+ * Adaptive version of the above: with radii a few times the local spacing, see
+ * \ref calculatePointSpacing(), sparse regions still find neighbours, and the cap
+ * keeps dense regions from returning (and searching) more than needed.
+ *
+ * \param[in] radii         N search radii, one per point.
+ * \param[in] maxNeighbours Keep only the closest this many, 0 keeps all.
+ */
+NeighboursT
+calculateCloudNeighboursInRadius(
+    CloudT               const& cloud,
+    Eigen::VectorXd      const& radii,
+    int                  const  maxNeighbours,
+    int                  const  maxLeafs      = 10,
+    unsigned             const  nThreads      = 0);
+
+/** \brief Estimates the local point spacing, the mean distance of each point to its \p k nearest neighbours.
+ *
+ * \param[in] k        Neighbours to average over.
+ * \param[in] maxLeafs FLANN parameter, maximum kdTree depth.
+ * \param[in] nThreads Number of threads to use, 0 means \ref defaultThreadCount().
+ *
+ * \return N spacings, 0 for points without neighbours.
+ */
+Eigen::VectorXd
+calculatePointSpacing(
+    CloudT               const& cloud,
+    int                  const  k        = 6,
+    int                  const  maxLeafs = 10,
+    unsigned             const  nThreads = 0);
 
 /** \brief Estimates the normals of all points in cloud using \p k neighbours max each.
  *
- * \param[in] cloud      Input pointcloud, N x 3, N 3D points in rows.
- * \param[in] neighbours Precomputed lists of neighbour Ids.
+ * Batch version of \ref calculatePointNormal(): the covariances are accumulated
+ * in blocks of points on multiple threads and solved in closed form
+ * (SelfAdjointEigenSolver::computeDirect), so the normals may differ from
+ * the iterative solution in the last digits.
+ *
+ * \param[in ] cloud      Input pointcloud, N x 3, N 3D points in rows.
+ * \param[in ] neighbours Precomputed lists of neighbour Ids.
+ * \param[out] curvatures Optional N surface variations, the smallest eigenvalue over the sum
+ *                        of the eigenvalues of each covariance, 0 for flat neighbourhoods.
+ * \param[in ] nThreads   Number of threads to use, 0 means \ref defaultThreadCount().
  *
  * \return N x 3 3D normals, the normals of the points in \p cloud.
  */
 NormalsT
 calculateCloudNormals(
     CloudT               const& cloud,
-    NeighboursT          const& neighbours);
+    NeighboursT          const& neighbours,
+    Eigen::VectorXd           * curvatures = nullptr,
+    unsigned             const  nThreads   = 0);
 
-/** \brief Breadth-first-search to orient normals consistently
- *         using the provided neighbourhood information.
+/** \brief Finds the neighbours of selected points of an indexed cloud, see above.
+ *
+ * \param[in] cloudIndex Tree over the whole cloud.
+ * \param[in] pointIds   Points to look up, row i of the result belongs to point pointIds[i].
+ *
+ * \return One list per entry of \p pointIds, with ids of the whole cloud.
+ */
+NeighboursT
+calculateCloudNeighbours(
+    CloudIndex                   const& cloudIndex,
+    std::vector<Neighbours::IdT> const& pointIds,
+    int                          const  k,
+    float                        const  maxDist  = std::sqrt(std::numeric_limits<float>::max()) - 1.f,
+    unsigned                     const  nThreads = 0);
+
+/** \brief Re-estimates the normals of selected points in place, see \ref calculateCloudNormals().
+ *
+ * \param[in    ] cloud      Input pointcloud, N x 3.
+ * \param[in    ] pointIds   Points to update.
+ * \param[in    ] neighbours Neighbours of each of \p pointIds, in the same order.
+ * \param[in,out] normals    N x 3 normals, rows of \p pointIds are replaced, unoriented.
+ * \param[in,out] curvatures Optional N curvatures, entries of \p pointIds are replaced.
+ * \param[in    ] nThreads   Number of threads to use, 0 means \ref defaultThreadCount().
+ */
+void
+updateCloudNormals(
+    CloudT                       const& cloud,
+    std::vector<Neighbours::IdT> const& pointIds,
+    NeighboursT                  const& neighbours,
+    NormalsT                          & normals,
+    Eigen::VectorXd                   * curvatures = nullptr,
+    unsigned                     const  nThreads   = 0);
+
+/** \brief Estimates the neighbours of all points in a quantized cloud, see above.
+ *         The tree decodes the points on the fly, the cloud is never expanded.
+ */
+NeighboursT
+calculateCloudNeighbours(
+    QuantizedCloud       const& cloud,
+    int                  const  k,
+    float                const  maxDist  = std::sqrt(std::numeric_limits<float>::max()) - 1.f,
+    int                  const  maxLeafs = 10,
+    unsigned             const  nThreads = 0);
+
+/** \brief Estimates the normals of all points in a quantized cloud, see above. */
+NormalsT
+calculateCloudNormals(
+    QuantizedCloud       const& cloud,
+    NeighboursT          const& neighbours,
+    Eigen::VectorXd           * curvatures = nullptr,
+    unsigned             const  nThreads   = 0);
+
+/** \brief Orients normals consistently using the provided neighbourhood information.
+ *
+ * Propagates the orientation along a minimum spanning tree of the (symmetrized)
+ * neighbourhood graph, weighted by the angle between neighbouring normals
+ * (Hoppe et al. 1992), so it crosses sharp creases last. Each connected
+ * component starts from its flattest point and keeps that point's orientation.
+ * Components are oriented in parallel.
  *
  * \param[in]     neighbours A directed list of neighbour indices.
  * \param[in,out] normals    The normals to possibly flip.
+ * \param[in]     curvatures Optional per-point curvatures to pick the seeds with,
+ *                           see \ref calculateCloudNormals(), otherwise the variation
+ *                           of the neighbouring normals is used.
+ * \param[in]     nThreads   Number of threads to use, 0 means \ref defaultThreadCount().
  *
- * \return The number of normals flipped.
+ * \return The number of normals flipped, -1 if there are no normals.
  */
 int
 orientCloudNormals(
-    NeighboursT const& neighbours,
-    NormalsT         & normals);
+    NeighboursT     const& neighbours,
+    NormalsT             & normals,
+    Eigen::VectorXd const* curvatures = nullptr,
+    unsigned        const  nThreads   = 0);
 
 /** \brief Traverses faces and records neighbourhood information using face edges.
+ *
+ * Both directions of every face edge are written to a flat array in parallel, which is
+ * radix sorted and deduplicated into the lists, see \ref Neighbours::fromEdgeKeys().
+ * For the faces around each edge, see \ref HalfEdges.
  *
  * \tparam _FacesT Concept: acq::FacesT aka. Eigen::MatrixXi.
  *
- * \param faces Indices of vertices belonging to a face in each row.
+ * \param[in] faces    Indices of vertices belonging to a face in each row.
+ * \param[in] nThreads Number of threads to use, 0 means \ref defaultThreadCount().
  *
- * \return The directed neighbourhood information.
+ * \return The neighbourhood information, a vertex in no face has no neighbours.
  */
 template <typename _FacesT>
 NeighboursT
 calculateCloudNeighboursFromFaces(
-    _FacesT   const& faces
+    _FacesT   const& faces,
+    unsigned  const  nThreads = 0
 );
 
 /** \brief Estimates neighbourhood information from faces,
- *         and then consistently flips normals using BFS traversal.
+ *         and then consistently flips normals, see \ref orientCloudNormals().
  *
  * \tparam _NormalsT Concept: acq::NormalsT, aka. Eigen::MatrixXd.
  * \tparam _FacesT   Concept: acq::FacesT, aka. Eigen::MatrixXi.
  *
- * \param[in     ] faces  Face vertex indices in rows.
- * \param[in,out] normals The normals to possibly flip.
- * \return
+ * \param[in    ] faces    Face vertex indices in rows.
+ * \param[in,out] normals  The normals to possibly flip.
+ * \param[in    ] nThreads Number of threads to use, 0 means \ref defaultThreadCount().
+ *
+ * \return The number of normals flipped, -1 if there are no normals.
  */
 template <typename _NormalsT, typename _FacesT>
 int
 orientCloudNormalsFromFaces(
     _FacesT     const& faces,
-    _NormalsT        & normals);
+    _NormalsT        & normals,
+    unsigned    const  nThreads = 0);
+
+/** \brief Vertex normals of a mesh, the weighted sums of the normals of the faces around each vertex.
+ *
+ * No neighbour search and no eigen problems, so several times cheaper than
+ * \ref calculateCloudNormals() for meshed inputs. The face corners are sorted by vertex
+ * once, then every vertex sums its own faces on one of the threads, without atomics.
+ * Orientation follows the winding of the faces. Where the faces around a vertex are
+ * wound inconsistently, their normals are summed up to sign, and \p consistent
+ * is cleared, so the caller can repair the orientation, see \ref orientCloudNormalsFromFaces().
+ *
+ * \param[in ] cloud      N x 3 vertices.
+ * \param[in ] faces      Vertex indices of a face in each row, at least 3 columns, polygons
+ *                        use the Newell normal.
+ * \param[in ] weighting  Weights of the face normals.
+ * \param[out] consistent Optional, whether the faces around every vertex are wound consistently.
+ * \param[in ] nThreads   Number of threads to use, 0 means \ref defaultThreadCount().
+ *
+ * \return N x 3 unit normals, zero for vertices in no (non-degenerate) face.
+ */
+NormalsT
+calculateCloudNormalsFromFaces(
+    CloudT        const& cloud,
+    FacesT        const& faces,
+    FaceWeighting const  weighting  = FACE_WEIGHT_AREA,
+    bool               * consistent = nullptr,
+    unsigned      const  nThreads   = 0);
 
 /** @} (NormalEstimation) */
 
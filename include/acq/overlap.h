@@ -0,0 +1,103 @@
+#ifndef ACQ_OVERLAP_H
+#define ACQ_OVERLAP_H
+
+#include "acq/typedefs.h"
+
+#include <vector>
+
+namespace acq {
+
+/** \addtogroup Registration
+ *  @{
+ */
+
+/** \brief Bounding box aligned with the principal axes of a cloud. */
+struct OrientedBox {
+    Eigen::Vector3d center;      //!< Box center.
+    Eigen::Matrix3d axes;        //!< Unit box axes in columns, a rotation.
+    Eigen::Vector3d halfExtents; //!< Half edge lengths along \ref axes.
+
+    OrientedBox()
+        : center(Eigen::Vector3d::Zero()), axes(Eigen::Matrix3d::Identity()),
+          halfExtents(Eigen::Vector3d::Zero())
+    {}
+}; //...struct OrientedBox
+
+/** \brief Settings of the overlap estimates, see \ref estimateOverlap(). */
+struct OverlapParams {
+    double maxDistSqr; //!< Sampled points closer (squared) than this to the other scan overlap.
+    size_t nSamples;   //!< Number of points sampled from each scan.
+    double boxMargin;  //!< Boxes are grown by this much before the intersection test.
+
+    OverlapParams() : maxDistSqr(0.0001), nSamples(1000), boxMargin(0.) {}
+}; //...struct OverlapParams
+
+/** \brief Fits an oriented box to \p cloud using its principal axes.
+ *
+ * \param[in] cloud N x 3 points in rows.
+ *
+ * \return A box containing every point of \p cloud.
+ */
+OrientedBox
+computeOrientedBox(
+    CloudT const& cloud);
+
+/** \brief Moves \p box by the rigid transformation \p pose. */
+OrientedBox
+transformBox(
+    OrientedBox const& box,
+    PoseT       const& pose);
+
+/** \brief Separating axis test of two oriented boxes.
+ *
+ * \param[in] a      First box.
+ * \param[in] b      Second box.
+ * \param[in] margin Both boxes are grown by this much on every side.
+ *
+ * \return True, if the boxes intersect.
+ */
+bool
+intersects(
+    OrientedBox const& a,
+    OrientedBox const& b,
+    double      const  margin = 0.);
+
+/** \brief Estimates the fraction of \p source that overlaps \p target at \p pose
+ *         from about \p params.nSamples evenly strided source points.
+ *
+ * \tparam _SourceT Concept: acq::CloudT.
+ * \tparam _TargetT Concept: acq::CloudIndex, see \ref alignPointToPoint().
+ *
+ * \param[in] source N x 3 points to test.
+ * \param[in] target Nearest neighbour index of the other scan.
+ * \param[in] pose   Transforms \p source coordinates to \p target coordinates.
+ * \param[in] params Sample count and distance threshold.
+ *
+ * \return The overlapping fraction of the sampled points, [0..1].
+ */
+template <typename _SourceT, typename _TargetT>
+double
+estimateOverlap(
+    _SourceT      const& source,
+    _TargetT      const& target,
+    PoseT         const& pose,
+    OverlapParams const& params);
+
+/** \brief Maximum spanning tree of a weighted graph (Prim's algorithm).
+ *
+ * \param[in] weights Symmetric N x N matrix of edge weights, e.g. overlaps,
+ *                    non-positive weights mean no edge.
+ * \param[in] root    The node to start from.
+ *
+ * \return The parent of each node, -1 for \p root and for nodes not connected to it.
+ */
+std::vector<int>
+computeMaxSpanningTree(
+    Eigen::MatrixXd const& weights,
+    int             const  root);
+
+/** @} (Registration) */
+
+} //...ns acq
+
+#endif //ACQ_OVERLAP_H
@@ -0,0 +1,65 @@
+#ifndef ACQ_PARALLEL_H
+#define ACQ_PARALLEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace acq {
+
+/** \addtogroup Parallel
+ *  @{
+ */
+
+/** \brief Number of worker threads to use when the caller does not specify one.
+ *
+ * \return The hardware concurrency reported by the standard library, at least 1.
+ */
+unsigned
+defaultThreadCount();
+
+/** \brief Calls \p func for every index in [0, \p count) on multiple threads.
+ *
+ * Indices are handed out in blocks of \p grain consecutive elements,
+ * so uneven workloads (e.g. ICP runs of different length) balance out.
+ * The first exception thrown by \p func is rethrown in the calling thread.
+ *
+ * \tparam _FuncT Concept: void(size_t index).
+ *
+ * \param[in] count    Number of elements to process.
+ * \param[in] func     Callable invoked once per element.
+ * \param[in] grain    How many consecutive elements a thread takes at a time.
+ * \param[in] nThreads Number of threads to use, 0 means \ref defaultThreadCount().
+ */
+template <typename _FuncT>
+void
+parallelFor(
+    size_t   const  count,
+    _FuncT   const& func,
+    size_t   const  grain    = 1,
+    unsigned const  nThreads = 0);
+
+/** \brief Sorts \p keys in increasing order with a parallel least-significant-digit radix sort.
+ *
+ * Each pass splits the keys into one chunk per thread, counts the 11-bit digits of every chunk,
+ * and scatters each chunk into its own slots of the output, so no two threads write the same
+ * place. Passes over digits above \p maxKey, or that all keys share, are skipped. The sort is
+ * stable and the result does not depend on \p nThreads.
+ *
+ * \param[in,out] keys     Keys to sort.
+ * \param[in    ] maxKey   Largest key, fewer bits need fewer passes.
+ * \param[in,out] values   Optional payload, one per key, permuted along with the keys.
+ * \param[in    ] nThreads Number of threads to use, 0 means \ref defaultThreadCount().
+ */
+void
+parallelRadixSort(
+    std::vector<uint64_t>      & keys,
+    uint64_t              const  maxKey,
+    std::vector<int>           * values   = nullptr,
+    unsigned              const  nThreads = 0);
+
+/** @} (Parallel) */
+
+} //...ns acq
+
+#endif //ACQ_PARALLEL_H
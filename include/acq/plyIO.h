@@ -0,0 +1,183 @@
+#ifndef ACQ_PLYIO_H
+#define ACQ_PLYIO_H
+
+#include "acq/meshIO.h"
+
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace acq {
+
+/** \addtogroup IO
+ *  @{
+ */
+
+/** \brief Consecutive vertices of a PLY file, handed to \ref PlyReader::read() callbacks. */
+struct PlyVertexChunk {
+    size_t   first;    //!< Index of the first vertex of the chunk in the file.
+    CloudT   vertices; //!< Rows of x, y, z.
+    NormalsT normals;  //!< Rows of nx, ny, nz, empty if the file has no normals.
+}; //...struct PlyVertexChunk
+
+/** \brief Consecutive faces of a PLY file, handed to \ref PlyReader::read() callbacks. */
+struct PlyFaceChunk {
+    size_t first; //!< Index of the first face of the chunk in the file.
+    FacesT faces; //!< Rows of vertex indices, referring to the vertex order in the file.
+}; //...struct PlyFaceChunk
+
+/** \brief Streams the vertices and faces of an ASCII or binary PLY file in chunks.
+ *
+ * Only one chunk is held in memory at a time, so huge files can be filtered or
+ * downsampled while they load. Vertices need x, y, z properties and optionally
+ * have nx, ny, nz. Faces need a vertex_indices (or vertex_index) list, all lists
+ * of the same length. Other properties and elements are skipped.
+ */
+class PlyReader {
+public:
+    //! Receives each vertex chunk.
+    typedef std::function<void(PlyVertexChunk const&)> VertexCallbackT;
+    //! Receives each face chunk.
+    typedef std::function<void(PlyFaceChunk const&)>   FaceCallbackT;
+
+    /** \brief Constructor setting the number of vertices or faces per chunk. */
+    explicit PlyReader(size_t const chunkSize = 1 << 16);
+
+    ~PlyReader();
+
+    /** \brief Opens \p path and parses its header.
+     *
+     * \return False, if the file could not be opened or the header is invalid.
+     */
+    bool open(std::string const& path);
+
+    /** \brief Number of vertices announced in the header. */
+    size_t getVertexCount() const { return _nVertices; }
+    /** \brief Number of faces announced in the header. */
+    size_t getFaceCount() const { return _nFaces; }
+    /** \brief Check, if the vertices have nx, ny, nz properties. */
+    bool hasNormals() const { return _hasNormals; }
+
+    /** \brief Reads the body of the opened file, calling the callbacks chunk by chunk in file order.
+     *
+     * \param[in] onVertices Called with every vertex chunk.
+     * \param[in] onFaces    Called with every face chunk, faces are skipped, if empty.
+     *
+     * \return False, if the file ended early or contains invalid data.
+     */
+    bool read(VertexCallbackT const& onVertices, FaceCallbackT const& onFaces = FaceCallbackT());
+
+protected:
+    /** \brief Storage type of a property value. */
+    enum Type { INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64 };
+
+    /** \brief Property of an element as declared in the header. */
+    struct Property {
+        std::string name;      //!< E.g. x or vertex_indices.
+        Type        type;      //!< Type of the value, or of the list entries.
+        bool        isList;    //!< Whether the property is a counted list.
+        Type        countType; //!< Type of the list length.
+    }; //...struct Property
+
+    /** \brief Element as declared in the header. */
+    struct Element {
+        std::string           name;       //!< E.g. vertex or face.
+        size_t                count;      //!< Number of records.
+        std::vector<Property> properties; //!< Record layout.
+    }; //...struct Element
+
+    class Source;
+
+    /** \brief Streams \p element, calling the matching callback per chunk. */
+    bool readElement(Element const& element, VertexCallbackT const& onVertices, FaceCallbackT const& onFaces);
+
+    size_t                  _chunkSize;  //!< Vertices or faces per callback.
+    std::string             _path;       //!< Opened file, for messages.
+    std::unique_ptr<Source> _source;     //!< Decodes the body.
+    std::vector<Element>    _elements;   //!< Header, in file order.
+    size_t                  _nVertices;  //!< Vertex count of the header.
+    size_t                  _nFaces;     //!< Face count of the header.
+    bool                    _hasNormals; //!< Whether vertices have normals.
+}; //...class PlyReader
+
+/** \brief Writes a PLY file chunk by chunk, vertices first, then faces.
+ *
+ * The counts are fixed up front in the header, \ref close() checks that they were met.
+ * Coordinates are stored as doubles, faces as uchar-counted int lists.
+ */
+class PlyWriter {
+public:
+    PlyWriter();
+
+    /** \brief Closes the file, see \ref close(). */
+    ~PlyWriter();
+
+    /** \brief Creates \p path and writes the header.
+     *
+     * \param[in] path       Output file.
+     * \param[in] nVertices  Number of vertices that will be written.
+     * \param[in] nFaces     Number of faces that will be written.
+     * \param[in] hasNormals Whether the vertices will come with normals.
+     * \param[in] faceSize   Vertices per face.
+     * \param[in] binary     Binary little endian if true, ASCII otherwise.
+     *
+     * \return False, if the file could not be created.
+     */
+    bool open(
+        std::string const& path,
+        size_t      const  nVertices,
+        size_t      const  nFaces,
+        bool        const  hasNormals,
+        int         const  faceSize = 3,
+        bool        const  binary   = true);
+
+    /** \brief Appends vertex rows, with as many \p normals rows if the file has normals. */
+    bool writeVertices(CloudT const& vertices, NormalsT const& normals = NormalsT());
+
+    /** \brief Appends face rows, after all vertices. */
+    bool writeFaces(FacesT const& faces);
+
+    /** \brief Flushes and closes the file.
+     *
+     * \return False, if writing failed or not all announced elements were written.
+     */
+    bool close();
+
+protected:
+    std::ofstream _file;         //!< Output.
+    std::string   _path;         //!< For messages.
+    size_t        _nVertices;    //!< Announced vertex count.
+    size_t        _nFaces;       //!< Announced face count.
+    size_t        _vertexCount;  //!< Vertices written so far.
+    size_t        _faceCount;    //!< Faces written so far.
+    bool          _hasNormals;   //!< Whether normals are written.
+    int           _faceSize;     //!< Vertices per face.
+    bool          _binary;       //!< Binary or ASCII body.
+}; //...class PlyWriter
+
+/** \brief Reads a whole PLY file straight into \p cloud, see \ref PlyReader.
+ *
+ * \param[in]  path  PLY file.
+ * \param[out] cloud Vertices, faces and, if present, normals.
+ * \param[out] stats Optional size and timing of the read.
+ */
+bool
+readPly(
+    std::string const& path,
+    DecoratedCloud   & cloud,
+    ReadStats        * stats = nullptr);
+
+/** \brief Writes the vertices, faces and normals of \p cloud, see \ref PlyWriter. */
+bool
+writePly(
+    std::string    const& path,
+    DecoratedCloud const& cloud,
+    bool           const  binary = true);
+
+/** @} (IO) */
+
+} //...ns acq
+
+#endif //ACQ_PLYIO_H
@@ -0,0 +1,98 @@
+#ifndef ACQ_POSEGRAPH_H
+#define ACQ_POSEGRAPH_H
+
+#include "acq/typedefs.h"
+
+#include <vector>
+
+namespace acq {
+
+/** \addtogroup Registration
+ *  @{
+ */
+
+/** \brief Graph of scan poses connected by relative pose measurements.
+ *
+ * Nodes are world poses of scans, edges are pairwise registrations weighted by the
+ * information of their correspondences. \ref optimize() distributes the disagreement
+ * between the measurements (e.g. drift along a chain) over all poses by sparse
+ * Gauss-Newton, solving the normal equations with a sparse Cholesky factorization.
+ */
+class PoseGraph {
+public:
+    //! 6D error or update vector, rotation (axis-angle) first, then translation.
+    typedef Eigen::Matrix<double, 6, 1> Vector6;
+
+    /** \brief A measured relative pose between two nodes. */
+    struct Edge {
+        int          source;      //!< Node whose points were moved.
+        int          target;      //!< Node whose points were fixed.
+        PoseT        measurement; //!< Transforms \ref source coordinates to \ref target coordinates.
+        InformationT information; //!< Confidence in \ref measurement.
+
+    public:
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    }; //...struct Edge
+
+    //! List of edges.
+    typedef std::vector<Edge, Eigen::aligned_allocator<Edge> > EdgesT;
+
+    /** \brief Default constructor creating an empty graph anchored at node 0. */
+    PoseGraph() : _fixed(0) {}
+
+    /** \brief Appends a node at \p pose, returns its index. */
+    int addNode(PoseT const& pose);
+
+    /** \brief Appends a measurement, returns its index.
+     *
+     * \param[in] source      Node whose points were moved onto \p target.
+     * \param[in] target      Node whose points were fixed.
+     * \param[in] measurement Relative pose, source to target coordinates.
+     * \param[in] information Confidence, e.g. \ref CorrespondenceStats::information.
+     */
+    int addEdge(int const source, int const target, PoseT const& measurement, InformationT const& information);
+
+    /** \brief Replaces the measurement of edge \p edgeId. */
+    void setEdge(int const edgeId, PoseT const& measurement, InformationT const& information);
+
+    /** \brief Removes all edges. */
+    void clearEdges() { _edges.clear(); }
+
+    /** \brief Keeps node \p nodeId at its current pose during optimization (default: node 0). */
+    void setFixed(int const nodeId) { _fixed = nodeId; }
+
+    /** \brief Overwrites the pose of node \p nodeId. */
+    void setPose(int const nodeId, PoseT const& pose) { _poses.at(nodeId) = pose; }
+
+    /** \brief Current node poses. */
+    PosesT const& getPoses() const { return _poses; }
+
+    /** \brief Current edges. */
+    EdgesT const& getEdges() const { return _edges; }
+
+    /** \brief Error of edge \p edge at the current poses. */
+    Vector6 getError(Edge const& edge) const;
+
+    /** \brief Sum of the squared, information weighted errors of all edges. */
+    double getChiSquared() const;
+
+    /** \brief Optimizes the free poses by sparse Gauss-Newton.
+     *
+     * \param[in] maxIterations Maximum number of linearizations.
+     * \param[in] minUpdate     Converged, once the largest update component drops below this.
+     *
+     * \return The number of iterations run.
+     */
+    int optimize(int const maxIterations = 20, double const minUpdate = 1.e-8);
+
+protected:
+    PosesT _poses;     //!< World pose of each node.
+    EdgesT _edges;     //!< Relative pose measurements.
+    int    _fixed;     //!< Node kept constant, anchors the world frame.
+}; //...class PoseGraph
+
+/** @} (Registration) */
+
+} //...ns acq
+
+#endif //ACQ_POSEGRAPH_H
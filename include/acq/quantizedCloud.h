@@ -0,0 +1,163 @@
+#ifndef ACQ_QUANTIZEDCLOUD_H
+#define ACQ_QUANTIZEDCLOUD_H
+
+#include "acq/typedefs.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace acq {
+
+/** \addtogroup IO
+ *  @{
+ */
+
+/** \brief Compact point cloud storing quantized coordinates and normals, decoded on access.
+ *
+ * Coordinates are stored relative to the bounding box of the cloud on a grid of
+ * 2^bits - 1 steps per axis: 16 bits (6 bytes per point) or 21 bits packed into 8 bytes.
+ * Normals are octahedral encoded into 2 x 16 bits (4 bytes). Compared to 48 bytes for
+ * a \ref CloudT and \ref NormalsT pair this fits 4-5 times more points into memory.
+ *
+ * Error bounds:
+ *  - every coordinate is off by at most half a grid step, see \ref getMaxError(),
+ *  - every normal is off by less than 0.003 degrees: the encoder picks the closest of the four
+ *    neighbouring codes on a grid of 65535^2 codes on the octahedron, the axes are exact.
+ *
+ * Provides rows() and row() like an N x 3 Eigen matrix, so the ICP functions and
+ * \ref calculatePointNormal() read it directly. Use \ref QuantizedIndex to query it.
+ */
+class QuantizedCloud {
+public:
+    /** \brief Constructor leaving the cloud empty. */
+    QuantizedCloud();
+
+    /** \brief Quantizes \p cloud and optionally \p normals.
+     *
+     * \param[in] cloud   N x 3 points in rows.
+     * \param[in] normals N x 3 normals in rows, or empty.
+     * \param[in] bits    Bits per coordinate, 16 or 21.
+     */
+    explicit QuantizedCloud(CloudT const& cloud, NormalsT const& normals = NormalsT(), int const bits = 16);
+
+    /** \brief Number of points. */
+    Eigen::Index rows() const { return static_cast<Eigen::Index>(_nPoints); }
+    /** \brief Dimension of the points. */
+    Eigen::Index cols() const { return 3; }
+
+    /** \brief Decoded coordinate \p dim of point \p pointId. */
+    double coeff(size_t const pointId, int const dim) const { return _min(dim) + getCode(pointId, dim) * _step(dim); }
+
+    /** \brief Decoded point \p pointId, as a row like CloudT::row(). */
+    Eigen::RowVector3d row(size_t const pointId) const {
+        return Eigen::RowVector3d(coeff(pointId, 0), coeff(pointId, 1), coeff(pointId, 2));
+    }
+
+    /** \brief Decoded point \p pointId. */
+    Eigen::Vector3d getPoint(size_t const pointId) const { return row(pointId).transpose(); }
+
+    /** \brief Check, if the cloud has normals. */
+    bool hasNormals() const { return !_normals.empty(); }
+
+    /** \brief Decoded unit normal of point \p pointId. */
+    Eigen::Vector3d getNormal(size_t const pointId) const { return decodeNormal(_normals[pointId]); }
+
+    /** \brief Decodes all points. */
+    CloudT getVertices() const;
+
+    /** \brief Decodes all normals, empty if the cloud has none. */
+    NormalsT getNormals() const;
+
+    /** \brief Bits per coordinate. */
+    int getBits() const { return _bits; }
+
+    /** \brief Grid step per axis. */
+    Eigen::Vector3d const& getStep() const { return _step; }
+
+    /** \brief Largest distance of a decoded point from the original one, half a grid cell diagonal. */
+    double getMaxError() const { return 0.5 * _step.norm(); }
+
+    /** \brief Memory used by the encoded points and normals. */
+    size_t getBytes() const;
+
+    /** \brief Octahedral code of the direction of \p normal, the closest of the neighbouring codes. */
+    static uint32_t encodeNormal(Eigen::Vector3d const& normal);
+
+    /** \brief Unit normal of octahedral \p code. */
+    static Eigen::Vector3d decodeNormal(uint32_t const code);
+
+protected:
+    //! Mask of a 21 bit coordinate.
+    static uint64_t const MASK_21 = (uint64_t(1) << 21) - 1;
+
+    /** \brief Grid coordinate \p dim of point \p pointId. */
+    uint32_t getCode(size_t const pointId, int const dim) const {
+        return _bits == 16 ? _codes16[3 * pointId + dim]
+                           : static_cast<uint32_t>((_codes21[pointId] >> (21 * dim)) & MASK_21);
+    }
+
+    size_t                _nPoints; //!< Number of points.
+    int                   _bits;    //!< Bits per coordinate, 16 or 21.
+    Eigen::Vector3d       _min;     //!< Minimum corner of the bounding box, grid origin.
+    Eigen::Vector3d       _step;    //!< Grid step per axis.
+    std::vector<uint16_t> _codes16; //!< Interleaved x, y, z grid coordinates, if 16 bits.
+    std::vector<uint64_t> _codes21; //!< x | y << 21 | z << 42 grid coordinates, if 21 bits.
+    std::vector<uint32_t> _normals; //!< Octahedral codes, empty if no normals.
+
+public:
+    // See https://eigen.tuxfamily.org/dox-devel/group__TopicStructHavingEigenMembers.html
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+}; //...class QuantizedCloud
+
+/** \brief KD-tree over the decoded points of a \ref QuantizedCloud.
+ *
+ * Same queries as \ref CloudIndex, decoding the coordinates on the fly, so it can
+ * be the target of \ref alignPointToPoint() without decoding the cloud.
+ * The cloud has to outlive the index.
+ */
+class QuantizedIndex {
+public:
+    /** \brief Builds the tree over \p cloud.
+     *
+     * \param[in] cloud    Quantized points.
+     * \param[in] maxLeafs FLANN parameter, maximum number of points in a leaf.
+     */
+    explicit QuantizedIndex(QuantizedCloud const& cloud, int const maxLeafs = 10);
+
+    ~QuantizedIndex();
+
+    /** \brief Finds the closest indexed point to \p query, see \ref CloudIndex::findNearest(). */
+    bool findNearest(Eigen::Vector3d const& query, size_t &pointId, double &distSqr) const;
+
+    /** \brief Finds the \p k closest points to \p query, see \ref CloudIndex::findNeighbours(). */
+    size_t findNeighbours(
+        Eigen::Vector3d     const& query,
+        size_t              const  k,
+        std::vector<size_t>      & pointIds,
+        std::vector<double>      & distsSqr) const;
+
+    /** \brief Decoded coordinates of point \p pointId. */
+    Eigen::Vector3d getPoint(size_t const pointId) const { return _cloud.getPoint(pointId); }
+
+    /** \brief The indexed cloud. */
+    QuantizedCloud const& getCloud() const { return _cloud; }
+
+    /** \brief Number of indexed points. */
+    size_t size() const { return static_cast<size_t>(_cloud.rows()); }
+
+private:
+    QuantizedIndex(QuantizedIndex const&);            //!< Not copyable, the tree refers to this object.
+    QuantizedIndex& operator=(QuantizedIndex const&); //!< Not copyable, the tree refers to this object.
+
+    struct Tree; //!< Hides nanoflann from the includers of this header.
+
+    QuantizedCloud const& _cloud; //!< The indexed points, not owned.
+    std::unique_ptr<Tree> _tree;  //!< KD-tree over \ref _cloud.
+}; //...class QuantizedIndex
+
+/** @} (IO) */
+
+} //...ns acq
+
+#endif //ACQ_QUANTIZEDCLOUD_H
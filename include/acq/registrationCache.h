@@ -0,0 +1,97 @@
+#ifndef ACQ_REGISTRATIONCACHE_H
+#define ACQ_REGISTRATIONCACHE_H
+
+#include "acq/hash.h"
+#include "acq/icp.h"
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace acq {
+
+/** \addtogroup Registration
+ *  @{
+ */
+
+/** \brief Remembers pairwise ICP results by a hash of everything they depend on.
+ *
+ * Two tiers: the most recently used results are kept in memory, all results
+ * are also written to one small file per key in a directory, so they survive restarts.
+ * A run with the same source and target vertices, initial pose and settings
+ * is answered without ICP. Keys include a version of the alignment, so results of older
+ * builds are not reused once it changes. Safe to use from multiple threads.
+ */
+class RegistrationCache {
+public:
+    /** \brief Constructor.
+     *
+     * \param[in] directory Where results are stored on disk, created if missing.
+     *                      Empty keeps the cache in memory only.
+     * \param[in] capacity  Number of results kept in memory.
+     */
+    explicit RegistrationCache(std::string const& directory = "", size_t const capacity = 1024);
+
+    /** \brief Key of aligning the points hashed to \p sourceHash to the ones hashed to \p targetHash.
+     *
+     * \param[in] sourceHash  \ref hashMatrix() of the moving vertices.
+     * \param[in] targetHash  \ref hashMatrix() of the fixed vertices.
+     * \param[in] initialPose Starting guess of the alignment.
+     * \param[in] params      ICP settings.
+     */
+    static HashT makeKey(
+        HashT     const  sourceHash,
+        HashT     const  targetHash,
+        PoseT     const& initialPose,
+        IcpParams const& params);
+
+    /** \brief Looks up \p key in memory, then on disk.
+     *
+     * \param[in]  key    See \ref makeKey().
+     * \param[out] result The stored result, if found.
+     *
+     * \return True, if \p key was found.
+     */
+    bool find(HashT const key, IcpResult &result);
+
+    /** \brief Stores \p result under \p key in memory and on disk. */
+    void insert(HashT const key, IcpResult const& result);
+
+    /** \brief Drops the memory tier, the files on disk are kept. */
+    void clearMemory();
+
+    /** \brief Number of successful \ref find() calls. */
+    size_t getHits() const { return _hits; }
+
+    /** \brief Number of unsuccessful \ref find() calls. */
+    size_t getMisses() const { return _misses; }
+
+protected:
+    //! Most recently used first.
+    typedef std::list<std::pair<HashT, IcpResult>, Eigen::aligned_allocator<std::pair<HashT, IcpResult> > > LruT;
+
+    /** \brief Moves \p key to the front of the memory tier, evicting the least recently used beyond capacity.
+     *         Expects \ref _mutex to be locked.
+     */
+    void remember(HashT const key, IcpResult const& result);
+
+    /** \brief Path of the file storing \p key. */
+    std::string getPath(HashT const key) const;
+
+    std::string                                 _directory; //!< Disk tier, empty if none.
+    size_t                                      _capacity;  //!< Maximum size of \ref _lru.
+    LruT                                        _lru;       //!< Memory tier.
+    std::unordered_map<HashT, LruT::iterator>   _entries;   //!< Memory tier lookup.
+    std::mutex                                  _mutex;     //!< Guards the memory tier.
+    std::atomic<size_t>                         _hits;      //!< Successful lookups.
+    std::atomic<size_t>                         _misses;    //!< Unsuccessful lookups.
+}; //...class RegistrationCache
+
+/** @} (Registration) */
+
+} //...ns acq
+
+#endif //ACQ_REGISTRATIONCACHE_H
@@ -0,0 +1,310 @@
+#ifndef ACQ_REGISTRATIONPIPELINE_H
+#define ACQ_REGISTRATIONPIPELINE_H
+
+#include "acq/decoratedCloud.h"
+#include "acq/hash.h"
+#include "acq/icp.h"
+#include "acq/loopClosure.h"
+#include "acq/overlap.h"
+#include "acq/poseGraph.h"
+#include "acq/taskGraph.h"
+
+#include <memory>
+#include <vector>
+
+namespace acq {
+
+class CloudIndex;
+class IndexCache;
+class ModelAccumulator;
+class RegistrationCache;
+
+/** \addtogroup Registration
+ *  @{
+ */
+
+/** \brief Registers any number of scans into a common frame.
+ *
+ * Each scan is aligned to its parent in a tree of pairs chosen by the \ref PairingStrategy.
+ * All pairwise alignments are computed between the scans at their initial poses,
+ * so they do not depend on each other and run in parallel.
+ * The world poses are composed from the pairwise results along the tree afterwards.
+ *
+ * Trees, boxes and descriptors of the scans are kept between calls, keyed by the
+ * \ref hashMatrix() "hash" of the scan's points, which every \ref run(), \ref refine(),
+ * \ref refineScan(), \ref closeLoops() and \ref estimateOverlaps() takes again, so scans
+ * may change between the calls of a reused pipeline.
+ */
+class RegistrationPipeline {
+public:
+    /** \brief How to choose the pairs to align. */
+    enum PairingStrategy {
+        SEQUENTIAL,   //!< Chain: every scan is aligned to its neighbour towards the reference.
+        STAR,         //!< Every scan is aligned to the reference directly.
+        SPANNING_TREE,//!< Custom tree, see \ref setSpanningTree().
+        MAX_OVERLAP,  //!< Maximum spanning tree of the overlaps estimated at the initial poses,
+                      //!< see \ref estimateOverlaps().
+        INCREMENTAL   //!< Every scan is aligned to the model merged from the reference
+                      //!< and all scans before it, see \ref ModelAccumulator. Runs serially.
+    };
+
+    /** \brief Result of aligning a scan to its parent. */
+    struct PairResult {
+        int       source; //!< Scan that was moved.
+        int       target; //!< Scan it was aligned to, -1 for the accumulated model.
+        IcpResult icp;    //!< Relative pose from \ref source to \ref target.
+        double    time;   //!< Wall-clock time of the alignment in seconds.
+        bool      cached; //!< True, if \ref icp was found in the \ref RegistrationCache.
+
+    public:
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    }; //...struct PairResult
+
+    //! One entry per registered pair.
+    typedef std::vector<PairResult, Eigen::aligned_allocator<PairResult> > PairResultsT;
+
+    /** \brief Settings of the global refinement, see \ref refine(). */
+    struct RefineParams {
+        double maxDistSqr;      //!< Points further apart (squared) do not count as overlapping.
+        double minOverlap;      //!< Pairs matching a smaller fraction of source points are not connected.
+        int    icpIterations;   //!< ICP iterations re-run per pair, 0 keeps the relative poses as they are.
+        int    graphIterations; //!< Maximum Gauss-Newton iterations on the pose graph.
+
+        RefineParams() : maxDistSqr(0.00001), minOverlap(0.3), icpIterations(5), graphIterations(20) {}
+    }; //...struct RefineParams
+
+    /** \brief Constructor setting the ICP settings used for every pair. */
+    explicit RegistrationPipeline(IcpParams const& params = IcpParams());
+
+    ~RegistrationPipeline();
+
+    /** \brief Appends a scan. The scan is not copied, it has to stay valid while the pipeline is
+     *         used, and must not change during a call.
+     *
+     * \param[in] scan        Points (and optionally faces and normals) of the scan.
+     * \param[in] initialPose Initial guess of the scan's pose in the world frame.
+     *
+     * \return The index of the scan.
+     */
+    int addScan(DecoratedCloud const& scan, PoseT const& initialPose = PoseT::Identity());
+
+    /** \brief Number of scans added. */
+    int getScanCount() const { return static_cast<int>(_scans.size()); }
+
+    /** \brief Answers pairwise alignments from \p cache when their inputs did not change,
+     *         and stores the new ones there. Not owned, nullptr disables caching.
+     *         Not used by \ref INCREMENTAL, whose targets are rebuilt every run.
+     */
+    void setCache(RegistrationCache *cache) { _cache = cache; }
+
+    /** \brief Loads the scan trees from \p indexCache instead of building them, when the scans did not change.
+     *         Not owned, nullptr builds every tree.
+     */
+    void setIndexCache(IndexCache *indexCache) { _indexCache = indexCache; }
+
+    /** \brief Selects the pairs using \p strategy with \p reference as the fixed scan. */
+    void setPairing(PairingStrategy const strategy, int const reference = 0);
+
+    /** \brief Selects a custom tree of pairs.
+     *
+     * \param[in] parents The scan each scan is aligned to, -1 for the (single) reference.
+     */
+    void setSpanningTree(std::vector<int> const& parents);
+
+    /** \brief Sets how overlaps are estimated for \ref MAX_OVERLAP. */
+    void setOverlapParams(OverlapParams const& params) { _overlapParams = params; }
+
+    /** \brief Estimates the overlap of every pair of scans at \p poses.
+     *
+     * Pairs with disjoint oriented bounding boxes get 0 without further work, the others
+     * the mean of the sampled nearest neighbour overlap ratios in both directions.
+     *
+     * \param[in] poses    World pose of each scan.
+     * \param[in] params   Sampling and distance settings.
+     * \param[in] nThreads Number of threads to use, 0 uses all cores.
+     *
+     * \return Symmetric N x N matrix of overlap ratios [0..1], 0 on the diagonal.
+     */
+    Eigen::MatrixXd estimateOverlaps(PosesT const& poses, OverlapParams const& params, unsigned const nThreads = 0);
+
+    /** \brief Runs all pairwise alignments in parallel and composes the world poses.
+     *
+     * Indexing the targets and aligning the pairs run as a \ref TaskGraph,
+     * each pair starts as soon as its target is indexed, see \ref getTaskGraph().
+     *
+     * For \ref INCREMENTAL, the scans are aligned one after the other in index order,
+     * each directly into the world frame.
+     *
+     * \param[in] nThreads Number of threads to use, 0 uses all cores.
+     *
+     * \return One pose per scan, mapping scan coordinates to the reference's world frame.
+     */
+    PosesT run(unsigned const nThreads = 0);
+
+    /** \brief Globally refines \p poses over all overlapping pairs of scans.
+     *
+     * Connects every pair of scans that overlap at \p poses in a \ref PoseGraph, optionally
+     * polishing each pair with a few ICP iterations in parallel first, weights the edges by the
+     * information of their correspondences and optimizes all poses jointly.
+     * Distributes the drift of sequential chains over the loop instead of re-registering.
+     * Pairs estimated to overlap less than half of \p params.minOverlap before polishing
+     * are skipped without running ICP, see \ref estimateOverlaps().
+     *
+     * \param[in] poses    World poses to start from, e.g. the output of \ref run().
+     * \param[in] params   Overlap, ICP and optimization settings.
+     * \param[in] nThreads Number of threads to use, 0 uses all cores.
+     *
+     * \return The refined world poses, the reference keeps its pose.
+     */
+    PosesT refine(PosesT const& poses, RefineParams const& params = RefineParams(), unsigned const nThreads = 0);
+
+    /** \brief Updates the graph of the last \ref refine() after scan \p scanId changed.
+     *
+     * Only the pairs involving \p scanId are re-measured, the other edges are kept.
+     *
+     * \param[in] scanId   The changed scan, its index is rebuilt, if its points changed.
+     * \param[in] params   Overlap, ICP and optimization settings.
+     * \param[in] nThreads Number of threads to use, 0 uses all cores.
+     *
+     * \return The refined world poses.
+     */
+    PosesT refineScan(int const scanId, RefineParams const& params = RefineParams(), unsigned const nThreads = 0);
+
+    /** \brief Finds and closes loops between scans that are not paired yet.
+     *
+     * Extends the graph of the last \ref refine() (or, without one, the tree of the last
+     * \ref run() measured at \p poses) by non-adjacent pairs. Pairs are proposed if they are
+     * estimated to overlap at \p poses, or if their \ref computeGlobalDescriptor() "descriptors"
+     * are among the most similar, which finds revisits even after drift separated them.
+     * Each proposal is verified by a capped ICP in parallel, started from its relative pose at
+     * \p poses. Pairs proposed by their descriptors alone are also started from the alignments of
+     * their principal axes, see \ref computePrincipalAlignments(), and keep the start overlapping
+     * most afterwards. The ones that overlap enough become edges and the poses are optimized jointly.
+     *
+     * \param[in] poses    World poses to start from, e.g. the output of \ref run().
+     * \param[in] params   Proposal, verification and optimization settings.
+     * \param[in] nThreads Number of threads to use, 0 uses all cores.
+     *
+     * \return The optimized world poses, the reference keeps its pose.
+     */
+    PosesT closeLoops(PosesT const& poses, LoopClosureParams const& params = LoopClosureParams(), unsigned const nThreads = 0);
+
+    //! Verified and rejected proposals of the last \ref closeLoops().
+    typedef std::vector<LoopClosure, Eigen::aligned_allocator<LoopClosure> > LoopClosuresT;
+
+    /** \brief Proposals of the last \ref closeLoops(), accepted or not. */
+    LoopClosuresT const& getLoopClosures() const { return _loopClosures; }
+
+    /** \brief The pose graph of the last \ref refine() or \ref closeLoops(). */
+    PoseGraph const& getPoseGraph() const { return _graph; }
+
+    /** \brief Merges model points closer than \p voxelSize for \ref INCREMENTAL,
+     *         bounding the target size by the scanned area. 0 keeps every point.
+     */
+    void setVoxelSize(double const voxelSize) { _voxelSize = voxelSize; }
+
+    /** \brief The model merged by the last \ref INCREMENTAL \ref run(),
+     *         points and (if all scans have them) normals only.
+     */
+    DecoratedCloud getModel() const;
+
+    /** \brief The tasks of the last \ref run() with their timing. */
+    TaskGraph const& getTaskGraph() const { return _tasks; }
+
+    /** \brief Per-pair results of the last \ref run(). */
+    PairResultsT const& getPairResults() const { return _pairResults; }
+
+    /** \brief The scan each scan is aligned to, -1 for the reference. */
+    std::vector<int> getParents() const;
+
+protected:
+    /** \brief Implements \ref run() for \ref INCREMENTAL. */
+    PosesT runIncremental();
+
+    /** \brief Builds the missing indices of \p scanIds in parallel. */
+    void buildIndices(std::vector<int> const& scanIds, unsigned const nThreads);
+
+    /** \brief Builds the index of \p scanId, or loads it from \ref _indexCache. Expects the scan to be hashed. */
+    std::unique_ptr<CloudIndex> makeIndex(int const scanId) const;
+
+    /** \brief Hashes the vertices of every scan, for \ref RegistrationCache and \ref IndexCache keys,
+     *         and drops the index, and updates the box and descriptor, of each scan whose hash changed.
+     */
+    void refreshScans(unsigned const nThreads);
+
+    /** \brief Implements \ref estimateOverlaps() on refreshed scans, see \ref refreshScans(). */
+    Eigen::MatrixXd measureOverlaps(PosesT const& poses, OverlapParams const& params, unsigned const nThreads);
+
+    /** \brief Aligns \p source to the built index of \p target, consulting \ref _cache if set.
+     *
+     * \param[in] source Moving scan.
+     * \param[in] target Fixed scan.
+     * \param[in] guess  Starting relative pose.
+     * \param[in] params ICP settings.
+     */
+    IcpResult alignPair(
+        int       const  source,
+        int       const  target,
+        PoseT     const& guess,
+        IcpParams const& params) const;
+
+    /** \brief Optionally polishes \p relative by at most \p icpIterations of ICP,
+     *         then measures the correspondences of \p source to \p target within \p maxDistSqr.
+     *         The index of \p target has to be built.
+     */
+    CorrespondenceStats verifyPair(
+        int    const  source,
+        int    const  target,
+        PoseT       & relative,
+        int    const  icpIterations,
+        double const  maxDistSqr) const;
+
+    /** \brief Measures the pairs \p pairs at the current graph poses and adds the
+     *         overlapping ones as edges to \ref _graph.
+     */
+    void addGraphEdges(std::vector<std::pair<int, int> > const& pairs, RefineParams const& params, unsigned const nThreads);
+
+    /** \brief The scan that keeps its pose: the reference, or the root of the custom tree. */
+    int getRoot() const;
+
+    IcpParams                            _params;      //!< Settings of every pairwise ICP.
+    std::vector<DecoratedCloud const*>   _scans;       //!< Registered scans, not owned.
+    PosesT                               _initial;     //!< Initial world pose of each scan.
+    PairingStrategy                      _strategy;    //!< How pairs are chosen.
+    int                                  _reference;   //!< Fixed scan for SEQUENTIAL and STAR.
+    std::vector<int>                     _parents;     //!< Custom tree for SPANNING_TREE.
+    PairResultsT                         _pairResults; //!< Filled by \ref run().
+    TaskGraph                            _tasks;       //!< Stages of the last \ref run().
+    double                               _voxelSize;   //!< Model merging resolution for INCREMENTAL.
+    std::unique_ptr<ModelAccumulator>    _model;       //!< Filled by \ref runIncremental().
+    std::vector<std::unique_ptr<CloudIndex> > _indices; //!< Per-scan nearest neighbour index, built on demand.
+    std::vector<OrientedBox>             _boxes;       //!< Per-scan bounding box in scan coordinates, built on demand.
+    OverlapParams                        _overlapParams; //!< Overlap settings for \ref MAX_OVERLAP.
+    PoseGraph                            _graph;       //!< Filled by \ref refine() and \ref closeLoops().
+    std::vector<GlobalDescriptorT>       _descriptors; //!< Per-scan shape descriptor, built on demand.
+    RegistrationCache                   *_cache;       //!< Pairwise results by content, not owned.
+    IndexCache                          *_indexCache;  //!< Scan trees by content, not owned.
+    std::vector<HashT>                   _hashes;      //!< Per-scan vertex hash, see \ref refreshScans().
+    LoopClosuresT                        _loopClosures; //!< Filled by \ref closeLoops().
+}; //...class RegistrationPipeline
+
+/** \brief Merges scans into a single cloud after moving each to its pose.
+ *
+ * Face indices are offset to keep referring to their own scan's vertices,
+ * normals are kept only if every scan has them.
+ *
+ * \param[in] scans Scans to merge, in output order.
+ * \param[in] poses One pose per scan.
+ *
+ * \return The concatenated vertices, faces and normals.
+ */
+DecoratedCloud
+concatenateClouds(
+    std::vector<DecoratedCloud const*> const& scans,
+    PosesT                             const& poses);
+
+/** @} (Registration) */
+
+} //...ns acq
+
+#endif //ACQ_REGISTRATIONPIPELINE_H
@@ -0,0 +1,162 @@
+#ifndef ACQ_SCANMANIFEST_H
+#define ACQ_SCANMANIFEST_H
+
+#include "acq/cloudManager.h"
+#include "acq/icp.h"
+#include "acq/registrationPipeline.h"
+
+#include <string>
+#include <vector>
+
+namespace acq {
+
+/** \addtogroup IO
+ *  @{
+ */
+
+/** \brief One scan of a \ref ScanManifest, with its initial pose and preprocessing. */
+struct ScanEntry {
+    std::string     path;             //!< Scan file, OFF, PLY or cloud file (.acqc).
+    PoseT           pose;             //!< Initial world pose, applied after centring and \ref rotation.
+    Eigen::Vector3d rotation;         //!< Rotation of the centred scan, radians around x, y and z.
+    int             parent;           //!< Scan to align to, -1 for the root, -2 if not given.
+    double          voxelSize;        //!< Downsampling voxel size, 0 keeps all points.
+    int             normalNeighbours; //!< Neighbours to estimate normals from, 0 keeps the normals read.
+
+    ScanEntry()
+        : pose(PoseT::Identity()), rotation(Eigen::Vector3d::Zero()),
+          parent(-2), voxelSize(0.), normalNeighbours(0)
+    {}
+
+public:
+    // See https://eigen.tuxfamily.org/dox-devel/group__TopicStructHavingEigenMembers.html
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+}; //...struct ScanEntry
+
+//! Scans in manifest order.
+typedef std::vector<ScanEntry, Eigen::aligned_allocator<ScanEntry> > ScanEntriesT;
+
+/** \brief A registration job: the scans, their initial poses, how to pair them and the settings.
+ *
+ * Read by \ref readScanManifest() from a text file, one setting or scan per line,
+ * '#' starts a comment:
+ * \code
+ * acqscans 1
+ * threads    0              # 0 sizes the worker pools to the scans and the cores
+ * pairing    max_overlap 2  # sequential | star | max_overlap | incremental, and the reference scan
+ * iterations 250            # IcpParams, also: step, maxDistSqr, minError, minImprovement
+ * modelVoxel 0.001          # Model resolution of incremental pairing
+ * scan bun000.off rotate 0 -90 0 voxel 0.0005
+ * scan scans/part_*.ply normals 10 parent 0
+ * scan top2.off pose 1 0 0 0  0 1 0 0  0 0 1 0.1
+ * \endcode
+ * A scan path may be a glob, expanding to its matches in sorted order with the same options.
+ * Relative paths are relative to the manifest. Scan options:
+ *  - <tt>pose</tt> followed by the 3 x 4 initial world pose in row-major order,
+ *  - <tt>rotate x y z</tt> rotation in radians, applied before the pose,
+ *  - <tt>parent i</tt> the scan to align to, -1 for the root; given for one scan, it has to be
+ *    given for all, and replaces the pairing strategy by this tree,
+ *  - <tt>voxel v</tt> downsampling after reading, see \ref downsampleCloud(),
+ *  - <tt>normals k</tt> normals estimated from k neighbours after reading, or from the faces
+ *    for meshes still having them, see \ref DecoratedCloud::estimateNormalsFromFaces().
+ *
+ * Every scan is centred on its mean before it is rotated and posed, whether it is rotated or
+ * not, see \ref getInitialPose().
+ */
+struct ScanManifest {
+    ScanEntriesT                          scans;      //!< Scans in order, globs expanded.
+    RegistrationPipeline::PairingStrategy pairing;    //!< How to choose the pairs.
+    int                                   reference;  //!< Fixed scan of the pairing strategy.
+    unsigned                              nThreads;   //!< Worker threads, 0 sizes them to the job.
+    IcpParams                             icp;        //!< Settings of every pairwise ICP.
+    double                                modelVoxel; //!< Model resolution for INCREMENTAL pairing.
+    std::string                           directory;  //!< Directory of the manifest file, empty for the working directory.
+
+    ScanManifest()
+        : pairing(RegistrationPipeline::SEQUENTIAL), reference(0), nThreads(0), modelVoxel(0.)
+    {}
+
+    /** \brief Paths of the scans in order. */
+    std::vector<std::string> getPaths() const;
+
+    /** \brief Worker threads to use: the configured ones, or one per scan up to the cores. */
+    unsigned getThreadCount() const;
+
+    /** \brief True, if the scans name their parents instead of using \ref pairing. */
+    bool hasParents() const;
+
+    /** \brief \p path relative to the manifest's \ref directory, unless it is absolute, e.g. for caches of the job. */
+    std::string resolvePath(std::string const& path) const;
+
+public:
+    // See https://eigen.tuxfamily.org/dox-devel/group__TopicStructHavingEigenMembers.html
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+}; //...struct ScanManifest
+
+/** \brief Reads a scan manifest, see \ref ScanManifest for the format.
+ *
+ * \param[in ] path     Manifest file.
+ * \param[out] manifest The job, globs expanded and paths made relative to the working directory.
+ *
+ * \return False, if the file could not be read, or has an invalid line, a glob matching
+ *         nothing or an invalid reference or parent. The first problem is printed.
+ */
+bool
+readScanManifest(
+    std::string  const& path,
+    ScanManifest      & manifest);
+
+/** \brief Reads and preprocesses the scans of \p manifest into consecutive cloud slots.
+ *
+ * Every scan is a "load" task and a "prepare" task depending on it in a \ref TaskGraph, so a
+ * scan is downsampled, given normals as it asks for and its point spacing estimated, see
+ * \ref DecoratedCloud::estimateSpacing(), as soon as its own file is read, while the other files
+ * are still loading. Files are read by \ref CloudManager::loadClouds() with the configured
+ * threads, or all cores split between the files and the chunks of large files, the
+ * preprocessing runs on one thread per scan, see \ref ScanManifest::getThreadCount().
+ *
+ * \param[in ] manifest     The scans.
+ * \param[out] cloudManager Receives scan i at slot \p firstIndex + i.
+ * \param[in ] firstIndex   Slot of the first scan.
+ * \param[out] stats        Optional per-file read statistics.
+ * \param[in ] onLoaded     Optional progress callback, see \ref CloudManager::loadClouds().
+ * \param[out] tasks        Optional graph to run on, keeps the per-task timing. Cleared first.
+ *
+ * \return Number of scans that could not be read.
+ */
+size_t
+loadManifestScans(
+    ScanManifest                const& manifest,
+    CloudManager                     & cloudManager,
+    int                         const  firstIndex,
+    std::vector<ReadStats>           * stats    = nullptr,
+    CloudManager::LoadCallbackT const& onLoaded = CloudManager::LoadCallbackT(),
+    TaskGraph                        * tasks    = nullptr);
+
+/** \brief Initial world pose of \p entry: \p vertices moved to their mean's origin, rotated, then posed.
+ *
+ * The translation to the mean applies to every scan, also without \ref ScanEntry::rotation, so
+ * unrotated scans meet the rotated ones at the origin.
+ */
+PoseT
+getInitialPose(
+    ScanEntry const& entry,
+    CloudT    const& vertices);
+
+/** \brief Adds \p scans to \p pipeline at their initial poses and sets the pairing of \p manifest.
+ *
+ * \param[in ] manifest The job.
+ * \param[in ] scans    The loaded scans, in manifest order, have to outlive \p pipeline.
+ * \param[out] pipeline Pipeline to set up, should have no scans yet.
+ */
+void
+setupPipeline(
+    ScanManifest                       const& manifest,
+    std::vector<DecoratedCloud const*> const& scans,
+    RegistrationPipeline                    & pipeline);
+
+/** @} (IO) */
+
+} //...ns acq
+
+#endif //ACQ_SCANMANIFEST_H
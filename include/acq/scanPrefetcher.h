@@ -0,0 +1,140 @@
+#ifndef ACQ_SCANPREFETCHER_H
+#define ACQ_SCANPREFETCHER_H
+
+#include "acq/decoratedCloud.h"
+#include "acq/meshIO.h"
+#include "acq/registrationPipeline.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace acq {
+
+class CloudIndex;
+
+/** \addtogroup IO
+ *  @{
+ */
+
+/** \brief Settings of a \ref ScanPrefetcher. */
+struct PrefetchParams {
+    size_t   capacity;    //!< Maximum number of prepared scans waiting to be consumed, at least 1.
+    double   voxelSize;   //!< Keeps one point per voxel of this edge length, 0 keeps all points.
+    int      maxLeafs;    //!< FLANN parameter of the built index.
+    unsigned readThreads; //!< Threads parsing each OFF file, see \ref readMesh().
+
+    PrefetchParams() : capacity(2), voxelSize(0.), maxLeafs(10), readThreads(1) {}
+}; //...struct PrefetchParams
+
+/** \brief A scan read, downsampled and indexed by a \ref ScanPrefetcher. */
+struct PrefetchedScan {
+    size_t                      scanId;      //!< Position of \ref path in the list.
+    std::string                 path;        //!< File the scan was read from.
+    bool                        ok;          //!< False, if the file could not be read, \ref index is empty then.
+    DecoratedCloud              cloud;       //!< Downsampled points, faces are dropped if any point was.
+    std::unique_ptr<CloudIndex> index;       //!< Nearest neighbour index over \ref cloud.
+    ReadStats                   readStats;   //!< Parse timing.
+    double                      prepareTime; //!< Seconds spent downsampling and indexing.
+
+    PrefetchedScan();
+    ~PrefetchedScan();
+
+public:
+    // See https://eigen.tuxfamily.org/dox-devel/group__TopicStructHavingEigenMembers.html
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+}; //...struct PrefetchedScan
+
+/** \brief Reads scans ahead on a background thread while the caller works on the current one.
+ *
+ * The thread reads, downsamples and indexes the files in order and puts them into a
+ * queue of at most \ref PrefetchParams::capacity scans, waiting while it is full.
+ * This bounds memory to the consumed scans plus the queue, and overlaps loading
+ * scan k + 1 with aligning scan k. The thread stops early, when the prefetcher is destroyed.
+ */
+class ScanPrefetcher {
+public:
+    /** \brief Starts prefetching \p paths in order. */
+    explicit ScanPrefetcher(std::vector<std::string> const& paths, PrefetchParams const& params = PrefetchParams());
+
+    /** \brief Stops the thread after the scan in progress. */
+    ~ScanPrefetcher();
+
+    /** \brief Takes the next scan in order, waiting if it is not ready yet.
+     *
+     * \return The scan, or nullptr after the last one.
+     */
+    std::unique_ptr<PrefetchedScan> next();
+
+    /** \brief Number of files to prefetch. */
+    size_t size() const { return _paths.size(); }
+
+    /** \brief Seconds \ref next() spent waiting for scans, i.e. loading not hidden behind other work. */
+    double getWaitTime() const { return _waitTime; }
+
+protected:
+    ScanPrefetcher(ScanPrefetcher const&);            //!< Not copyable, the thread refers to this object.
+    ScanPrefetcher& operator=(ScanPrefetcher const&); //!< Not copyable, the thread refers to this object.
+
+    /** \brief Body of the background thread. */
+    void prefetch();
+
+    std::vector<std::string>                     _paths;    //!< Files in order.
+    PrefetchParams                               _params;   //!< Settings.
+    std::deque<std::unique_ptr<PrefetchedScan> > _queue;    //!< Prepared scans, oldest first.
+    size_t                                       _consumed; //!< Number of scans returned by \ref next().
+    bool                                         _stop;     //!< Set by the destructor.
+    double                                       _waitTime; //!< See \ref getWaitTime().
+    std::mutex                                   _mutex;    //!< Guards \ref _queue and \ref _stop.
+    std::condition_variable                      _ready;    //!< Signalled when a scan was queued.
+    std::condition_variable                      _space;    //!< Signalled when a scan was taken or on stop.
+    std::thread                                  _thread;   //!< Runs \ref prefetch(), started last.
+}; //...class ScanPrefetcher
+
+/** \brief Keeps the first point of \p cloud falling into each voxel of edge length \p voxelSize.
+ *
+ * Points keep their order and normals. Faces are kept only if no point was dropped.
+ *
+ * \return The subset of \p cloud, or a copy of it for a non-positive \p voxelSize.
+ */
+DecoratedCloud
+downsampleCloud(
+    DecoratedCloud const& cloud,
+    double         const  voxelSize);
+
+/** @} (IO) */
+
+/** \addtogroup Registration
+ *  @{
+ */
+
+/** \brief Registers the scans of \p prefetcher as a chain, aligning each one to the one before.
+ *
+ * Only the previous scan and the prefetched ones are held in memory, and loading the
+ * next scans overlaps with aligning the current one. Equivalent to
+ * \ref RegistrationPipeline::SEQUENTIAL with the first scan as the reference.
+ * Scans that could not be read keep the pose of the scan before them and are skipped as targets.
+ *
+ * \param[in]  prefetcher   Source of the scans, consumed completely.
+ * \param[in]  params       ICP settings of every pair.
+ * \param[in]  initialPoses Optional initial world pose per scan, identity if empty.
+ * \param[out] pairResults  Optional per-pair ICP results and timings.
+ *
+ * \return One world pose per scan, the first scan keeps its initial pose.
+ */
+PosesT
+registerSequence(
+    ScanPrefetcher                      & prefetcher,
+    IcpParams                      const& params,
+    PosesT                         const& initialPoses = PosesT(),
+    RegistrationPipeline::PairResultsT  * pairResults  = nullptr);
+
+/** @} (Registration) */
+
+} //...ns acq
+
+#endif //ACQ_SCANPREFETCHER_H
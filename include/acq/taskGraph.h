@@ -0,0 +1,102 @@
+#ifndef ACQ_TASKGRAPH_H
+#define ACQ_TASKGRAPH_H
+
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace acq {
+
+/** \addtogroup Parallel
+ *  @{
+ */
+
+/** \brief Runs named tasks as soon as the tasks they depend on have finished.
+ *
+ * Stages with data dependencies (e.g. index a scan, then align other scans to it)
+ * are added as tasks and edges of a directed acyclic graph.
+ * \ref run() executes the graph on a work-stealing pool: every worker keeps its own
+ * deque of ready tasks, pushes the tasks it unlocks to its back and works on them
+ * first (their inputs are still in its cache), idle workers steal from the front
+ * of the others' deques. The wall-clock time of every task is recorded.
+ */
+class TaskGraph {
+public:
+    //! Handle of a task, its position in the order of \ref addTask() calls.
+    typedef size_t TaskId;
+    //! Work of a task.
+    typedef std::function<void()> WorkT;
+
+    /** \brief When and where a task ran in the last \ref run(). */
+    struct TaskStats {
+        std::string name;     //!< Name given in \ref addTask().
+        double      start;    //!< Seconds after the start of \ref run().
+        double      duration; //!< Wall-clock time of the task in seconds.
+        unsigned    worker;   //!< Worker that executed the task, 0 is the calling thread.
+
+        TaskStats() : start(0.), duration(0.), worker(0) {}
+    }; //...struct TaskStats
+
+    //! One entry per task, in \ref TaskId order.
+    typedef std::vector<TaskStats> TaskStatsT;
+
+    TaskGraph();
+
+    /** \brief Appends a task.
+     *
+     * \param[in] name Shown in the statistics.
+     * \param[in] work Called once, on any worker thread.
+     *
+     * \return Handle to refer to the task in \ref addDependency().
+     */
+    TaskId addTask(std::string const& name, WorkT const& work);
+
+    /** \brief Makes \p after wait until \p before has finished. */
+    void addDependency(TaskId const before, TaskId const after);
+
+    /** \brief Executes every task once, respecting the dependencies.
+     *
+     * The first exception thrown by a task is rethrown in the calling thread,
+     * after the tasks already running have finished. Tasks not started by then
+     * are skipped. Throws, if the dependencies contain a cycle.
+     *
+     * \param[in] nThreads Number of threads to use, 0 means \ref defaultThreadCount().
+     */
+    void run(unsigned const nThreads = 0);
+
+    /** \brief Number of tasks added. */
+    size_t size() const { return _tasks.size(); }
+
+    /** \brief Removes all tasks and statistics. */
+    void clear();
+
+    /** \brief Per-task timing of the last \ref run(). */
+    TaskStatsT const& getStats() const { return _stats; }
+
+    /** \brief Wall-clock time of the last \ref run() in seconds. */
+    double getWallTime() const { return _wallTime; }
+
+    /** \brief Prints one line per task and the total to \p os. */
+    void printStats(std::ostream &os) const;
+
+protected:
+    /** \brief A node of the graph. */
+    struct Task {
+        std::string         name;         //!< Shown in the statistics.
+        WorkT               work;         //!< What to do.
+        std::vector<TaskId> successors;   //!< Tasks waiting for this one.
+        int                 dependencies; //!< Number of tasks this one waits for.
+    }; //...struct Task
+
+    std::vector<Task> _tasks;    //!< Nodes, in \ref TaskId order.
+    TaskStatsT        _stats;    //!< Filled by \ref run().
+    double            _wallTime; //!< Filled by \ref run().
+}; //...class TaskGraph
+
+/** @} (Parallel) */
+
+} //...ns acq
+
+#endif //ACQ_TASKGRAPH_H
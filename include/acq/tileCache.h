@@ -0,0 +1,150 @@
+#ifndef ACQ_TILECACHE_H
+#define ACQ_TILECACHE_H
+
+#include "acq/cloudFile.h"
+#include "acq/icp.h"
+#include "acq/tiledCloud.h"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace acq {
+
+class CloudIndex;
+
+/** \addtogroup Registration
+ *  @{
+ */
+
+/** \brief Keeps the KD-trees of recently used tiles of a \ref TiledCloud within a memory budget.
+ *
+ * Tiles are mapped on first use, restoring the KD-tree stored in the tile or else building it,
+ * and evicted least recently used first, once the estimated size of the resident tiles
+ * exceeds the budget. Evicted tiles still in use by
+ * another thread stay alive until released, so the budget can be exceeded by the tiles the
+ * threads hold. Nearest neighbour queries search all tiles within the rejection distance,
+ * so they are exact across tile borders. Thread-safe, batches of queries hold their tiles in
+ * \ref PinnedT, so they only lock on the first use of a tile.
+ */
+class TileCache {
+public:
+    /** \brief A mapped tile and its index. */
+    struct Tile {
+        CloudFile                   file;  //!< Points of the tile.
+        std::unique_ptr<CloudIndex> index; //!< KD-tree over the mapped points.
+        size_t                      bytes; //!< Estimated memory of points and tree.
+
+        Tile();
+        ~Tile();
+    }; //...struct Tile
+
+    //! Tiles held by a batch of queries, indexed by tile id, empty for the ones not used yet.
+    typedef std::vector<std::shared_ptr<Tile const> > PinnedT;
+
+    /** \brief Constructor setting the cloud and the budget.
+     *
+     * \param[in] cloud       Tiled target cloud, has to outlive the cache.
+     * \param[in] budgetBytes Memory the resident tiles should stay within.
+     * \param[in] maxLeafs    FLANN parameter of the tile trees, stored trees of other leaf sizes are rebuilt.
+     */
+    TileCache(TiledCloud const& cloud, size_t const budgetBytes, int const maxLeafs = TileWriter::INDEX_MAX_LEAFS);
+
+    ~TileCache();
+
+    /** \brief Returns tile \p tileId, loading it (and evicting others) if it is not resident. */
+    std::shared_ptr<Tile const> acquire(int const tileId);
+
+    /** \brief Finds the closest point to \p query closer than sqrt(\p maxDistSqr).
+     *
+     * \param[in]     query      3D query point.
+     * \param[in]     maxDistSqr Squared search radius, only tiles within it are searched.
+     * \param[out]    point      Closest point.
+     * \param[out]    distSqr    Its squared distance.
+     * \param[in,out] pinned     Optional tiles of the batch, e.g. of one thread, the tiles searched
+     *                           are acquired once and kept, so the queries to them take no lock.
+     *                           Releasing it lets evicted tiles go.
+     *
+     * \return False, if no point is within the radius.
+     */
+    bool findNearest(
+        Eigen::Vector3d const& query,
+        double          const  maxDistSqr,
+        Eigen::Vector3d      & point,
+        double               & distSqr,
+        PinnedT              * pinned = nullptr);
+
+    /** \brief The tiled cloud. */
+    TiledCloud const& getCloud() const { return _cloud; }
+
+    /** \brief Estimated memory of the resident tiles. */
+    size_t getResidentBytes() const { return _residentBytes; }
+    /** \brief Largest \ref getResidentBytes() so far. */
+    size_t getPeakBytes() const { return _peakBytes; }
+    /** \brief Number of tile loads. */
+    size_t getLoads() const { return _loads; }
+    /** \brief Number of requests answered by a resident tile. */
+    size_t getHits() const { return _hits; }
+    /** \brief Number of tiles evicted. */
+    size_t getEvictions() const { return _evictions; }
+
+protected:
+    TileCache(TileCache const&);            //!< Not copyable.
+    TileCache& operator=(TileCache const&); //!< Not copyable.
+
+    //! Least recently used first.
+    typedef std::list<int> UsageT;
+
+    /** \brief A resident tile and its position in \ref _usage. */
+    struct Entry {
+        std::shared_ptr<Tile const> tile;  //!< The loaded tile.
+        UsageT::iterator            usage; //!< Position in \ref _usage.
+    }; //...struct Entry
+
+    TiledCloud const&               _cloud;         //!< Tiles to load.
+    size_t                          _budgetBytes;   //!< Memory budget.
+    int                             _maxLeafs;      //!< FLANN parameter.
+    std::mutex                      _mutex;         //!< Guards \ref _entries, \ref _usage and \ref _residentBytes.
+    std::unordered_map<int, Entry>  _entries;       //!< { tile id => resident tile }.
+    UsageT                          _usage;         //!< Resident tile ids, least recently used first.
+    size_t                          _residentBytes; //!< Estimated memory of \ref _entries.
+    size_t                          _peakBytes;     //!< Largest \ref _residentBytes.
+    std::atomic<size_t>             _loads;         //!< See \ref getLoads().
+    std::atomic<size_t>             _hits;          //!< See \ref getHits().
+    std::atomic<size_t>             _evictions;     //!< See \ref getEvictions().
+}; //...class TileCache
+
+/** \brief Aligns a tiled cloud to another by point-to-point ICP, out of core.
+ *
+ * Every iteration streams the source tiles through the correspondence search in parallel,
+ * each thread mapping one source tile at a time and querying the target through \p target,
+ * holding the target tiles it uses until the source tile is done, see \ref TileCache::PinnedT.
+ * The correspondences of a tile are reduced to \ref CorrespondenceSums right away,
+ * so memory is bounded by the target budget plus one mapped source tile and the target tiles
+ * near it per thread, whatever the size of the clouds. Source tiles whose moved bounding box is further than
+ * the rejection distance from every target tile are skipped.
+ *
+ * \param[in] source      Moving tiled cloud.
+ * \param[in] target      Resident tiles of the fixed cloud.
+ * \param[in] initialPose Starting guess transforming \p source onto the target.
+ * \param[in] params      Iteration, sampling and rejection settings.
+ * \param[in] nThreads    Number of threads to use, 0 uses all cores.
+ *
+ * \return The best pose found, and its residual.
+ */
+IcpResult
+alignTiled(
+    TiledCloud const& source,
+    TileCache       & target,
+    PoseT      const& initialPose,
+    IcpParams  const& params,
+    unsigned   const  nThreads = 0);
+
+/** @} (Registration) */
+
+} //...ns acq
+
+#endif //ACQ_TILECACHE_H
@@ -0,0 +1,160 @@
+#ifndef ACQ_TILEDCLOUD_H
+#define ACQ_TILEDCLOUD_H
+
+#include "acq/typedefs.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace acq {
+
+/** \addtogroup IO
+ *  @{
+ */
+
+/** \brief One tile of a \ref TiledCloud: the points inside a cube of the tiling grid. */
+struct TileInfo {
+    Eigen::Vector3i cell;  //!< Grid cell, floor(point / tileSize) per axis.
+    size_t          count; //!< Number of points.
+    Eigen::Vector3d min;   //!< Minimum corner of the points' bounding box.
+    Eigen::Vector3d max;   //!< Maximum corner of the points' bounding box.
+    std::string     file;  //!< \ref CloudFile of the points, relative to the tile directory.
+
+    TileInfo() : cell(Eigen::Vector3i::Zero()), count(0), min(Eigen::Vector3d::Zero()), max(Eigen::Vector3d::Zero()) {}
+}; //...struct TileInfo
+
+//! Tiles of a \ref TiledCloud.
+typedef std::vector<TileInfo> TileInfosT;
+
+/** \brief Key of grid cell \p cell, 21 bits per axis as for voxels in \ref ModelAccumulator. */
+inline uint64_t
+getCellKey(Eigen::Vector3i const& cell) {
+    uint64_t const mask = (uint64_t(1) << 21) - 1;
+    return (static_cast<uint64_t>(cell(0)) & mask)
+           | (static_cast<uint64_t>(cell(1)) & mask) << 21
+           | (static_cast<uint64_t>(cell(2)) & mask) << 42;
+} //...getCellKey()
+
+/** \brief Partitions a cloud streamed in chunks into spatial tiles on disk.
+ *
+ * Points are sorted into the cubes of a grid with edge length tileSize. Each cube's points
+ * are buffered and appended to a spill file once the buffers hold \p bufferPoints points,
+ * so memory stays bounded whatever the size of the input. \ref finish() turns every spill
+ * file into a \ref CloudFile, one tile at a time, and writes the manifest read by \ref TiledCloud.
+ * Tiles hold points and their KD-tree, which \ref TileCache maps instead of building it.
+ */
+class TileWriter {
+public:
+    //! Leaf size of the KD-trees stored with the tiles.
+    static int const INDEX_MAX_LEAFS = 10;
+
+    /** \brief Constructor setting the output.
+     *
+     * \param[in] directory    Output directory, created if missing. Existing tiles are overwritten.
+     * \param[in] tileSize     Edge length of the tiles.
+     * \param[in] bufferPoints Number of points buffered in memory before spilling to disk.
+     */
+    TileWriter(std::string const& directory, double const tileSize, size_t const bufferPoints = size_t(1) << 22);
+
+    /** \brief Sorts \p points into their tiles. */
+    bool addPoints(Eigen::Ref<CloudT const> const& points);
+
+    /** \brief Writes the tile files and the manifest.
+     *
+     * \return False, if any file could not be written.
+     */
+    bool finish();
+
+    /** \brief Number of points added so far. */
+    size_t getPointCount() const { return _nPoints; }
+
+protected:
+    /** \brief Appends the buffered points to the spill files and empties the buffers. */
+    bool flush();
+
+    /** \brief Spill file of the tile \p tileId. */
+    std::string getSpillPath(size_t const tileId) const;
+
+    std::string                          _directory;    //!< Output directory.
+    double                               _tileSize;     //!< Grid edge length.
+    size_t                               _bufferPoints; //!< Points buffered before spilling.
+    size_t                               _nBuffered;    //!< Points currently buffered.
+    size_t                               _nPoints;      //!< Points added so far.
+    TileInfosT                           _tiles;        //!< Tiles seen so far, with their bounds.
+    std::unordered_map<uint64_t, size_t> _cells;        //!< { cell key => tile id }.
+    std::vector<std::vector<double> >    _buffers;      //!< Interleaved x, y, z waiting per tile.
+    std::vector<char>                    _spilled;      //!< Whether the spill file of a tile was started.
+    bool                                 _ok;           //!< False, once writing failed.
+}; //...class TileWriter
+
+/** \brief A cloud partitioned into spatial tiles on disk by a \ref TileWriter.
+ *
+ * Only the manifest is read, tiles are mapped on demand via \ref getTilePath(),
+ * so clouds larger than memory can be processed tile by tile.
+ */
+class TiledCloud {
+public:
+    /** \brief Constructor leaving the cloud empty. */
+    TiledCloud();
+
+    /** \brief Constructor opening \p directory, check \ref getTiles() for success. */
+    explicit TiledCloud(std::string const& directory);
+
+    /** \brief Reads the manifest of \p directory.
+     *
+     * \return False, if the manifest is missing or invalid.
+     */
+    bool open(std::string const& directory);
+
+    /** \brief Edge length of the tiles. */
+    double getTileSize() const { return _tileSize; }
+
+    /** \brief All tiles, in the order they were first seen in the input. */
+    TileInfosT const& getTiles() const { return _tiles; }
+
+    /** \brief Total number of points. */
+    size_t getPointCount() const { return _nPoints; }
+
+    /** \brief Path of the \ref CloudFile of tile \p tileId. */
+    std::string getTilePath(size_t const tileId) const;
+
+    /** \brief Grid cell containing \p point. */
+    Eigen::Vector3i getCell(Eigen::Vector3d const& point) const;
+
+    /** \brief Tile of grid cell \p cell, -1 if the cell holds no points. */
+    int findTile(Eigen::Vector3i const& cell) const;
+
+protected:
+    std::string                       _directory; //!< Directory of the manifest and the tiles.
+    double                            _tileSize;  //!< Grid edge length.
+    size_t                            _nPoints;   //!< Sum of the tile sizes.
+    TileInfosT                        _tiles;     //!< Manifest entries.
+    std::unordered_map<uint64_t, int> _cells;     //!< { cell key => tile id }.
+}; //...class TiledCloud
+
+/** \brief Tiles a PLY, OFF or \ref CloudFile into \p directory, see \ref TileWriter.
+ *
+ * PLY and cloud files are streamed, so they can be larger than memory.
+ * OFF files are read whole.
+ *
+ * \param[in] input        Cloud to tile.
+ * \param[in] directory    Output directory.
+ * \param[in] tileSize     Edge length of the tiles.
+ * \param[in] bufferPoints Number of points buffered in memory before spilling to disk.
+ *
+ * \return False, if the input could not be read or a tile could not be written.
+ */
+bool
+tileCloudFile(
+    std::string const& input,
+    std::string const& directory,
+    double      const  tileSize,
+    size_t      const  bufferPoints = size_t(1) << 22);
+
+/** @} (IO) */
+
+} //...ns acq
+
+#endif //ACQ_TILEDCLOUD_H
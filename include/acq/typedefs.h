@@ -17,8 +17,7 @@
 //EIGEN_DEFINE_STL_VECTOR_SPECIALIZATION(Eigen::Vector4f)
 //EIGEN_DEFINE_STL_VECTOR_SPECIALIZATION(Eigen::Vector4d)
 
-#include <map>
-#include <set>
+#include <vector>
 
 namespace acq {
 
@@ -29,10 +28,18 @@ typedef Eigen::MatrixXd NormalsT;
 //! Dynamically sized matrix of face vertex indices in rows.
 typedef Eigen::MatrixXi FacesT;
 
-/** \brief An associative storage of neighbour indices for point cloud
- * { pointId => [neighbourId_0, nId_1, ... nId_k-1] }
+class Neighbours;
+/** \brief Neighbour indices of all points of a point cloud in CSR layout,
+ * { pointId => [neighbourId_0, nId_1, ... nId_k-1] }, see acq/neighbours.h.
  */
-typedef std::map<int, std::set<size_t> > NeighboursT;
+typedef Neighbours NeighboursT;
+
+//! Rigid transformation in homogeneous coordinates, mapping scan coordinates to world coordinates.
+typedef Eigen::Matrix4d PoseT;
+//! List of poses, one per scan. Needs the aligned allocator, see the note above.
+typedef std::vector<PoseT, Eigen::aligned_allocator<PoseT> > PosesT;
+//! Information (inverse covariance) of a pose measurement, rotation first, then translation.
+typedef Eigen::Matrix<double, 6, 6> InformationT;
 
 } //...ns acq
 
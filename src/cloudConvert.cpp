@@ -0,0 +1,77 @@
+#include "acq/cloudFile.h"
+#include "acq/cloudIndex.h"
+#include "acq/meshIO.h"
+#include "acq/tiledCloud.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+/** \brief Converts OFF and PLY meshes to binary cloud files, see acq::CloudFile.
+ *
+ * Usage: cloudConvert input.off|input.ply output.acqc [input2 output2 ...]
+ * The files store a KD-tree of the vertices along, see acq::CloudFile::loadIndex().
+ * Reports the read throughput of the inputs and the load time of the written files.
+ *
+ * Usage: cloudConvert --tile tileSize input.ply|input.acqc|input.off outputDirectory
+ * Partitions a cloud, possibly larger than memory, into spatial tiles, see acq::TiledCloud.
+ */
+int main(int argc, char *argv[]) {
+    typedef std::chrono::steady_clock ClockT;
+
+    if (argc == 5 && std::string(argv[1]) == "--tile") {
+        ClockT::time_point const start = ClockT::now();
+        if (!acq::tileCloudFile(argv[3], argv[4], std::atof(argv[2]))) {
+            std::cerr << "Could not tile " << argv[3] << "\n";
+            return EXIT_FAILURE;
+        }
+        acq::TiledCloud const tiles(argv[4]);
+        std::cout << argv[3] << " -> " << argv[4] << ": " << tiles.getPointCount() << " points in "
+                  << tiles.getTiles().size() << " tiles, "
+                  << std::chrono::duration<double>(ClockT::now() - start).count() << " s" << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    if (argc < 3 || argc % 2 == 0) {
+        std::cerr << "Usage: " << argv[0] << " input.off|input.ply output.acqc [input2 output2 ...]\n"
+                  << "       " << argv[0] << " --tile tileSize input.ply|input.acqc|input.off outputDirectory\n";
+        return EXIT_FAILURE;
+    }
+
+    int nFailed = 0;
+    for (int arg = 1; arg + 1 < argc; arg += 2) {
+        std::string const input(argv[arg]), output(argv[arg + 1]);
+
+        ClockT::time_point const start = ClockT::now();
+        acq::DecoratedCloud cloud;
+        acq::ReadStats      readStats;
+        if (!acq::readMesh(input, cloud, &readStats) || !acq::writeCloudFile(output, cloud, 10)) {
+            std::cerr << "Could not convert " << input << "\n";
+            ++nFailed;
+            continue;
+        }
+        ClockT::time_point const written = ClockT::now();
+
+        // Check the result and time the binary load, tree included
+        acq::CloudFile file(output);
+        bool const same = file.isOpen()
+                          && file.getVertices() == cloud.getVertices()
+                          && file.getFaces() == cloud.getFaces()
+                          && (!cloud.getVertices().rows() || file.loadIndex(10));
+        double const loadTime = std::chrono::duration<double>(ClockT::now() - written).count();
+
+        std::cout << input << " -> " << output << ": "
+                  << cloud.getVertices().rows() << " vertices, "
+                  << cloud.getFaces().rows() << " faces"
+                  << (cloud.hasNormals() ? ", normals" : "")
+                  << ", converted in " << std::chrono::duration<double>(written - start).count() << " s"
+                  << (readStats.seconds > 0. ? " (read " + std::to_string(readStats.getThroughput()) + " MB/s)" : "")
+                  << ", loads in " << loadTime << " s"
+                  << (same ? "" : ", MISMATCH") << std::endl;
+        if (!same)
+            ++nFailed;
+    } //...for files
+
+    return nFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+} //...main()
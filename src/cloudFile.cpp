@@ -0,0 +1,222 @@
+#include "acq/cloudFile.h"
+
+#include "acq/cloudIndex.h"
+#include "acq/impl/hash.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace acq {
+
+namespace {
+    //! Identifies cloud files, bump the version whenever the layout changes.
+    char     const FILE_MAGIC[8] = { 'A', 'C', 'Q', 'C', 'L', 'O', 'U', 'D' };
+    uint32_t const FILE_VERSION  = 1;
+    //! Reads back differently on machines of the other byte order.
+    uint32_t const ORDER_MARK    = 0x01020304u;
+    //! Sections start at multiples of this.
+    uint64_t const ALIGNMENT     = 64;
+
+    /** \brief Fixed-size header at the start of a cloud file. */
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        int64_t  nVertices;
+        int64_t  nFaces;
+        int64_t  faceSize;
+        uint64_t verticesOffset;
+        uint64_t facesOffset;   // 0: no faces
+        uint64_t normalsOffset; // 0: no normals
+        uint64_t indexOffset;   // 0: no index
+        uint64_t indexSize;
+        char     reserved[128 - 8 - 2 * 4 - 8 * 8];
+    }; //...struct Header
+    static_assert(sizeof(Header) == 128, "Cloud file header has to be 128 bytes");
+
+    uint64_t alignUp(uint64_t const offset) {
+        return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+} //...ns anonymous
+
+CloudFile::CloudFile()
+    : _nVertices(0), _nFaces(0), _faceSize(0), _verticesOffset(0), _facesOffset(0),
+      _normalsOffset(0), _indexOffset(0), _indexSize(0)
+{}
+
+CloudFile::CloudFile(std::string const& path) : CloudFile() {
+    open(path);
+}
+
+bool CloudFile::open(std::string const& path) {
+    _nVertices = _nFaces = _faceSize = 0;
+    _verticesOffset = _facesOffset = _normalsOffset = _indexOffset = _indexSize = 0;
+    if (!_file.open(path))
+        return false;
+
+    Header header;
+    if (_file.size() < sizeof(Header)) {
+        std::cerr << "[CloudFile::open] " << path << " is too short for a cloud file\n";
+        _file.close();
+        return false;
+    }
+    std::memcpy(&header, _file.data(), sizeof(Header));
+
+    if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) || header.version != FILE_VERSION
+        || header.byteOrder != ORDER_MARK) {
+        std::cerr << "[CloudFile::open] " << path << " is not a version " << FILE_VERSION
+                  << " cloud file of this byte order\n";
+        _file.close();
+        return false;
+    }
+
+    // Every section has to lie within the file, the counts are bounded before they are multiplied
+    uint64_t const fileSize = _file.size();
+    auto const fits = [fileSize](uint64_t const offset, uint64_t const count, uint64_t const elementSize) {
+        return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+    };
+    bool valid = header.nVertices >= 0 && header.nFaces >= 0 && header.faceSize >= 0
+                 && fits(header.verticesOffset, header.nVertices, 3 * sizeof(double));
+    if (header.facesOffset)
+        valid &= header.faceSize > 0 && fits(header.facesOffset, header.faceSize, sizeof(int))
+                 && fits(header.facesOffset, header.nFaces, header.faceSize * sizeof(int));
+    else
+        valid &= header.nFaces == 0;
+    if (header.normalsOffset)
+        valid &= fits(header.normalsOffset, header.nVertices, 3 * sizeof(double));
+    if (header.indexOffset)
+        valid &= fits(header.indexOffset, header.indexSize, 1);
+    if (!valid) {
+        std::cerr << "[CloudFile::open] " << path << " is truncated or corrupt\n";
+        _file.close();
+        return false;
+    }
+
+    _nVertices      = header.nVertices;
+    _nFaces         = header.nFaces;
+    _faceSize       = header.faceSize;
+    _verticesOffset = header.verticesOffset;
+    _facesOffset    = header.facesOffset;
+    _normalsOffset  = header.normalsOffset;
+    _indexOffset    = header.indexOffset;
+    _indexSize      = header.indexOffset ? header.indexSize : 0;
+    return true;
+} //...CloudFile::open()
+
+CloudFile::VerticesMapT CloudFile::getVertices() const {
+    if (!_nVertices)
+        return VerticesMapT(nullptr, 0, 3);
+    return VerticesMapT(reinterpret_cast<double const*>(_file.data() + _verticesOffset), _nVertices, 3);
+} //...CloudFile::getVertices()
+
+CloudFile::FacesMapT CloudFile::getFaces() const {
+    if (!_nFaces)
+        return FacesMapT(nullptr, 0, _faceSize);
+    return FacesMapT(reinterpret_cast<int const*>(_file.data() + _facesOffset), _nFaces, _faceSize);
+} //...CloudFile::getFaces()
+
+CloudFile::NormalsMapT CloudFile::getNormals() const {
+    if (!_normalsOffset || !_nVertices)
+        return NormalsMapT(nullptr, 0, 3);
+    return NormalsMapT(reinterpret_cast<double const*>(_file.data() + _normalsOffset), _nVertices, 3);
+} //...CloudFile::getNormals()
+
+std::unique_ptr<CloudIndex> CloudFile::loadIndex(int const maxLeafs) const {
+    if (!hasIndex())
+        return std::unique_ptr<CloudIndex>();
+    VerticesMapT const vertices = getVertices();
+    return CloudIndex::load(vertices, hashMatrix(vertices), maxLeafs, _file.data() + _indexOffset, _indexSize);
+} //...CloudFile::loadIndex()
+
+void CloudFile::copyTo(DecoratedCloud &cloud) const {
+    cloud = DecoratedCloud();
+    cloud.getVertices() = getVertices();
+    cloud.getFaces()    = getFaces();
+    if (hasNormals())
+        cloud.getNormals() = getNormals();
+} //...CloudFile::copyTo()
+
+bool
+writeCloudFile(
+    std::string const& path,
+    CloudT      const& vertices,
+    FacesT      const& faces,
+    NormalsT    const& normals,
+    std::string const& indexData
+) {
+    if (vertices.cols() != 3 || (normals.size() && (normals.rows() != vertices.rows() || normals.cols() != 3))) {
+        std::cerr << "[writeCloudFile] Expected N x 3 vertices and normals, got "
+                  << vertices.rows() << " x " << vertices.cols() << " and "
+                  << normals.rows() << " x " << normals.cols() << "\n";
+        return false;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(Header));
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version   = FILE_VERSION;
+    header.byteOrder = ORDER_MARK;
+    header.nVertices = vertices.rows();
+    header.nFaces    = faces.rows();
+    header.faceSize  = faces.cols();
+
+    // Lay out the sections one after the other
+    uint64_t offset = alignUp(sizeof(Header));
+    header.verticesOffset = offset;
+    offset += vertices.size() * sizeof(double);
+    if (faces.size()) {
+        header.facesOffset = offset = alignUp(offset);
+        offset += faces.size() * sizeof(int);
+    } else
+        header.nFaces = 0;
+    if (normals.size()) {
+        header.normalsOffset = offset = alignUp(offset);
+        offset += normals.size() * sizeof(double);
+    }
+    if (!indexData.empty()) {
+        header.indexOffset = offset = alignUp(offset);
+        header.indexSize   = indexData.size();
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "[writeCloudFile] Could not open " << path << "\n";
+        return false;
+    }
+
+    char const padding[ALIGNMENT] = {};
+    auto const writeAt = [&](uint64_t const position, void const* data, size_t const size) {
+        uint64_t const current = static_cast<uint64_t>(file.tellp());
+        file.write(padding, position - current);
+        file.write(static_cast<char const*>(data), size);
+    };
+    file.write(reinterpret_cast<char const*>(&header), sizeof(Header));
+    writeAt(header.verticesOffset, vertices.data(), vertices.size() * sizeof(double));
+    if (header.facesOffset)
+        writeAt(header.facesOffset, faces.data(), faces.size() * sizeof(int));
+    if (header.normalsOffset)
+        writeAt(header.normalsOffset, normals.data(), normals.size() * sizeof(double));
+    if (header.indexOffset)
+        writeAt(header.indexOffset, indexData.data(), indexData.size());
+
+    if (!file) {
+        std::cerr << "[writeCloudFile] Could not write " << path << "\n";
+        return false;
+    }
+    return true;
+} //...writeCloudFile()
+
+bool
+writeCloudFile(
+    std::string    const& path,
+    DecoratedCloud const& cloud,
+    int            const  maxLeafs
+) {
+    std::string indexData;
+    if (maxLeafs > 0 && cloud.getVertices().rows())
+        indexData = CloudIndex(cloud.getVertices(), maxLeafs).save(hashMatrix(cloud.getVertices()));
+    return writeCloudFile(path, cloud.getVertices(), cloud.getFaces(), cloud.getNormals(), indexData);
+} //...writeCloudFile()
+
+} //...ns acq
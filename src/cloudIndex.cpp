@@ -0,0 +1,235 @@
+#include "acq/cloudIndex.h"
+
+#include "new_nanoflann/nanoflann.hpp" // Nearest neighbour lookup in a pointcloud
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace acq {
+
+namespace {
+    //! Identifies serialized trees, bump the version whenever the layout changes.
+    char     const INDEX_MAGIC[4] = { 'A', 'C', 'Q', 'I' };
+    uint32_t const INDEX_VERSION  = 1;
+
+    /** \brief Header of a serialized tree, followed by nanoflann's own format. */
+    struct IndexHeader {
+        char     magic[4];
+        uint32_t version;
+        uint64_t nPoints;
+        HashT    pointsHash;
+        int64_t  maxLeafs;
+        uint64_t sizeofIndex; //!< sizeof(size_t) of the writer, the tree stores raw indices and nodes.
+        uint64_t payloadSize;
+    }; //...struct IndexHeader
+} //...ns anonymous
+
+/** \brief nanoflann dataset adaptor and tree over a \ref CloudIndex::PointsT view. */
+struct CloudIndex::Tree {
+    //! Point dimensions
+    enum { Dim = 3 };
+    //! KD-tree type
+    typedef nanoflann::KDTreeSingleIndexAdaptor<
+        /* Distance metric: */ nanoflann::L2_Simple_Adaptor<double, Tree>,
+        /* Dataset adaptor: */ Tree,
+        /*  Dimensionality: */ Dim,
+        /*      Index type: */ size_t
+    > KdTreeT;
+
+    Tree(PointsT const& points, int const maxLeafs, bool const build)
+        : _points(points),
+          _index(Dim, *this, nanoflann::KDTreeSingleIndexAdaptorParams(maxLeafs))
+    {
+        if (build)
+            _index.buildIndex();
+    }
+
+    // nanoflann dataset interface
+    size_t kdtree_get_point_count() const { return static_cast<size_t>(_points.rows()); }
+    double kdtree_get_pt(size_t const idx, int const dim) const { return _points.coeff(idx, dim); }
+    template <class BBOX> bool kdtree_get_bbox(BBOX&) const { return false; }
+
+    PointsT const& _points; //!< Owned by the enclosing \ref CloudIndex.
+    KdTreeT        _index;  //!< The tree, has to be initialized after \ref _points.
+}; //...struct CloudIndex::Tree
+
+CloudIndex::CloudIndex(CloudT const& cloud, int const maxLeafs)
+    : CloudIndex(PointsT(cloud.data(), cloud.rows(), cloud.cols()), maxLeafs)
+{}
+
+CloudIndex::CloudIndex(PointsT const& points, int const maxLeafs)
+    : CloudIndex(points, maxLeafs, /* build: */ true)
+{}
+
+CloudIndex::CloudIndex(PointsT const& points, int const maxLeafs, bool const build)
+    : _points(points), _maxLeafs(maxLeafs)
+{
+    // Safety check dimensionality
+    if (_points.cols() != Tree::Dim) {
+        std::cerr << "[CloudIndex] Point dimension mismatch: " << _points.cols()
+                  << " vs. " << Tree::Dim
+                  << "\n";
+        throw new std::runtime_error("Point dimension mismatch");
+    } //...check dimensionality
+
+    _tree.reset(new Tree(_points, maxLeafs, build));
+} //...CloudIndex::CloudIndex()
+
+CloudIndex::~CloudIndex() {}
+
+std::string CloudIndex::save(HashT const pointsHash) const {
+    IndexHeader header;
+    std::copy(INDEX_MAGIC, INDEX_MAGIC + 4, header.magic);
+    header.version     = INDEX_VERSION;
+    header.nPoints     = static_cast<uint64_t>(_points.rows());
+    header.pointsHash  = pointsHash;
+    header.maxLeafs    = _maxLeafs;
+    header.sizeofIndex = sizeof(size_t);
+    header.payloadSize = 0;
+
+    // nanoflann writes to a FILE, collect its output in a temporary one
+    std::string payload;
+    if (_points.rows()) {
+        std::FILE* file = std::tmpfile();
+        if (!file) {
+            std::cerr << "[CloudIndex::save] Could not create a temporary file\n";
+            return std::string();
+        }
+        _tree->_index.saveIndex(file);
+        payload.resize(static_cast<size_t>(std::ftell(file)));
+        std::rewind(file);
+        size_t const nRead = std::fread(&payload[0], 1, payload.size(), file);
+        std::fclose(file);
+        if (nRead != payload.size()) {
+            std::cerr << "[CloudIndex::save] Could not read back the tree\n";
+            return std::string();
+        }
+    }
+    header.payloadSize = payload.size();
+
+    return std::string(reinterpret_cast<char const*>(&header), sizeof(IndexHeader)) + payload;
+} //...CloudIndex::save()
+
+std::unique_ptr<CloudIndex> CloudIndex::load(
+    PointsT const& points,
+    HashT   const  pointsHash,
+    int     const  maxLeafs,
+    char    const* data,
+    size_t  const  size
+) {
+    IndexHeader header;
+    if (!data || size < sizeof(IndexHeader))
+        return std::unique_ptr<CloudIndex>();
+    std::memcpy(&header, data, sizeof(IndexHeader));
+    if (!std::equal(INDEX_MAGIC, INDEX_MAGIC + 4, header.magic)
+        || header.version     != INDEX_VERSION
+        || header.nPoints     != static_cast<uint64_t>(points.rows())
+        || header.pointsHash  != pointsHash
+        || header.maxLeafs    != maxLeafs
+        || header.sizeofIndex != sizeof(size_t)
+        || header.payloadSize != size - sizeof(IndexHeader))
+        return std::unique_ptr<CloudIndex>();
+
+    std::unique_ptr<CloudIndex> index(new CloudIndex(points, maxLeafs, /* build: */ false));
+    if (!points.rows())
+        return index;
+
+    // Hand the (mapped) bytes to nanoflann as a FILE
+    char const* const payload = data + sizeof(IndexHeader);
+#ifdef _WIN32
+    std::FILE* file = std::tmpfile();
+    if (file) {
+        std::fwrite(payload, 1, header.payloadSize, file);
+        std::rewind(file);
+    }
+#else
+    std::FILE* file = fmemopen(const_cast<char*>(payload), header.payloadSize, "rb");
+#endif
+    if (!file) {
+        std::cerr << "[CloudIndex::load] Could not open the serialized tree\n";
+        return std::unique_ptr<CloudIndex>();
+    }
+    try {
+        index->_tree->_index.loadIndex(file);
+    } catch (std::runtime_error const& error) {
+        std::cerr << "[CloudIndex::load] Truncated tree: " << error.what() << "\n";
+        index.reset();
+    }
+    std::fclose(file);
+    return index;
+} //...CloudIndex::load()
+
+bool CloudIndex::findNearest(Eigen::Vector3d const& query, size_t &pointId, double &distSqr) const {
+    if (!_points.rows())
+        return false;
+
+    nanoflann::KNNResultSet<double, size_t> resultSet(1);
+    resultSet.init(&pointId, &distSqr);
+    _tree->_index.findNeighbors(resultSet, query.data(), nanoflann::SearchParams());
+    return true;
+} //...CloudIndex::findNearest()
+
+size_t CloudIndex::findNeighbours(
+    Eigen::Vector3d     const& query,
+    size_t              const  k,
+    std::vector<size_t>      & pointIds,
+    std::vector<double>      & distsSqr
+) const {
+    pointIds.resize(k);
+    distsSqr.resize(k);
+    if (!k || !_points.rows())
+        return 0;
+
+    nanoflann::KNNResultSet<double, size_t> resultSet(k);
+    resultSet.init(&pointIds[0], &distsSqr[0]);
+    _tree->_index.findNeighbors(resultSet, query.data(), nanoflann::SearchParams());
+
+    // Trim, if fewer points than requested
+    size_t const found = resultSet.size();
+    pointIds.resize(found);
+    distsSqr.resize(found);
+    return found;
+} //...CloudIndex::findNeighbours()
+
+size_t CloudIndex::findInRadius(
+    Eigen::Vector3d     const& query,
+    double              const  radius,
+    size_t              const  maxCount,
+    std::vector<size_t>      & pointIds,
+    std::vector<double>      & distsSqr
+) const {
+    pointIds.clear();
+    distsSqr.clear();
+    if (!_points.rows() || radius <= 0.)
+        return 0;
+
+    // The L2 adaptor compares squared distances
+    double const radiusSqr = radius * radius;
+    if (maxCount) {
+        // k nearest, with the radius as the initial worst distance
+        pointIds.resize(maxCount);
+        distsSqr.resize(maxCount);
+        nanoflann::KNNResultSet<double, size_t> resultSet(maxCount);
+        resultSet.init(&pointIds[0], &distsSqr[0]);
+        distsSqr.back() = radiusSqr;
+        _tree->_index.findNeighbors(resultSet, query.data(), nanoflann::SearchParams());
+        pointIds.resize(resultSet.size());
+        distsSqr.resize(resultSet.size());
+    } else {
+        // Sorted by distance by default
+        std::vector<std::pair<size_t, double> > found;
+        _tree->_index.radiusSearch(query.data(), radiusSqr, found, nanoflann::SearchParams());
+        pointIds.reserve(found.size());
+        distsSqr.reserve(found.size());
+        for (std::pair<size_t, double> const& match : found) {
+            pointIds.push_back(match.first);
+            distsSqr.push_back(match.second);
+        }
+    }
+    return pointIds.size();
+} //...CloudIndex::findInRadius()
+
+} //...ns acq
@@ -3,7 +3,11 @@
 //
 
 #include "acq/impl/cloudManager.hpp"
+#include "acq/impl/parallel.hpp"
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <mutex>
 
 namespace acq {
 
@@ -25,6 +29,11 @@ void CloudManager::setCloud(DecoratedCloud const& cloud, int index) {
     _clouds.at(index) = cloud;
 } //...CloudManager::setCloud()
 
+void CloudManager::reserveClouds(int const count) {
+    if (count > getCloudCount())
+        _clouds.resize(count);
+} //...CloudManager::reserveClouds()
+
 DecoratedCloud& CloudManager::getCloud(int index) {
     if (index < _clouds.size())
         return _clouds.at(index);
@@ -42,4 +51,46 @@ DecoratedCloud const& CloudManager::getCloud(int index) const {
     );
 } //...CloudManager::getCloud() (const)
 
+size_t CloudManager::loadClouds(
+    std::vector<std::string> const& paths,
+    int                      const  firstIndex,
+    std::vector<ReadStats>        * stats,
+    LoadCallbackT            const& onLoaded,
+    unsigned                 const  nThreads
+) {
+    if (firstIndex < 0) {
+        std::cerr << "[CloudManager::loadClouds] Invalid first index " << firstIndex << "\n";
+        throw new std::runtime_error("Invalid first index");
+    }
+    // Grow once up front, so the slots stay put while the threads fill them
+    if (firstIndex + paths.size() > _clouds.size())
+        _clouds.resize(firstIndex + paths.size());
+
+    std::vector<ReadStats> fileStats(paths.size());
+    unsigned const nWorkers        = nThreads ? nThreads : defaultThreadCount();
+    unsigned const nFileThreads    = static_cast<unsigned>(std::min<size_t>(std::max<size_t>(paths.size(), 1), nWorkers));
+    unsigned const nThreadsPerFile = std::max(nWorkers / nFileThreads, 1u);
+
+    std::mutex          callbackMutex;
+    std::atomic<size_t> nFailed(0);
+    parallelFor(paths.size(), [&](size_t const pathId) {
+        DecoratedCloud &cloud = _clouds[firstIndex + pathId];
+        // Nothing derived from a previous cloud in the slot (spacing, curvatures, dirty flags) carries over
+        cloud = DecoratedCloud();
+        if (!readMesh(paths[pathId], cloud, &fileStats[pathId], nThreadsPerFile)) {
+            cloud = DecoratedCloud();
+            ++nFailed;
+            return;
+        }
+        if (onLoaded) {
+            std::lock_guard<std::mutex> lock(callbackMutex);
+            onLoaded(pathId, fileStats[pathId]);
+        }
+    }, 1, nFileThreads);
+
+    if (stats)
+        stats->swap(fileStats);
+    return nFailed;
+} //...CloudManager::loadClouds()
+
 } //...ns acq
\ No newline at end of file
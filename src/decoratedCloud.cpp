@@ -4,21 +4,244 @@
 
 #include "acq/impl/decoratedCloud.hpp"
 
+#include "acq/cloudIndex.h"
+#include "acq/normalEstimation.h"
+#include "acq/impl/parallel.hpp"
+
+#include <algorithm>
+#include <numeric>
+
 namespace acq {
 
+namespace {
+    //! No distance limit.
+    float const NO_MAX_DIST = std::sqrt(std::numeric_limits<float>::max()) - 1.f;
+
+    /** \brief Stores the squared distance within which a point joins the neighbourhood of each row.
+     *
+     * The k nearest points include the point itself, so a full row of k - 1 neighbours ends at
+     * its farthest one, while shorter rows were cut by \p maxDist.
+     *
+     * \param[in ] neighbours Lists with squared distances, see \ref calculateCloudNeighbours().
+     * \param[in ] pointIds   Point of each row.
+     * \param[out] radiiSqr   Receives the entries of \p pointIds.
+     */
+    void setNeighbourRadii(
+        NeighboursT                  const& neighbours,
+        std::vector<Neighbours::IdT> const& pointIds,
+        int                          const  k,
+        float                        const  maxDist,
+        Eigen::VectorXd                   & radiiSqr
+    ) {
+        for (size_t row = 0; row != pointIds.size(); ++row) {
+            size_t const count = neighbours.count(row);
+            double const* distsSqr = neighbours.getDistancesSqr(row);
+            radiiSqr(pointIds[row]) = count + 1 >= static_cast<size_t>(k)
+                                      ? *std::max_element(distsSqr, distsSqr + count)
+                                      : static_cast<double>(maxDist) * maxDist;
+        }
+    } //...setNeighbourRadii()
+} //...ns anonymous
+
+int const DecoratedCloud::DEFAULT_NORMAL_NEIGHBOURS;
+int const DecoratedCloud::DEFAULT_SPACING_NEIGHBOURS;
+
+DecoratedCloud::DecoratedCloud()
+    : _normalNeighbours(0), _normalMaxDist(NO_MAX_DIST),
+      _normalsFromFaces(false), _faceWeighting(FACE_WEIGHT_AREA)
+{}
+
 DecoratedCloud::DecoratedCloud(CloudT const& vertices)
-    : _vertices(vertices) {}
+    : _vertices(vertices), _normalNeighbours(0), _normalMaxDist(NO_MAX_DIST),
+      _normalsFromFaces(false), _faceWeighting(FACE_WEIGHT_AREA) {}
 
 DecoratedCloud::DecoratedCloud(CloudT const& vertices, FacesT const& faces)
-    : _vertices(vertices), _faces(faces)
+    : _vertices(vertices), _faces(faces), _normalNeighbours(0), _normalMaxDist(NO_MAX_DIST),
+      _normalsFromFaces(false), _faceWeighting(FACE_WEIGHT_AREA)
 {}
 
 DecoratedCloud::DecoratedCloud(CloudT const& vertices, FacesT const& faces, NormalsT const& normals)
-    : _vertices(vertices), _faces(faces), _normals(normals)
+    : _vertices(vertices), _faces(faces), _normals(normals), _normalNeighbours(0), _normalMaxDist(NO_MAX_DIST),
+      _normalsFromFaces(false), _faceWeighting(FACE_WEIGHT_AREA)
 {}
 
 DecoratedCloud::DecoratedCloud(CloudT const& vertices, NormalsT const& normals)
-    : _vertices(vertices), _normals(normals)
+    : _vertices(vertices), _normals(normals), _normalNeighbours(0), _normalMaxDist(NO_MAX_DIST),
+      _normalsFromFaces(false), _faceWeighting(FACE_WEIGHT_AREA)
 {}
 
+void DecoratedCloud::setVertices(CloudT const& vertices) {
+    if (vertices.rows() != _vertices.rows()) {
+        // Nothing derived carries over to other points
+        _normals.resize(0, 3);
+        _curvatures.resize(0);
+        _normalRadiiSqr.resize(0);
+        _dirty.clear();
+        _dirtyFrom.resize(0, 3);
+    } else if (hasNormals()) {
+        for (Eigen::Index pointId = 0; pointId != vertices.rows(); ++pointId)
+            if (vertices.row(pointId) != _vertices.row(pointId))
+                markDirty(static_cast<size_t>(pointId));
+    }
+    _vertices = vertices;
+    _spacing.resize(0);
+} //...DecoratedCloud::setVertices()
+
+void DecoratedCloud::transform(PoseT const& pose) {
+    if (!hasVertices())
+        return;
+    Eigen::Matrix3d const R = pose.topLeftCorner<3, 3>();
+    _vertices = (_vertices * R.transpose()).rowwise() + pose.topRightCorner<3, 1>().transpose();
+    // Distances and angles are kept, so are the neighbourhoods, curvatures and spacing
+    if (hasNormals())
+        _normals = _normals * R.transpose();
+    if (_dirtyFrom.rows())
+        _dirtyFrom = (_dirtyFrom * R.transpose()).rowwise() + pose.topRightCorner<3, 1>().transpose();
+} //...DecoratedCloud::transform()
+
+void DecoratedCloud::setNormals(NormalsT const& normals) {
+    _normals = normals;
+    _curvatures.resize(0);
+    _normalRadiiSqr.resize(0);
+    _dirty.clear();
+    _dirtyFrom.resize(0, 3);
+    _normalNeighbours = 0;
+    _normalMaxDist    = NO_MAX_DIST;
+    _normalsFromFaces = false;
+} //...DecoratedCloud::setNormals()
+
+void DecoratedCloud::estimateSpacing(int const k, unsigned const nThreads) {
+    _spacing = calculatePointSpacing(_vertices, k, 10, nThreads);
+} //...DecoratedCloud::estimateSpacing()
+
+void DecoratedCloud::estimateNormals(int const k, float const maxDist, unsigned const nThreads) {
+    NeighboursT const neighbours = calculateCloudNeighbours(_vertices, k, maxDist, 10, nThreads);
+    _normals = calculateCloudNormals(_vertices, neighbours, &_curvatures, nThreads);
+    std::vector<Neighbours::IdT> pointIds(static_cast<size_t>(_vertices.rows()));
+    std::iota(pointIds.begin(), pointIds.end(), 0);
+    _normalRadiiSqr.resize(_vertices.rows());
+    setNeighbourRadii(neighbours, pointIds, k, maxDist, _normalRadiiSqr);
+    _dirty.clear();
+    _dirtyFrom.resize(0, 3);
+    _normalNeighbours = k;
+    _normalMaxDist    = maxDist;
+    _normalsFromFaces = false;
+} //...DecoratedCloud::estimateNormals()
+
+int DecoratedCloud::estimateNormalsFromFaces(FaceWeighting const weighting, unsigned const nThreads) {
+    bool consistent = true;
+    _normals = calculateCloudNormalsFromFaces(_vertices, _faces, weighting, &consistent, nThreads);
+    _curvatures.resize(0);
+    _normalRadiiSqr.resize(0);
+    _dirty.clear();
+    _dirtyFrom.resize(0, 3);
+    _normalNeighbours = 0;
+    _normalMaxDist    = NO_MAX_DIST;
+    _normalsFromFaces = true;
+    _faceWeighting    = weighting;
+
+    // Consistent winding needs no neighbourhood graph
+    return consistent ? 0 : orientCloudNormalsFromFaces(_faces, _normals, nThreads);
+} //...DecoratedCloud::estimateNormalsFromFaces()
+
+size_t DecoratedCloud::updateNormals(unsigned const nThreads) {
+    size_t const nDirty = getDirtyCount();
+    if (!nDirty || !hasNormals()) {
+        _dirty.clear();
+        _dirtyFrom.resize(0, 3);
+        return 0;
+    }
+
+    if (_normalsFromFaces && hasFaces()) {
+        // Cheap enough to redo all, then keep the orientation the points had
+        NormalsT const previous = _normals;
+        estimateNormalsFromFaces(_faceWeighting, nThreads);
+        for (Eigen::Index pointId = 0; pointId != _normals.rows(); ++pointId)
+            if (_normals.row(pointId).dot(previous.row(pointId)) < 0.)
+                _normals.row(pointId) *= -1.;
+        return static_cast<size_t>(_normals.rows());
+    }
+
+    int    const k       = _normalNeighbours ? _normalNeighbours : DEFAULT_NORMAL_NEIGHBOURS;
+    size_t const nPoints = _dirty.size();
+    std::vector<Neighbours::IdT> pointIds;
+    if (2 * nDirty > nPoints) {
+        // Mostly dirty, cheaper to redo all
+        pointIds.resize(nPoints);
+        std::iota(pointIds.begin(), pointIds.end(), 0);
+    }
+    CloudIndex const cloudIndex(_vertices);
+    bool const withRadii = static_cast<size_t>(_normalRadiiSqr.size()) == nPoints;
+    if (!withRadii)
+        _normalRadiiSqr.resize(nPoints);
+
+    if (pointIds.empty()) {
+        if (!withRadii) {
+            // Normals given otherwise: a point's radius only grows, if a dirty point left its
+            // neighbourhood, so the current radii find the same points as the original ones
+            std::vector<Neighbours::IdT> allIds(nPoints);
+            std::iota(allIds.begin(), allIds.end(), 0);
+            setNeighbourRadii(
+                calculateCloudNeighbours(cloudIndex, allIds, k, _normalMaxDist, nThreads), allIds, k, _normalMaxDist,
+                _normalRadiiSqr);
+        }
+
+        // A neighbourhood changed, if a dirty point was in it or is in it: its old or new position
+        // is within the radius, neighbourhoods are not symmetric, so each point looks for them
+        std::vector<Neighbours::IdT> dirtyIds;
+        for (size_t pointId = 0; pointId != nPoints; ++pointId)
+            if (_dirty[pointId])
+                dirtyIds.push_back(static_cast<Neighbours::IdT>(pointId));
+        CloudT moved(2 * dirtyIds.size(), 3);
+        for (size_t i = 0; i != dirtyIds.size(); ++i) {
+            moved.row(2 * i)     = _dirtyFrom.row(dirtyIds[i]);
+            moved.row(2 * i + 1) = _vertices.row(dirtyIds[i]);
+        }
+        CloudIndex const movedIndex(moved);
+        std::vector<unsigned char> affected(_dirty);
+        parallelFor(nPoints, [&](size_t const pointId) {
+            size_t nearestId;
+            double distSqr;
+            if (!affected[pointId] &&
+                movedIndex.findNearest(_vertices.row(pointId).transpose(), nearestId, distSqr) &&
+                distSqr <= _normalRadiiSqr(pointId))
+                affected[pointId] = 1;
+        }, 4096, nThreads);
+        for (size_t pointId = 0; pointId != nPoints; ++pointId)
+            if (affected[pointId])
+                pointIds.push_back(static_cast<Neighbours::IdT>(pointId));
+    }
+
+    NormalsT previous(pointIds.size(), 3);
+    for (size_t i = 0; i != pointIds.size(); ++i)
+        previous.row(i) = _normals.row(pointIds[i]);
+    bool const withCurvatures = static_cast<size_t>(_curvatures.size()) == nPoints;
+    NeighboursT const neighbours = calculateCloudNeighbours(cloudIndex, pointIds, k, _normalMaxDist, nThreads);
+    updateCloudNormals(_vertices, pointIds, neighbours, _normals, withCurvatures ? &_curvatures : nullptr, nThreads);
+    setNeighbourRadii(neighbours, pointIds, k, _normalMaxDist, _normalRadiiSqr);
+
+    // Keep the orientation the points had
+    for (size_t i = 0; i != pointIds.size(); ++i)
+        if (_normals.row(pointIds[i]).dot(previous.row(i)) < 0.)
+            _normals.row(pointIds[i]) *= -1.;
+
+    _dirty.clear();
+    _dirtyFrom.resize(0, 3);
+    return pointIds.size();
+} //...DecoratedCloud::updateNormals()
+
+void DecoratedCloud::markDirty(size_t const pointId) {
+    if (_dirty.empty()) {
+        _dirty.assign(static_cast<size_t>(_vertices.rows()), 0);
+        _dirtyFrom.resize(_vertices.rows(), 3);
+    }
+    if (!_dirty[pointId])
+        _dirtyFrom.row(pointId) = _vertices.row(pointId);
+    _dirty[pointId] = 1;
+} //...DecoratedCloud::markDirty()
+
+size_t DecoratedCloud::getDirtyCount() const {
+    return static_cast<size_t>(std::count(_dirty.begin(), _dirty.end(), 1));
+} //...DecoratedCloud::getDirtyCount()
+
 } //...ns acq
@@ -0,0 +1,111 @@
+#include "acq/halfEdges.h"
+
+#include "acq/impl/parallel.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+namespace acq {
+
+HalfEdges::HalfEdges()
+    : _faceSize(3)
+{}
+
+HalfEdges
+HalfEdges::fromFaces(
+    FacesT   const& faces,
+    size_t   const  nPoints,
+    unsigned const  nThreads
+) {
+    HalfEdges halfEdges;
+    if (faces.size() && faces.cols() < 3) {
+        std::cerr << "[HalfEdges::fromFaces] Faces need 3 vertices at least, got " << faces.cols() << "\n";
+        throw new std::runtime_error("Not enough face vertices");
+    }
+    if (static_cast<size_t>(faces.size()) > static_cast<size_t>(std::numeric_limits<IdT>::max())) {
+        std::cerr << "[HalfEdges::fromFaces] Too many half-edges: " << faces.size() << "\n";
+        throw new std::runtime_error("Too many half-edges");
+    }
+    if (faces.size() && faces.minCoeff() < 0) {
+        std::cerr << "[HalfEdges::fromFaces] Negative vertex index " << faces.minCoeff() << "\n";
+        throw new std::runtime_error("Negative face vertex index");
+    }
+    size_t const nVertices =
+        std::max(nPoints, faces.size() ? static_cast<size_t>(faces.maxCoeff()) + 1 : size_t(0));
+    halfEdges._outgoing.assign(nVertices, -1);
+    halfEdges._boundary.assign(nVertices, 0);
+    if (!faces.size())
+        return halfEdges;
+
+    // Flat directed edges, keyed by (start, end), tagged with their half-edge
+    IdT    const faceSize = static_cast<IdT>(faces.cols());
+    size_t const nHalf    = static_cast<size_t>(faces.size());
+    halfEdges._faceSize = faceSize;
+    halfEdges._starts.resize(nHalf);
+    std::vector<uint64_t> keys(nHalf);
+    std::vector<int>      ids(nHalf);
+    parallelFor(static_cast<size_t>(faces.rows()), [&](size_t const faceId) {
+        for (IdT corner = 0; corner != faceSize; ++corner) {
+            size_t const h     = faceId * faceSize + corner;
+            IdT    const start = faces(faceId, corner);
+            IdT    const end   = faces(faceId, corner + 1 == faceSize ? 0 : corner + 1);
+            halfEdges._starts[h] = start;
+            keys[h] = Neighbours::edgeKey(start, end, nVertices);
+            ids[h]  = static_cast<int>(h);
+        }
+    }, 4096, nThreads);
+
+    // Half-edges leaving a vertex end up next to each other, sorted by their end
+    parallelRadixSort(keys, static_cast<uint64_t>(nVertices) * nVertices - 1, &ids, nThreads);
+
+    // Each vertex owns the range of keys it starts
+    std::vector<size_t> firsts(nVertices + 1, nHalf);
+    parallelFor(nVertices, [&](size_t const vertexId) {
+        firsts[vertexId] = static_cast<size_t>(
+            std::lower_bound(keys.begin(), keys.end(), static_cast<uint64_t>(vertexId) * nVertices) - keys.begin());
+    }, 4096, nThreads);
+
+    // The m-th copy of (start, end) pairs with the m-th copy of (end, start), so twins are mutual
+    halfEdges._twins.assign(nHalf, -1);
+    parallelFor(nHalf, [&](size_t const i) {
+        uint64_t const start = keys[i] / nVertices;
+        uint64_t const end   = keys[i] % nVertices;
+        if (start == end)
+            return;
+        size_t copy = 0;
+        while (copy < i && keys[i - copy - 1] == keys[i])
+            ++copy;
+        // Short scan of the half-edges leaving the end vertex
+        uint64_t const twinKey = end * nVertices + start;
+        size_t twin = firsts[end];
+        while (twin != firsts[end + 1] && keys[twin] < twinKey)
+            ++twin;
+        twin += copy;
+        if (twin < firsts[end + 1] && keys[twin] == twinKey)
+            halfEdges._twins[ids[i]] = ids[twin];
+    }, 4096, nThreads);
+
+    parallelFor(nVertices, [&](size_t const vertexId) {
+        for (size_t i = firsts[vertexId]; i != firsts[vertexId + 1]; ++i) {
+            IdT const h = ids[i];
+            if (halfEdges._outgoing[vertexId] < 0)
+                halfEdges._outgoing[vertexId] = h;
+            if (halfEdges._twins[h] < 0 && !halfEdges._boundary[vertexId]) {
+                // Walking the boundary starts here
+                halfEdges._outgoing[vertexId] = h;
+                halfEdges._boundary[vertexId] = 1;
+            }
+        }
+    }, 4096, nThreads);
+
+    return halfEdges;
+} //...HalfEdges::fromFaces()
+
+size_t HalfEdges::getBoundaryCount() const {
+    return static_cast<size_t>(std::count(_twins.begin(), _twins.end(), -1));
+} //...HalfEdges::getBoundaryCount()
+
+} //...ns acq
@@ -0,0 +1,22 @@
+#include "acq/impl/hash.hpp"
+
+namespace acq {
+
+HashT
+hashBytes(
+    void   const* data,
+    size_t const  size,
+    HashT  const  seed
+) {
+    static HashT const FNV_PRIME = 1099511628211ull;
+
+    unsigned char const* bytes = static_cast<unsigned char const*>(data);
+    HashT hash = seed;
+    for (size_t i = 0; i != size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+} //...hashBytes()
+
+} //...ns acq
@@ -0,0 +1,82 @@
+#include "acq/impl/icp.hpp"
+
+#include "acq/cloudIndex.h"
+
+#include "Eigen/LU"    // determinant()
+#include "Eigen/SVD"   // JacobiSVD
+
+namespace acq {
+
+CorrespondenceSums& CorrespondenceSums::operator+=(CorrespondenceSums const& other) {
+    sumP       += other.sumP;
+    sumQ       += other.sumQ;
+    sumPQ      += other.sumPQ;
+    sumDistSqr += other.sumDistSqr;
+    count      += other.count;
+    return *this;
+} //...CorrespondenceSums::operator+=()
+
+PoseT CorrespondenceSums::solve() const {
+    // Kabsch: centered cross-covariance from the sums
+    Eigen::Vector3d const meanP = sumP / count;
+    Eigen::Vector3d const meanQ = sumQ / count;
+    Eigen::Matrix3d const H     = sumPQ - count * meanP * meanQ.transpose();
+
+    Eigen::JacobiSVD<Eigen::Matrix3d> svd(H, Eigen::ComputeFullU | Eigen::ComputeFullV);
+    Eigen::Matrix3d D(Eigen::Matrix3d::Identity());
+    // Avoid reflections
+    if ((svd.matrixV() * svd.matrixU().transpose()).determinant() < 0.)
+        D(2, 2) = -1.;
+    Eigen::Matrix3d const dR = svd.matrixV() * D * svd.matrixU().transpose();
+
+    PoseT increment(PoseT::Identity());
+    increment.topLeftCorner<3, 3>()  = dR;
+    increment.topRightCorner<3, 1>() = meanQ - dR * meanP;
+    return increment;
+} //...CorrespondenceSums::solve()
+
+PoseT
+invertPose(
+    PoseT const& pose
+) {
+    PoseT inverse(PoseT::Identity());
+    inverse.topLeftCorner<3, 3>()  = pose.topLeftCorner<3, 3>().transpose();
+    inverse.topRightCorner<3, 1>() = -inverse.topLeftCorner<3, 3>() * pose.topRightCorner<3, 1>();
+    return inverse;
+} //...invertPose()
+
+CloudT
+transformCloud(
+    CloudT const& cloud,
+    PoseT  const& pose
+) {
+    return (cloud * pose.topLeftCorner<3, 3>().transpose()).rowwise()
+           + pose.topRightCorner<3, 1>().transpose();
+} //...transformCloud()
+
+} //...ns acq
+
+
+//
+// Template instantiation
+//
+
+namespace acq {
+
+template IcpResult
+alignPointToPoint(
+    CloudT     const& source,
+    CloudIndex const& target,
+    PoseT      const& initialPose,
+    IcpParams  const& params
+);
+
+template CorrespondenceStats
+measureCorrespondences(
+    CloudT     const& source,
+    CloudIndex const& target,
+    PoseT      const& pose,
+    IcpParams  const& params
+);
+
+} //...ns acq
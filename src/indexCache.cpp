@@ -0,0 +1,84 @@
+#include "acq/indexCache.h"
+
+#include "acq/impl/hash.hpp"
+#include "acq/mappedFile.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#   include <direct.h>
+#else
+#   include <sys/stat.h>
+#endif
+
+namespace acq {
+
+IndexCache::IndexCache(std::string const& directory)
+    : _directory(directory), _hits(0), _misses(0)
+{
+#ifdef _WIN32
+    _mkdir(_directory.c_str());
+#else
+    mkdir(_directory.c_str(), 0755);
+#endif
+} //...IndexCache::IndexCache()
+
+std::string IndexCache::getPath(HashT const pointsHash, int const maxLeafs) const {
+    std::ostringstream path;
+    path << _directory << "/" << std::hex << std::setw(16) << std::setfill('0') << pointsHash
+         << std::dec << "_" << maxLeafs << ".kdt";
+    return path.str();
+} //...IndexCache::getPath()
+
+std::unique_ptr<CloudIndex> IndexCache::getIndex(
+    CloudIndex::PointsT const& points,
+    HashT               const  pointsHash,
+    int                 const  maxLeafs
+) {
+    std::string const path = getPath(pointsHash, maxLeafs);
+
+    // Only map existing files, a miss is not an error
+    if (std::ifstream(path, std::ios::binary)) {
+        MappedFile const file(path);
+        if (file.isOpen()) {
+            std::unique_ptr<CloudIndex> index = CloudIndex::load(points, pointsHash, maxLeafs, file.data(), file.size());
+            if (index) {
+                ++_hits;
+                return index;
+            }
+        }
+    }
+
+    ++_misses;
+    std::unique_ptr<CloudIndex> index(new CloudIndex(points, maxLeafs));
+    std::string const data = index->save(pointsHash);
+    if (data.empty())
+        return index;
+
+    // Write aside and rename, so readers never see half a tree
+    std::ostringstream tmpPath;
+    tmpPath << path << "." << std::this_thread::get_id() << ".tmp";
+    {
+        std::ofstream file(tmpPath.str(), std::ios::binary | std::ios::trunc);
+        if (!file.write(data.data(), data.size())) {
+            std::cerr << "[IndexCache::getIndex] Could not write " << tmpPath.str() << "\n";
+            return index;
+        }
+    }
+    if (std::rename(tmpPath.str().c_str(), path.c_str())) {
+        std::cerr << "[IndexCache::getIndex] Could not rename " << tmpPath.str() << " to " << path << "\n";
+        std::remove(tmpPath.str().c_str());
+    }
+    return index;
+} //...IndexCache::getIndex()
+
+std::unique_ptr<CloudIndex> IndexCache::getIndex(CloudT const& cloud, int const maxLeafs) {
+    return getIndex(CloudIndex::PointsT(cloud.data(), cloud.rows(), cloud.cols()), hashMatrix(cloud), maxLeafs);
+} //...IndexCache::getIndex()
+
+} //...ns acq
@@ -0,0 +1,81 @@
+#include "acq/decoratedCloud.h"
+#include "acq/icp.h"
+#include "acq/meshIO.h"
+#include "acq/scanManifest.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** \brief Distance of the mean of \p vertices placed by acq::getInitialPose() from the origin of \p entry's pose. */
+double
+getCentreError(
+    acq::ScanEntry const& entry,
+    acq::CloudT    const& vertices
+) {
+    acq::PoseT      const pose = acq::getInitialPose(entry, vertices);
+    Eigen::Vector3d const mean = acq::transformCloud(vertices, pose).colwise().mean().transpose();
+    return (mean - entry.pose.topRightCorner<3, 1>()).norm();
+} //...getCentreError()
+
+} //...ns anonymous
+
+/** \brief Checks that acq::getInitialPose() centres every scan on its mean, rotated or not,
+ *         so the unrotated reference scan meets the rotated ones.
+ *
+ * Usage: initialPoseCheck [manifest.scans]
+ * Without a manifest, an unrotated and a rotated copy of a cloud away from the origin are checked.
+ * With one, every scan it lists is read and checked at its entry.
+ */
+int main(int argc, char *argv[]) {
+    acq::ScanEntriesT        entries;
+    std::vector<acq::CloudT> clouds;
+    if (argc > 1) {
+        acq::ScanManifest manifest;
+        if (!acq::readScanManifest(argv[1], manifest))
+            return EXIT_FAILURE;
+        for (acq::ScanEntry const& entry : manifest.scans) {
+            acq::DecoratedCloud cloud;
+            if (!acq::readMesh(entry.path, cloud)) {
+                std::cerr << "Could not read " << entry.path << "\n";
+                return EXIT_FAILURE;
+            }
+            entries.push_back(entry);
+            clouds.push_back(cloud.getVertices());
+        }
+    } else {
+        std::mt19937                           generator(42);
+        std::uniform_real_distribution<double> uniform(-1., 1.);
+        acq::CloudT cloud(1000, 3);
+        for (Eigen::Index pointId = 0; pointId != cloud.rows(); ++pointId)
+            cloud.row(pointId) << 0.1 * uniform(generator) - 0.006, 0.1 * uniform(generator) + 0.103, 0.05 * uniform(generator);
+
+        acq::ScanEntry unrotated;
+        entries.push_back(unrotated);
+        clouds.push_back(cloud);
+
+        acq::ScanEntry rotated;
+        rotated.rotation << 0., -M_PI / 2., 0.;
+        rotated.pose.topRightCorner<3, 1>() << 0.1, 0., 0.;
+        entries.push_back(rotated);
+        clouds.push_back(cloud);
+    }
+
+    bool ok = true;
+    for (size_t scanId = 0; scanId != entries.size(); ++scanId) {
+        double const extent = (clouds[scanId].colwise().maxCoeff() - clouds[scanId].colwise().minCoeff()).norm();
+        double const error  = getCentreError(entries[scanId], clouds[scanId]);
+        std::cout << "Scan " << scanId << (entries[scanId].rotation.isZero() ? " (unrotated)" : " (rotated)")
+                  << ": mean " << error << " from its pose" << std::endl;
+        if (!(error <= 1.e-9 * extent)) {
+            std::cerr << "Scan " << scanId << " is not centred on its mean\n";
+            ok = false;
+        }
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+} //...main()
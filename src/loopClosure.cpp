@@ -0,0 +1,81 @@
+#include "acq/loopClosure.h"
+
+#include "Eigen/Eigenvalues" // SelfAdjointEigenSolver
+
+#include <random>
+
+namespace acq {
+
+GlobalDescriptorT
+computeGlobalDescriptor(
+    CloudT const& cloud,
+    int    const  nBins,
+    int    const  nSamples
+) {
+    GlobalDescriptorT histogram(GlobalDescriptorT::Zero(nBins));
+    if (cloud.rows() < 2 || nBins < 1)
+        return histogram;
+
+    double const diagonal = (cloud.colwise().maxCoeff() - cloud.colwise().minCoeff()).norm();
+    if (diagonal <= 0.)
+        return histogram;
+
+    // Fixed seed, same scan gives same descriptor
+    std::mt19937 generator(5489u);
+    std::uniform_int_distribution<Eigen::Index> pick(0, cloud.rows() - 1);
+    for (int sample = 0; sample != nSamples; ++sample) {
+        double const dist = (cloud.row(pick(generator)) - cloud.row(pick(generator))).norm();
+        int const    bin  = std::min(static_cast<int>(dist / diagonal * nBins), nBins - 1);
+        histogram(bin) += 1.;
+    }
+
+    return histogram / histogram.sum();
+} //...computeGlobalDescriptor()
+
+double
+compareDescriptors(
+    GlobalDescriptorT const& a,
+    GlobalDescriptorT const& b
+) {
+    if (a.size() != b.size())
+        return 2.;
+    return (a - b).cwiseAbs().sum();
+} //...compareDescriptors()
+
+PosesT
+computePrincipalAlignments(
+    CloudT const& source,
+    CloudT const& target
+) {
+    PosesT alignments;
+    if (source.rows() < 3 || target.rows() < 3)
+        return alignments;
+
+    // Mean and right-handed principal axes, by increasing variance
+    auto const getFrame = [](CloudT const& cloud, Eigen::Vector3d &mean, Eigen::Matrix3d &axes) {
+        mean = cloud.colwise().mean().transpose();
+        CloudT const centred = cloud.rowwise() - mean.transpose();
+        axes = Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d>(centred.transpose() * centred).eigenvectors();
+        if (axes.determinant() < 0.)
+            axes.col(0) *= -1.;
+    };
+    Eigen::Vector3d sourceMean, targetMean;
+    Eigen::Matrix3d sourceAxes, targetAxes;
+    getFrame(source, sourceMean, sourceAxes);
+    getFrame(target, targetMean, targetAxes);
+
+    for (int flip = 0; flip != 4; ++flip) {
+        // Flipping two axes at a time keeps the frame right-handed
+        Eigen::Vector3d signs(flip & 1 ? -1. : 1., flip & 2 ? -1. : 1., 1.);
+        signs(2) = signs(0) * signs(1);
+        Eigen::Matrix3d const R = targetAxes * signs.asDiagonal() * sourceAxes.transpose();
+
+        PoseT pose(PoseT::Identity());
+        pose.topLeftCorner<3, 3>()  = R;
+        pose.topRightCorner<3, 1>() = targetMean - R * sourceMean;
+        alignments.push_back(pose);
+    }
+    return alignments;
+} //...computePrincipalAlignments()
+
+} //...ns acq
@@ -1,17 +1,27 @@
 #include "acq/normalEstimation.h"
 #include "acq/decoratedCloud.h"
 #include "acq/cloudManager.h"
+#include "acq/meshIO.h"
+#include "acq/plyIO.h"
+#include "acq/indexCache.h"
+#include "acq/registrationCache.h"
+#include "acq/registrationPipeline.h"
+#include "acq/scanManifest.h"
+#include "acq/scanPrefetcher.h"
 
 #include "nanogui/formhelper.h"
 #include "nanogui/screen.h"
 
-#include "igl/readOFF.h"
 #include "igl/viewer/Viewer.h"
 #include "mesh.h"
 #include "Eigen/Dense"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <random>
 #include <string>
+#include <vector>
 #include <cmath>
 
 namespace acq {
@@ -47,6 +57,96 @@ namespace acq {
         return normals;
     } //...recalcNormals()
 
+    /** \brief Runs \p pipeline and reports the outcome of each pair on the console.
+ *         Optionally refines the poses globally over all overlapping pairs,
+ *         and closes loops between pairs not registered directly afterwards.
+ */
+    PosesT
+    runRegistration(
+            RegistrationPipeline     & pipeline,
+            bool                const  refine     = false,
+            bool                const  closeLoops = false,
+            unsigned            const  nThreads   = 0
+    ) {
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+        PosesT poses = pipeline.run(nThreads);
+        double const time =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (RegistrationPipeline::PairResult const& pair : pipeline.getPairResults()) {
+            std::cout << "\nScan " << pair.source << " -> " << pair.target
+                      << (pair.cached ? " (cached)" : "") << "\n"
+                      << "End distance: " << pair.icp.error << "\n"
+                      << "Iterations: " << pair.icp.iterations << "\n"
+                      << "Processing Time: " << pair.time << " s\n";
+        }
+        std::cout << "\n";
+        pipeline.getTaskGraph().printStats(std::cout);
+        std::cout << "Total Time: " << time << " s" << std::endl;
+
+        if (refine) {
+            std::chrono::steady_clock::time_point const refineStart = std::chrono::steady_clock::now();
+            poses = pipeline.refine(poses, RegistrationPipeline::RefineParams(), nThreads);
+            std::cout << "\nGlobal refinement: " << pipeline.getPoseGraph().getEdges().size() << " edges"
+                      << ", chi2: " << pipeline.getPoseGraph().getChiSquared() << "\n"
+                      << "Processing Time: "
+                      << std::chrono::duration<double>(std::chrono::steady_clock::now() - refineStart).count()
+                      << " s" << std::endl;
+        }
+
+        if (closeLoops) {
+            std::chrono::steady_clock::time_point const loopStart = std::chrono::steady_clock::now();
+            poses = pipeline.closeLoops(poses, LoopClosureParams(), nThreads);
+            for (LoopClosure const& closure : pipeline.getLoopClosures()) {
+                std::cout << "\nLoop " << closure.source << " -> " << closure.target
+                          << (closure.accepted ? " accepted" : " rejected") << "\n"
+                          << "Estimated overlap: " << closure.estimate << "\n"
+                          << "Verified overlap: " << closure.overlap << "\n"
+                          << "End distance: " << closure.error << "\n";
+            }
+            std::cout << "Loop closure chi2: " << pipeline.getPoseGraph().getChiSquared() << "\n"
+                      << "Processing Time: "
+                      << std::chrono::duration<double>(std::chrono::steady_clock::now() - loopStart).count()
+                      << " s" << std::endl;
+        }
+
+        return poses;
+    } //...runRegistration()
+
+    /** \brief Merges the registered \p scans into cloud 0 and shows them, one colour per scan. */
+    void showRegisteredScans(
+            igl::viewer::Viewer                      & viewer,
+            CloudManager                             & cloudManager,
+            std::vector<DecoratedCloud const*>  const& scans,
+            PosesT                              const& poses
+    ) {
+        static double const palette[][3] = {
+                {0  , 0  , 1  },
+                {0  , 1  , 0  },
+                {1  , 0  , 0  },
+                {0.5, 0.5, 0.5},
+                {0  , 0.5, 0.5}
+        };
+        int const nColors = sizeof(palette) / sizeof(palette[0]);
+
+        DecoratedCloud const merged = concatenateClouds(scans, poses);
+
+        // Colour faces by scan
+        Eigen::MatrixXd colors(merged.getFaces().rows(), 3);
+        Eigen::Index faceOffset = 0;
+        for (size_t scanId = 0; scanId != scans.size(); ++scanId) {
+            Eigen::Index const nFaces = scans[scanId]->getFaces().rows();
+            colors.middleRows(faceOffset, nFaces) =
+                    Eigen::RowVector3d(palette[scanId % nColors]).replicate(nFaces, 1);
+            faceOffset += nFaces;
+        }
+
+        cloudManager.setCloud(merged, 0);
+        viewer.data.clear();
+        viewer.data.set_mesh(merged.getVertices(), merged.getFaces());
+        viewer.data.set_colors(colors);
+    } //...showRegisteredScans()
+
     void setViewerNormals(
             igl::viewer::Viewer      & viewer,
             CloudT              const& vertices,
@@ -72,32 +172,91 @@ int main(int argc, char *argv[]) {
 
     mesh msh;
 
-    MatrixXd V_1, V_2, V_3, V_4, V_5;
-    MatrixXi F_1, F_2, F_3, F_4, F_5;
-    //file path
-    std::string m1Path = "../off_files/bun000.off";
-    std::string m2Path = "../off_files/bun045.off";
-    std::string m3Path = "../off_files/bun090.off";
-    std::string m4Path = "../off_files/bun180.off";
-    std::string m5Path = "../off_files/top2.off";
-
-    igl::readOFF(m1Path, V_1, F_1);
-    igl::readOFF(m2Path, V_2, F_2);
-    igl::readOFF(m3Path, V_3, F_3);
-    igl::readOFF(m4Path, V_4, F_4);
-    igl::readOFF(m5Path, V_5, F_5);
+    // The registration job: the scans, their initial poses and pairing, see acq::ScanManifest
+    std::string const manifestPath = argc > 1 ? argv[1] : "../off_files/bunny.scans";
+    acq::ScanManifest manifest;
+    if (!acq::readScanManifest(manifestPath, manifest))
+        return 1;
+    int const nScans = static_cast<int>(manifest.scans.size());
+    if (nScans < 2) {
+        std::cerr << manifestPath << " has to list at least two scans" << std::endl;
+        return 1;
+    }
+
+    // Store clouds so we can store normals later:
+    // 0 is shown, 1..nScans are the scans, the two after are working copies of 1 and 2
+    acq::CloudManager cloudManager;
+    int const firstScan = 1;
+    int const copy1     = firstScan + nScans;
+    int const copy2     = copy1 + 1;
+    {
+        std::vector<std::string> const paths = manifest.getPaths();
+
+        // Read all scans at once, straight into their slots
+        typedef std::chrono::steady_clock ClockT;
+        ClockT::time_point const start = ClockT::now();
+        size_t nRead = 0;
+        std::vector<acq::ReadStats> stats;
+        acq::TaskGraph loadTasks;
+        size_t const nFailed = acq::loadManifestScans(
+                manifest, cloudManager, firstScan, &stats,
+                [&](size_t const pathId, acq::ReadStats const& fileStats) {
+                    std::cout << "[" << ++nRead << "/" << paths.size() << "] Read " << paths[pathId] << ": "
+                              << fileStats.bytes / (1024. * 1024.) << " MB in " << fileStats.seconds << " s ("
+                              << fileStats.getThroughput() << " MB/s)" << std::endl;
+                },
+                &loadTasks
+        );
+        loadTasks.printStats(std::cout);
+        double const wallTime = std::chrono::duration<double>(ClockT::now() - start).count();
+
+        size_t totalBytes   = 0;
+        double totalSeconds = 0.;
+        for (acq::ReadStats const& fileStats : stats) {
+            totalBytes   += fileStats.bytes;
+            totalSeconds += fileStats.seconds;
+        }
+        std::cout << "Read " << paths.size() - nFailed << " of " << paths.size() << " scans, "
+                  << totalBytes / (1024. * 1024.) << " MB in " << wallTime << " s, "
+                  << totalSeconds << " s of parsing" << std::endl;
+
+        // Every button works on the scans, so a missing one leaves nothing sensible to register
+        if (nFailed) {
+            std::cerr << "Could not read " << nFailed << " of the scans of " << manifestPath << std::endl;
+            return 1;
+        }
+    }
+    // Copy through a temporary, the slots move when the list grows
+    cloudManager.setCloud(acq::DecoratedCloud(cloudManager.getCloud(firstScan)), copy1);
+    cloudManager.setCloud(acq::DecoratedCloud(cloudManager.getCloud(firstScan + 1)), copy2);
+
+    // The list does not grow anymore, so these stay valid
+    MatrixXd const& V_1 = cloudManager.getCloud(firstScan).getVertices();
+    MatrixXi const& F_1 = cloudManager.getCloud(firstScan).getFaces();
+    MatrixXd const& V_2 = cloudManager.getCloud(firstScan + 1).getVertices();
+    MatrixXi const& F_2 = cloudManager.getCloud(firstScan + 1).getFaces();
 
     // How many neighbours to use for normal estimation, shown on GUI.
     int kNeighbours = 10;
-    // Maximum distance between vertices to be considered neighbours (FLANN mode)
-    float maxNeighbourDist = 0.15; //TODO: set to average vertex distance upon read
+    // Maximum distance between vertices to be considered neighbours (FLANN mode),
+    // a few times the average vertex distance estimated upon read
+    double const spacing = cloudManager.getCloud(firstScan).getAverageSpacing();
+    float maxNeighbourDist = spacing > 0. ? static_cast<float>(3. * spacing) : 0.15f;
 
     double rot_x = 0;
     double rot_y = 0;
     double rot_z = 0;
     double noise_val = 0.0005;
-    int max_iteration = 250;
-    int step_size = 1;
+    // Fraction of the M2 points the noise moves
+    double noise_fraction = 1.;
+    // Merge model points closer than this in Multi-Scan 2, 0 keeps all points
+    double voxel_size = 0.;
+    // Refine multi-scan poses over all overlapping pairs
+    bool refine_poses = false;
+    // Verify and add non-sequential pairs to the multi-scan pose graph
+    bool close_loops = false;
+    int max_iteration = manifest.icp.maxIterations;
+    int step_size = manifest.icp.stepSize;
 
     Eigen::Vector3d T;
 
@@ -109,8 +268,10 @@ int main(int argc, char *argv[]) {
         viewer.core.show_lines = false;
     }
 
-    // Store cloud so we can store normals later
-    acq::CloudManager cloudManager;
+    // Pairwise multi-scan results, kept across button presses and runs
+    acq::RegistrationCache registrationCache(manifest.resolvePath("registration_cache"));
+    // Scan KD-trees, so unchanged scans are not indexed again
+    acq::IndexCache indexCache(manifest.resolvePath("index_cache"));
     // Read mesh from meshPath
     {
         int total_V = V_1.rows() + V_2.rows();
@@ -134,29 +295,8 @@ int main(int argc, char *argv[]) {
                  m2_color.replicate(F_2.rows(),1);
 
 
-        // Store read vertices and faces
-        cloudManager.addCloud(acq::DecoratedCloud(disp_V, disp_F));
-
-        cloudManager.addCloud(acq::DecoratedCloud(V_1, F_1));
-        cloudManager.setCloud(acq::DecoratedCloud(V_1, F_1),1);
-
-        cloudManager.addCloud(acq::DecoratedCloud(V_2, F_2));
-        cloudManager.setCloud(acq::DecoratedCloud(V_2, F_2),2);
-
-        cloudManager.addCloud(acq::DecoratedCloud(V_3, F_3));
-        cloudManager.setCloud(acq::DecoratedCloud(V_3, F_3),3);
-
-        cloudManager.addCloud(acq::DecoratedCloud(V_4, F_4));
-        cloudManager.setCloud(acq::DecoratedCloud(V_4, F_4),4);
-
-        cloudManager.addCloud(acq::DecoratedCloud(V_5, F_5));
-        cloudManager.setCloud(acq::DecoratedCloud(V_5, F_5),5);
-
-        cloudManager.addCloud(acq::DecoratedCloud(V_1, F_1));
-        cloudManager.setCloud(acq::DecoratedCloud(V_1, F_1),6);
-
-        cloudManager.addCloud(acq::DecoratedCloud(V_2, F_2));
-        cloudManager.setCloud(acq::DecoratedCloud(V_2, F_2),7);
+        // Show M1 and M2 together
+        cloudManager.setCloud(acq::DecoratedCloud(disp_V, disp_F), 0);
         viewer.data.clear();
 
         // Show mesh
@@ -191,7 +331,7 @@ int main(int argc, char *argv[]) {
     // Extend viewer menu using a lambda function
     viewer.callback_init =
             [
-                    &cloudManager, &kNeighbours, &maxNeighbourDist, &V_1, &V_2, &V_3, &V_4, &V_5, &F_1, &F_2, &F_3, &F_4, &F_5, &step_size, &max_iteration, &noise_val, &msh, &rot_x, &rot_y, &rot_z
+                    &cloudManager, firstScan, nScans, copy1, copy2, &registrationCache, &indexCache, &kNeighbours, &maxNeighbourDist, &V_1, &V_2, &F_1, &F_2, &step_size, &max_iteration, &noise_val, &noise_fraction, &voxel_size, &refine_poses, &close_loops, &manifest, &msh, &rot_x, &rot_y, &rot_z
             ] (igl::viewer::Viewer& viewer)
             {
                 // Add an additional menu window
@@ -229,21 +369,27 @@ int main(int argc, char *argv[]) {
                             int count = 0;
 
                             //Get face and vertex matrix
-                            Pv = cloudManager.getCloud(6).getVertices();
-                            Pf = cloudManager.getCloud(6).getFaces();
+                            Pv = cloudManager.getCloud(copy1).getVertices();
+                            Pf = cloudManager.getCloud(copy1).getFaces();
 
-                            Qv = cloudManager.getCloud(7).getVertices();
-                            Qf = cloudManager.getCloud(7).getFaces();
+                            Qv = cloudManager.getCloud(copy2).getVertices();
+                            Qf = cloudManager.getCloud(copy2).getFaces();
                             //ICP algorithm
                             //Call function in class
                             int dim = 3;
                             double pre_diff = 1000;
                             double t_start = clock();
+                            // Accumulated motion of M2, applied to the stored cloud at the end
+                            acq::PoseT pose(acq::PoseT::Identity());
                             for (int i = 0; i < max_iteration; i++){
                                 count++;
                                 tie(R, t, d_diff) = msh.ICP(Pv, Qv, step_size);
                                 d_diff = abs(d_diff);
                                 Qv = (R * Qv.transpose()).transpose() + t.replicate(1, Qv.rows()).transpose();
+                                acq::PoseT step(acq::PoseT::Identity());
+                                step.topLeftCorner<3, 3>()  = R;
+                                step.topRightCorner<3, 1>() = t;
+                                pose = step * pose;
                                 if ((d_diff > pre_diff && d_diff < 0.0001) || i > max_iteration) {
                                     cout << "\nEnd distance: " << d_diff << "\n";
                                     break;
@@ -253,9 +399,9 @@ int main(int argc, char *argv[]) {
                             cout<< "Iterations: "<<count << "\n";
                             double time = (std::clock() - t_start)*1.0/CLOCKS_PER_SEC;
                             cout << "Processing Time: " << time << " s" << endl;
-                            //store mesh
-                            cloudManager.setCloud(acq::DecoratedCloud(Pv, Pf),6);
-                            cloudManager.setCloud(acq::DecoratedCloud(Qv, Qf),7);
+                            // Move M2 rigidly, so its normals rotate along instead of being dropped
+                            cloudManager.getCloud(copy2).transform(pose);
+                            Qv = cloudManager.getCloud(copy2).getVertices();
                             MatrixXd result_V;
                             result_V.resize(Pv.rows() + Qv.rows(), dim);
                             MatrixXi result_F(Pf.rows() + Qf.rows(), Pf.cols());
@@ -284,6 +430,13 @@ int main(int argc, char *argv[]) {
 
                         /*  Getter lambda: */ [&]() { return noise_val; }
                 );
+                viewer.ngui->addVariable<double>(
+                        /* Displayed name: */ "Noisy Fraction (0-1):",
+
+                        /*  Setter lambda: */ [&] (double val) { noise_fraction = val; },
+
+                        /*  Getter lambda: */ [&]() { return noise_fraction; }
+                );
                 viewer.ngui->addButton(
                         "Add Noise to M2",
                         [&](){
@@ -293,10 +446,27 @@ int main(int argc, char *argv[]) {
                             int total_V = V_1.rows() + V_2.rows();
                             int total_F = F_1.rows() + F_2.rows();
 
-                            cloudManager.setCloud(acq::DecoratedCloud(V_2, F_2),2);
-                            //call class function to add noise
-                            n_V_2 = msh.Add_noise(cloudManager.getCloud(7).getVertices(), noise_val);
-                            n_F_2 = cloudManager.getCloud(7).getFaces();
+                            //call class function to add noise, a non-rigid edit of M2 in place
+                            acq::DecoratedCloud &noisy = cloudManager.getCloud(copy2);
+                            MatrixXd vertices = noisy.getVertices();
+                            // Perturb a random subset of the points only
+                            std::vector<int> moved;
+                            std::mt19937 generator(static_cast<unsigned>(std::chrono::system_clock::now().time_since_epoch().count()));
+                            std::bernoulli_distribution pick(std::max(0., std::min(noise_fraction, 1.)));
+                            for (int pointId = 0; pointId != vertices.rows(); ++pointId)
+                                if (pick(generator))
+                                    moved.push_back(pointId);
+                            MatrixXd subset(moved.size(), 3);
+                            for (size_t i = 0; i != moved.size(); ++i)
+                                subset.row(i) = vertices.row(moved[i]);
+                            subset = msh.Add_noise(subset, noise_val);
+                            for (size_t i = 0; i != moved.size(); ++i)
+                                vertices.row(moved[i]) = subset.row(i);
+                            // Marks exactly the moved points dirty, only normals near them are estimated again
+                            noisy.setVertices(vertices);
+                            noisy.updateNormals();
+                            n_V_2 = noisy.getVertices();
+                            n_F_2 = noisy.getFaces();
 
                             Eigen::MatrixXd disp_V;
                             disp_V.resize(total_V, 3);
@@ -305,9 +475,8 @@ int main(int argc, char *argv[]) {
                             Eigen::MatrixXi disp_F;
                             disp_F.resize(total_F,F_1.cols());
                             disp_F << F_1,(n_F_2.array() + V_1.rows());
-                            //store current scene mesh
-                            cloudManager.setCloud(acq::DecoratedCloud(V_1, F_1),6);
-                            cloudManager.setCloud(acq::DecoratedCloud(n_V_2, n_F_2),7);
+                            //store current scene mesh, M1 with its normals
+                            cloudManager.getCloud(copy1) = cloudManager.getCloud(firstScan);
 
                             viewer.data.clear();
 
@@ -350,9 +519,6 @@ int main(int argc, char *argv[]) {
                 viewer.ngui->addButton(
                         "Get Rotated M1",
                         [&](){
-                            MatrixXd m1_V = V_1;
-                            MatrixXd m2_V(m1_V.rows(), m1_V.cols());
-
                             int dim = 3;
 
                             double deg_to_rad = M_PI / 180;
@@ -360,7 +526,24 @@ int main(int argc, char *argv[]) {
                             double y = rot_y * deg_to_rad;
                             double z = rot_z * deg_to_rad;
 
-                            tie(m1_V, m2_V) = msh.rotate(m1_V, x, y, z);
+                            // M1 centred at its mean and a rotated copy, as mesh::rotate() does, both moved
+                            // rigidly so their normals rotate along
+                            acq::PoseT centre(acq::PoseT::Identity());
+                            centre.topRightCorner<3, 1>() = -V_1.colwise().mean().transpose();
+                            acq::PoseT rotation(acq::PoseT::Identity());
+                            rotation.topLeftCorner<3, 3>() =
+                                    (Eigen::AngleAxisd(z, Eigen::Vector3d::UnitZ()) *
+                                     Eigen::AngleAxisd(y, Eigen::Vector3d::UnitY()) *
+                                     Eigen::AngleAxisd(x, Eigen::Vector3d::UnitX())).toRotationMatrix();
+
+                            acq::DecoratedCloud &m1 = cloudManager.getCloud(copy1);
+                            acq::DecoratedCloud &m2 = cloudManager.getCloud(copy2);
+                            m1 = cloudManager.getCloud(firstScan);
+                            m1.transform(centre);
+                            m2 = m1;
+                            m2.transform(rotation);
+                            MatrixXd const& m1_V = m1.getVertices();
+                            MatrixXd const& m2_V = m2.getVertices();
 
                             MatrixXd result_V(m1_V.rows() * 2, dim);
                             MatrixXi result_F(F_1.rows() * 2, F_1.cols());
@@ -377,8 +560,6 @@ int main(int argc, char *argv[]) {
                             Color << m1_color.replicate(F_1.rows(),1),
                                      m2_color.replicate(F_2.rows(),1);
 
-                            cloudManager.setCloud(acq::DecoratedCloud(m1_V, F_1),6);
-                            cloudManager.setCloud(acq::DecoratedCloud(m2_V, F_1),7);
                             cloudManager.setCloud(acq::DecoratedCloud(result_V, result_F),0);
                             viewer.data.clear();
                             viewer.data.set_mesh(result_V,result_F);
@@ -386,374 +567,123 @@ int main(int argc, char *argv[]) {
 
                         }
                 );
-                viewer.ngui->addButton(
-                        "Multi-Scan",
-                        [&](){
-                            //ICP from 0 degree to 90 degree
-                            //from 90 to 180
-                            //from 180 to 270
-                            //from 315 to 270
-                            cloudManager.setCloud(acq::DecoratedCloud(V_1, F_1),1);
-                            cloudManager.setCloud(acq::DecoratedCloud(V_2, F_2),2);
-                            cloudManager.setCloud(acq::DecoratedCloud(V_3, F_3),3);
-                            cloudManager.setCloud(acq::DecoratedCloud(V_4, F_4),4);
-                            cloudManager.setCloud(acq::DecoratedCloud(V_5, F_5),5);
-                            viewer.data.clear();
-                            int total_V = V_1.rows() + V_2.rows() + V_3.rows() + V_4.rows() + V_5.rows();
-                            int total_F = F_1.rows() + F_2.rows() + F_3.rows() + F_4.rows() + F_5.rows();
-                            int dim = 3;
+                viewer.ngui->addVariable<bool>(
+                        /* Displayed name: */ "Global Refinement",
 
-                            Eigen::MatrixXd R, Pv, Qv;
-                            Eigen::MatrixXi Pf, Qf;
-                            Eigen::Vector3d t;
-                            double d_diff = 1000;
-                            double pre_diff = 1000;
-                            double t_start;
-                            double time;
-                            int count = 0;
-
-                            //ICP mesh 1-2
-                            Pv = cloudManager.getCloud(2).getVertices();
-                            Pf = cloudManager.getCloud(2).getFaces();
-
-                            Qv = cloudManager.getCloud(1).getVertices();
-                            Qf = cloudManager.getCloud(1).getFaces();
+                        /*  Setter lambda: */ [&] (bool val) { refine_poses = val; },
 
-                            t_start = clock();
-                            for (int i = 0; i < max_iteration; i++){
-                                count++;
-                                tie(R, t, d_diff) = msh.ICP(Pv, Qv, step_size);
-                                d_diff = abs(d_diff);
-                                Qv = (R * Qv.transpose()).transpose() + t.replicate(1, Qv.rows()).transpose();
-                                if (d_diff > pre_diff || d_diff < 0.000018 || i > max_iteration) {
-                                    cout << "\nEnd distance: " << d_diff << "\n";
-                                    break;
-                                }
-                                pre_diff = d_diff;
-                            }
-                            cout<< "Iterations: "<<count << "\n";
-                            time = (clock() - t_start) * 1.0 / CLOCKS_PER_SEC;
-                            cout << "Processing Time: " << time << " s" << endl;
-
-                            MatrixXd V1_result;
-                            MatrixXi F1_result;
-                            V1_result = Qv;
-                            F1_result = F_1;
-
-
-                            //ICP mesh 2-3
-                            Pv = cloudManager.getCloud(3).getVertices();
-                            Pf = cloudManager.getCloud(3).getFaces();
-
-                            Qv = cloudManager.getCloud(2).getVertices();
-                            Qf = cloudManager.getCloud(2).getFaces();
-
-                            d_diff = 1000;
-                            pre_diff = 1000;
-                            count = 0;
-
-                            t_start = clock();
-                            for (int i = 0; i < max_iteration; i++){
-                                count++;
-                                tie(R, t, d_diff) = msh.ICP(Pv, Qv, step_size);
-                                d_diff = abs(d_diff);
-                                Qv = (R * Qv.transpose()).transpose() + t.replicate(1, Qv.rows()).transpose();
-                                if (d_diff > pre_diff || d_diff < 0.000018 || i > max_iteration) {
-                                    cout << "\nEnd distance: " << d_diff << "\n";
-                                    break;
-                                }
-                                pre_diff = d_diff;
-                            }
-                            cout<< "Iterations: "<<count << "\n";
-                            time = (clock() - t_start) * 1.0 / CLOCKS_PER_SEC;
-                            cout << "Processing Time: " << time << " s" << endl;
-
-                            MatrixXd V2_result;
-                            MatrixXi F2_result;
-                            V2_result = Qv;
-                            F2_result = F_2;
-
-                            //ICP mesh 123-4
-                            Pv = cloudManager.getCloud(3).getVertices();
-                            Pf = cloudManager.getCloud(3).getFaces();
-
-                            Qv = cloudManager.getCloud(4).getVertices();
-                            Qf = cloudManager.getCloud(4).getFaces();
-
-                            d_diff = 1000;
-                            pre_diff = 1000;
-                            count = 0;
-
-                            t_start = clock();
-                            for (int i = 0; i < max_iteration; i++){
-                                count++;
-                                tie(R, t, d_diff) = msh.ICP(Pv, Qv, step_size);
-                                d_diff = abs(d_diff);
-                                Qv = (R * Qv.transpose()).transpose() + t.replicate(1, Qv.rows()).transpose();
-                                if (d_diff > pre_diff || d_diff < 0.000018 || i > max_iteration) {
-                                    cout << "\nEnd distance: " << d_diff << "\n";
-                                    break;
-                                }
-                                pre_diff = d_diff;
-                            }
-                            cout<< "Iterations: "<<count << "\n";
-                            time = (clock() - t_start) * 1.0 / CLOCKS_PER_SEC;
-                            cout << "Processing Time: " << time << " s" << endl;
-
-                            MatrixXd V4_result;
-                            MatrixXi F4_result;
-                            V4_result = Qv;
-                            F4_result = F_4;
+                        /*  Getter lambda: */ [&]() { return refine_poses; }
+                );
+                viewer.ngui->addVariable<bool>(
+                        /* Displayed name: */ "Loop Closure",
 
-                            //ICP mesh 5-4
-                            Pv = cloudManager.getCloud(4).getVertices();
-                            Pf = cloudManager.getCloud(4).getFaces();
+                        /*  Setter lambda: */ [&] (bool val) { close_loops = val; },
 
-                            Qv = cloudManager.getCloud(5).getVertices();
-                            Qf = cloudManager.getCloud(5).getFaces();
+                        /*  Getter lambda: */ [&]() { return close_loops; }
+                );
+                viewer.ngui->addButton(
+                        "Multi-Scan",
+                        [&](){
+                            // The scans at their initial poses, paired as the manifest says
+                            std::vector<acq::DecoratedCloud const*> scans;
+                            acq::IcpParams params = manifest.icp;
+                            params.maxIterations = max_iteration;
+                            params.stepSize      = step_size;
+                            acq::RegistrationPipeline pipeline(params);
+                            pipeline.setCache(&registrationCache);
+                            pipeline.setIndexCache(&indexCache);
+                            for (int scanId = 0; scanId != nScans; ++scanId)
+                                scans.push_back(&cloudManager.getCloud(firstScan + scanId));
+                            acq::setupPipeline(manifest, scans, pipeline);
+
+                            acq::PosesT const poses =
+                                    acq::runRegistration(pipeline, refine_poses, close_loops, manifest.getThreadCount());
+                            acq::showRegisteredScans(viewer, cloudManager, scans, poses);
+                        }
+                );
+                viewer.ngui->addVariable<double>(
+                        /* Displayed name: */ "Voxel Size:",
 
-                            d_diff = 1000;
-                            pre_diff = 1000;
-                            count = 0;
+                        /*  Setter lambda: */ [&] (double val) { voxel_size = val; },
 
-                            t_start = clock();
-                            for (int i = 0; i < max_iteration; i++){
-                                count++;
-                                tie(R, t, d_diff) = msh.ICP(Pv, Qv, step_size);
-                                d_diff = abs(d_diff);
-                                Qv = (R * Qv.transpose()).transpose() + t.replicate(1, Qv.rows()).transpose();
-                                if (d_diff > pre_diff || d_diff < 0.000018 || i > max_iteration) {
-                                    cout << "\nEnd distance: " << d_diff << "\n";
-                                    break;
-                                }
-                                pre_diff = d_diff;
+                        /*  Getter lambda: */ [&]() { return voxel_size; }
+                );
+                viewer.ngui->addButton(
+                        "Multi-Scan 2",
+                        [&](){
+                            std::vector<acq::DecoratedCloud const*> scans;
+                            acq::IcpParams params = manifest.icp;
+                            params.maxIterations = max_iteration;
+                            params.stepSize      = step_size;
+                            params.minError      = 0.0001;
+                            acq::RegistrationPipeline pipeline(params);
+                            pipeline.setCache(&registrationCache);
+                            pipeline.setIndexCache(&indexCache);
+                            for (int scanId = 0; scanId != nScans; ++scanId)
+                                scans.push_back(&cloudManager.getCloud(firstScan + scanId));
+                            acq::setupPipeline(manifest, scans, pipeline);
+                            // Grow a model from the reference, adding one scan at a time
+                            if (!manifest.hasParents())
+                                pipeline.setPairing(acq::RegistrationPipeline::INCREMENTAL, manifest.reference);
+                            pipeline.setVoxelSize(voxel_size);
+
+                            acq::PosesT const poses =
+                                    acq::runRegistration(pipeline, refine_poses, close_loops, manifest.getThreadCount());
+                            if (voxel_size <= 0.) {
+                                acq::showRegisteredScans(viewer, cloudManager, scans, poses);
+                                return;
                             }
-                            cout<< "Iterations: "<<count << "\n";
-                            time = (clock() - t_start) * 1.0 / CLOCKS_PER_SEC;
-                            cout << "Processing Time: " << time << " s" << endl;
-
-                            MatrixXd V5_result;
-                            MatrixXi F5_result;
-                            V5_result = Qv;
-                            F5_result = F_5;
-
-                            MatrixXd result_V(total_V, dim);
-                            MatrixXi result_F(total_F, F_1.cols());
-                            result_V << V1_result, V2_result, V_3, V4_result, V5_result;
-
-                            result_F <<  F_2,
-                                        (F_2.array() + V_1.rows()),
-                                        (F_3.array() + V_1.rows() + V_2.rows()),
-                                        (F_4.array() + V_1.rows() + V_2.rows() + V_3.rows()),
-                                        (F_5.array() + V_1.rows() + V_2.rows() + V_3.rows() + V_4.rows());
-
-                            RowVector3d m1_color(0, 0, 1);
-                            RowVector3d m2_color(0, 1, 0);
-                            RowVector3d m3_color(1, 0, 0);
-                            RowVector3d m4_color(0.5, 0.5, 0.5);
-                            RowVector3d m5_color(0, 0.5, 0.5);
-
-                            Eigen::MatrixXd Color(result_F.rows(), dim);
-
-
-                            Color << m1_color.replicate(F_1.rows(),1),
-                                     m2_color.replicate(F_2.rows(),1),
-                                     m3_color.replicate(F_3.rows(),1),
-                                     m4_color.replicate(F_4.rows(),1),
-                                     m5_color.replicate(F_5.rows(),1);
 
+                            // Show merged model as points
+                            cloudManager.setCloud(pipeline.getModel(), 0);
+                            std::cout << "Model points: " << cloudManager.getCloud(0).getVertices().rows() << "\n";
                             viewer.data.clear();
-                            cloudManager.setCloud(acq::DecoratedCloud(result_V, result_F),0);
-
-                            viewer.data.set_mesh(result_V,result_F);
-                            viewer.data.set_colors(Color);
-
+                            viewer.data.set_points(
+                                    cloudManager.getCloud(0).getVertices(),
+                                    Eigen::RowVector3d(0, 0, 1)
+                            );
                         }
                 );
                 viewer.ngui->addButton(
-                        "Multi-Scan 2",
+                        "Chained Prefetch",
                         [&](){
-                            cloudManager.setCloud(acq::DecoratedCloud(V_1, F_1),1);
-                            cloudManager.setCloud(acq::DecoratedCloud(V_2, F_2),2);
-                            cloudManager.setCloud(acq::DecoratedCloud(V_3, F_3),3);
-                            cloudManager.setCloud(acq::DecoratedCloud(V_4, F_4),4);
-                            cloudManager.setCloud(acq::DecoratedCloud(V_5, F_5),5);
-                            viewer.data.clear();
-                            int total_V = V_1.rows() + V_2.rows() + V_3.rows() + V_4.rows() + V_5.rows();
-                            int total_F = F_1.rows() + F_2.rows() + F_3.rows() + F_4.rows() + F_5.rows();
-                            int dim = 3;
-
-                            Eigen::MatrixXd R, Pv, Qv;
-                            Eigen::MatrixXi Pf, Qf;
-                            Eigen::Vector3d t;
-                            double d_diff = 1000;
-                            double pre_diff = 1000;
-                            double t_start;
-                            double time;
-                            int count = 0;
-                            MatrixXd no;
-
-                            //ICP mesh 1-2
-                            tie(no, Pv) = msh.rotate(cloudManager.getCloud(3).getVertices(), 0, 0, 0);
-                            Pf = cloudManager.getCloud(3).getFaces();
-
-                            tie(no, Qv) = msh.rotate(cloudManager.getCloud(1).getVertices(), 0, -90, 0);
-                            Qf = cloudManager.getCloud(1).getFaces();
-
-                            t_start = clock();
-                            for (int i = 0; i < max_iteration; i++){
-                                count++;
-                                tie(R, t, d_diff) = msh.ICP(Pv, Qv, step_size);
-                                d_diff = abs(d_diff);
-                                Qv = (R * Qv.transpose()).transpose() + t.replicate(1, Qv.rows()).transpose();
-                                if ((d_diff > pre_diff && d_diff < 0.0001) || i > max_iteration) {
-                                    cout << "\nEnd distance: " << d_diff << "\n";
-                                    break;
-                                }
-                                pre_diff = d_diff;
-                            }
-                            cout<< "Iterations: "<<count << "\n";
-                            time = (clock() - t_start) * 1.0 / CLOCKS_PER_SEC;
-                            cout << "Processing Time: " << time << " s" << endl;
-
-                            MatrixXd result_V12(Qv.rows() + Qv.rows(), dim);
-                            MatrixXi result_F12(Pf.rows() + Qf.rows(), Pf.cols());
-                            result_V12 << Qv, Pv;
-                            result_F12 << Qf, (Pf.array() + Qv.rows());
-
-                            //ICP mesh 3-12
-
-                            Pv = result_V12;
-                            Pf = result_F12;
-
-                            tie(no, Qv) = msh.rotate(cloudManager.getCloud(2).getVertices(), 0, -45, 0);
-                            Qf = cloudManager.getCloud(2).getFaces();
-
-                            d_diff = 1000;
-                            pre_diff = 1000;
-                            count = 0;
-
-                            t_start = clock();
-                            for (int i = 0; i < max_iteration; i++){
-                                count++;
-                                tie(R, t, d_diff) = msh.ICP(Pv, Qv, step_size);
-                                d_diff = abs(d_diff);
-                                Qv = (R * Qv.transpose()).transpose() + t.replicate(1, Qv.rows()).transpose();
-                                if ((d_diff > pre_diff && d_diff < 0.0001) || i > max_iteration) {
-                                    cout << "\nEnd distance: " << d_diff << "\n";
-                                    break;
-                                }
-                                pre_diff = d_diff;
-                            }
-                            cout<< "Iterations: "<<count << "\n";
-                            time = (clock() - t_start) * 1.0 / CLOCKS_PER_SEC;
-                            cout << "Processing Time: " << time << " s" << endl;
-
-                            MatrixXd result_V32;
-                            result_V32.resize(Pv.rows() + Qv.rows(), dim);
-                            MatrixXi result_F32(Pf.rows() + Qf.rows(), Pf.cols());
-                            result_V32 << Qv, Pv;
-                            result_F32 << Qf, (Pf.array() + Qv.rows());
-
-
-                            //ICP mesh 5-4
-                            Pv = result_V32;
-                            Pf = result_F32;
-
-                            tie(no, Qv) = msh.rotate(cloudManager.getCloud(4).getVertices(), 0, 90, 0);
-                            Qf = cloudManager.getCloud(4).getFaces();
-
-                            d_diff = 1000;
-                            pre_diff = 1000;
-                            count = 0;
-
-                            t_start = clock();
-                            for (int i = 0; i < max_iteration; i++){
-                                count++;
-                                tie(R, t, d_diff) = msh.ICP(Pv, Qv, step_size);
-                                d_diff = abs(d_diff);
-                                Qv = (R * Qv.transpose()).transpose() + t.replicate(1, Qv.rows()).transpose();
-                                if ((d_diff > pre_diff && d_diff < 0.0001) || i > max_iteration) {
-                                    cout << "\nEnd distance: " << d_diff << "\n";
-                                    break;
-                                }
-                                pre_diff = d_diff;
-                            }
-                            cout<< "Iterations: "<<count << "\n";
-                            time = (clock() - t_start) * 1.0 / CLOCKS_PER_SEC;
-                            cout << "Processing Time: " << time << " s" << endl;
-
-                            MatrixXd result_V54;
-                            result_V54.resize(Pv.rows() + Qv.rows(), dim);
-                            MatrixXi result_F54(Pf.rows() + Qf.rows(), Pf.cols());
-                            result_V54 << Qv, Pv;
-                            result_F54 << Qf, (Pf.array() + Qv.rows());
-
-                            //ICP mesh 4_123
-                            Pv = result_V54;
-                            Pf = result_F54;
-
-                            tie(no, Qv) = msh.rotate(cloudManager.getCloud(5).getVertices(), -90, 0, 0);
-                            Qf = cloudManager.getCloud(5).getFaces();
-
-                            d_diff = 1000;
-                            pre_diff = 1000;
-                            count = 0;
-
-                            t_start = clock();
-                            for (int i = 0; i < max_iteration; i++){
-                                count++;
-                                tie(R, t, d_diff) = msh.ICP(Pv, Qv, step_size);
-                                d_diff = abs(d_diff);
-                                Qv = (R * Qv.transpose()).transpose() + t.replicate(1, Qv.rows()).transpose();
-                                if ((d_diff > pre_diff && d_diff < 0.0001) || i > max_iteration) {
-                                    cout << "\nEnd distance: " << d_diff << "\n";
-                                    break;
-                                }
-                                pre_diff = d_diff;
+                            // Chain the scans from disk, loading the next ones while aligning
+                            acq::IcpParams params = manifest.icp;
+                            params.maxIterations = max_iteration;
+                            params.stepSize      = step_size;
+                            acq::PrefetchParams prefetchParams;
+                            prefetchParams.voxelSize = voxel_size;
+
+                            // The initial guesses of the manifest, each loaded scan centred on its mean and rotated
+                            acq::PosesT initialPoses;
+                            for (int scanId = 0; scanId != nScans; ++scanId)
+                                initialPoses.push_back(acq::getInitialPose(
+                                        manifest.scans[scanId], cloudManager.getCloud(firstScan + scanId).getVertices()));
+
+                            std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+                            acq::ScanPrefetcher prefetcher(manifest.getPaths(), prefetchParams);
+                            acq::RegistrationPipeline::PairResultsT pairResults;
+                            acq::PosesT const poses = acq::registerSequence(prefetcher, params, initialPoses, &pairResults);
+                            double const time =
+                                    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                            double icpTime = 0.;
+                            for (acq::RegistrationPipeline::PairResult const& pair : pairResults) {
+                                std::cout << "\nScan " << pair.source << " -> " << pair.target << "\n"
+                                          << "End distance: " << pair.icp.error << "\n"
+                                          << "Iterations: " << pair.icp.iterations << "\n"
+                                          << "Processing Time: " << pair.time << " s\n";
+                                icpTime += pair.time;
                             }
-                            cout<< "Iterations: "<<count << "\n";
-                            time = (clock() - t_start) * 1.0 / CLOCKS_PER_SEC;
-                            cout << "Processing Time: " << time << " s" << endl;
-
-                            MatrixXd result_V;
-                            result_V.resize(Pv.rows() + Qv.rows(), dim);
-                            MatrixXi result_F(Pf.rows() + Qf.rows(), Pf.cols());
-                            result_V << Qv, Pv;
-                            result_F << Qf, (Pf.array() + Qv.rows());
-
-//                            MatrixXd result_V(total_V, dim);
-//                            MatrixXi result_F(total_F, F_1.cols());
-//                            result_V << V1_result, V2_result, V_3, V4_result, V5_result;
-//                              result_F << F_1, (F_2.array() + V_1.rows()), (F_3.array() + V_2.rows() + V_1.rows()), (F_4.array() + V_3.rows() + V_2.rows() + V_1.rows()), (F_5.array() + V_4.rows() + V_3.rows() + V_2.rows() + V_1.rows());
-//                            result_F <<  F_2,
-//                                    (F_2.array() + V_1.rows()),
-//                                    (F_3.array() + V_1.rows() + V_2.rows()),
-//                                    (F_4.array() + V_1.rows() + V_2.rows() + V_3.rows()),
-//                                    (F_5.array() + V_1.rows() + V_2.rows() + V_3.rows() + V_4.rows());
-
-                            RowVector3d m1_color(0, 0, 1);
-                            RowVector3d m2_color(0, 1, 0);
-                            RowVector3d m3_color(1, 0, 0);
-                            RowVector3d m4_color(0.5, 0.5, 0.5);
-                            RowVector3d m5_color(0, 0.5, 0.5);
-//
-//
-                            Eigen::MatrixXd Color(result_F.rows(), dim);
-//
-//
-                            Color << m1_color.replicate(F_1.rows(),1),
-                                    m2_color.replicate(F_2.rows(),1),
-                                    m3_color.replicate(F_3.rows(),1),
-                                    m4_color.replicate(F_4.rows(),1),
-                                    m5_color.replicate(F_5.rows(),1);
-
-                            viewer.data.clear();
-                            cloudManager.setCloud(acq::DecoratedCloud(result_V, result_F),0);
-
-                            viewer.data.set_mesh(result_V,result_F);
-                            viewer.data.set_colors(Color);
-
+                            std::cout << "\nAlignment Time: " << icpTime << " s\n"
+                                      << "Waiting for scans: " << prefetcher.getWaitTime() << " s\n"
+                                      << "Total Time: " << time << " s" << std::endl;
+
+                            // Show the full resolution scans of the same files
+                            std::vector<acq::DecoratedCloud const*> scans;
+                            for (int scanId = 0; scanId != nScans; ++scanId)
+                                scans.push_back(&cloudManager.getCloud(firstScan + scanId));
+                            acq::showRegisteredScans(viewer, cloudManager, scans, poses);
                         }
                 );
                 viewer.ngui->addButton(
@@ -780,8 +710,9 @@ int main(int argc, char *argv[]) {
                                      m2_color.replicate(F_2.rows(),1);
 
                             cloudManager.setCloud(acq::DecoratedCloud(disp_V, disp_F),0);
-                            cloudManager.setCloud(acq::DecoratedCloud(V_1, F_1),6);
-                            cloudManager.setCloud(acq::DecoratedCloud(V_2, F_2),7);
+                            // Fresh working copies, with the normals of the scans
+                            cloudManager.getCloud(copy1) = cloudManager.getCloud(firstScan);
+                            cloudManager.getCloud(copy2) = cloudManager.getCloud(firstScan + 1);
                             // Show mesh
                             viewer.data.clear();
                             viewer.data.set_mesh(
@@ -791,6 +722,16 @@ int main(int argc, char *argv[]) {
                             viewer.data.set_colors(Color);
                         }
                 );
+                viewer.ngui->addButton(
+                        "Save PLY",
+                        [&]() {
+                            // Writes the cloud shown last, e.g. the aligned or merged scans
+                            acq::DecoratedCloud const& shown = cloudManager.getCloud(0);
+                            if (acq::writePly("result.ply", shown))
+                                std::cout << "Wrote result.ply: " << shown.getVertices().rows() << " vertices, "
+                                          << shown.getFaces().rows() << " faces" << std::endl;
+                        }
+                );
 
                 // Generate menu
                 viewer.screen->performLayout();
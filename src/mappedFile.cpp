@@ -0,0 +1,133 @@
+#include "acq/mappedFile.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+namespace acq {
+
+MappedFile::MappedFile()
+    : _data(nullptr), _size(0), _open(false)
+#ifdef _WIN32
+    , _file(nullptr), _mapping(nullptr)
+#endif
+{}
+
+MappedFile::MappedFile(std::string const& path) : MappedFile() {
+    open(path);
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(std::string const& path) {
+    close();
+
+    HANDLE const file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                    OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "[MappedFile::open] Could not open " << path << "\n";
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        std::cerr << "[MappedFile::open] Could not get the size of " << path << "\n";
+        CloseHandle(file);
+        return false;
+    }
+    _file = file;
+    _size = static_cast<size_t>(size.QuadPart);
+    _open = true;
+
+    // Empty files can not be mapped, but are valid
+    if (!_size)
+        return true;
+
+    _mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping)
+        _data = static_cast<char const*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!_data) {
+        std::cerr << "[MappedFile::open] Could not map " << path << "\n";
+        close();
+        return false;
+    }
+
+    return true;
+} //...MappedFile::open()
+
+void MappedFile::close() {
+    if (_data)
+        UnmapViewOfFile(_data);
+    if (_mapping)
+        CloseHandle(_mapping);
+    if (_file)
+        CloseHandle(_file);
+    _data    = nullptr;
+    _mapping = nullptr;
+    _file    = nullptr;
+    _size    = 0;
+    _open    = false;
+} //...MappedFile::close()
+
+#else // POSIX
+
+bool MappedFile::open(std::string const& path) {
+    close();
+
+    int const fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "[MappedFile::open] Could not open " << path << "\n";
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info)) {
+        std::cerr << "[MappedFile::open] Could not get the size of " << path << "\n";
+        ::close(fd);
+        return false;
+    }
+    _size = static_cast<size_t>(info.st_size);
+
+    // Empty files can not be mapped, but are valid
+    if (_size) {
+        void *const mapped = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            std::cerr << "[MappedFile::open] Could not map " << path << "\n";
+            ::close(fd);
+            _size = 0;
+            return false;
+        }
+        _data = static_cast<char const*>(mapped);
+    }
+
+    // The mapping keeps the file alive
+    ::close(fd);
+    _open = true;
+    return true;
+} //...MappedFile::open()
+
+void MappedFile::close() {
+    if (_data)
+        munmap(const_cast<char*>(_data), _size);
+    _data = nullptr;
+    _size = 0;
+    _open = false;
+} //...MappedFile::close()
+
+#endif //...POSIX
+
+} //...ns acq
@@ -0,0 +1,408 @@
+#include "acq/meshIO.h"
+
+#include "acq/cloudFile.h"
+#include "acq/mappedFile.h"
+#include "acq/plyIO.h"
+#include "acq/impl/parallel.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace acq {
+
+namespace {
+    //! Target size of the chunks parsed in parallel.
+    size_t const CHUNK_BYTES = 1 << 18;
+
+    //! Powers of ten that are exact doubles.
+    double const EXACT_POW10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    /** \brief Line aligned part of the file. */
+    struct Chunk {
+        char const* begin;     //!< First byte, start of a line.
+        char const* end;       //!< One past the last byte, start of a line or end of file.
+        size_t      firstLine; //!< Global number of the first data line in the chunk.
+        size_t      nLines;    //!< Number of data lines in the chunk.
+    }; //...struct Chunk
+
+    inline bool isBlank(char const c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    inline bool isDigit(char const c) {
+        return c >= '0' && c <= '9';
+    }
+
+    inline void skipBlanks(char const* &it, char const* const end) {
+        while (it != end && isBlank(*it))
+            ++it;
+    }
+
+    /** \brief True, if the line holds data, i.e. it is neither empty nor a comment. */
+    inline bool isDataLine(char const* it, char const* const end) {
+        skipBlanks(it, end);
+        return it != end && *it != '#';
+    }
+
+    /** \brief Calls \p func(lineBegin, lineEnd) for every data line in [\p begin, \p end). */
+    template <typename _FuncT>
+    void forEachDataLine(char const* begin, char const* const end, _FuncT const& func) {
+        while (begin < end) {
+            char const* lineEnd = static_cast<char const*>(std::memchr(begin, '\n', end - begin));
+            if (!lineEnd)
+                lineEnd = end;
+            if (isDataLine(begin, lineEnd) && !func(begin, lineEnd))
+                return;
+            begin = lineEnd + 1;
+        }
+    } //...forEachDataLine()
+
+    /** \brief Parses a decimal floating point number at \p it, advancing \p it past it.
+     *
+     * Numbers with at most 19 significant digits and a small exponent are
+     * computed exactly from their integer mantissa and an exact power of ten
+     * (one correctly rounded multiplication or division), the rest by strtod.
+     */
+    bool parseDouble(char const* &it, char const* const end, double &value) {
+        skipBlanks(it, end);
+        char const* const start = it;
+
+        bool const negative = it != end && *it == '-';
+        if (it != end && (*it == '-' || *it == '+'))
+            ++it;
+
+        uint64_t mantissa  = 0;
+        int      nDigits   = 0; // Significant digits in mantissa
+        int      exponent  = 0;
+        bool     anyDigit  = false;
+        bool     truncated = false;
+        for (; it != end && isDigit(*it); ++it) {
+            anyDigit = true;
+            if (nDigits < 19) {
+                mantissa = mantissa * 10 + (*it - '0');
+                nDigits += mantissa != 0;
+            } else {
+                truncated |= *it != '0';
+                ++exponent;
+            }
+        }
+        if (it != end && *it == '.') {
+            for (++it; it != end && isDigit(*it); ++it) {
+                anyDigit = true;
+                if (nDigits < 19) {
+                    mantissa = mantissa * 10 + (*it - '0');
+                    nDigits += mantissa != 0;
+                    --exponent;
+                } else
+                    truncated |= *it != '0';
+            }
+        }
+        if (!anyDigit) {
+            it = start;
+            return false;
+        }
+        if (it != end && (*it == 'e' || *it == 'E')) {
+            char const* expIt = it + 1;
+            bool const expNegative = expIt != end && *expIt == '-';
+            if (expIt != end && (*expIt == '-' || *expIt == '+'))
+                ++expIt;
+            if (expIt != end && isDigit(*expIt)) {
+                int explicitExp = 0;
+                for (; expIt != end && isDigit(*expIt); ++expIt)
+                    explicitExp = std::min(explicitExp * 10 + (*expIt - '0'), 100000);
+                exponent += expNegative ? -explicitExp : explicitExp;
+                it = expIt;
+            }
+        }
+
+        if (!truncated && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+            double const magnitude = exponent < 0 ? static_cast<double>(mantissa) / EXACT_POW10[-exponent]
+                                                  : static_cast<double>(mantissa) * EXACT_POW10[exponent];
+            value = negative ? -magnitude : magnitude;
+            return true;
+        }
+
+        // Rare: long or extreme numbers
+        std::string const token(start, it);
+        value = std::strtod(token.c_str(), nullptr);
+        return true;
+    } //...parseDouble()
+
+    /** \brief Parses a decimal integer at \p it, advancing \p it past it. */
+    bool parseInt(char const* &it, char const* const end, long long &value) {
+        skipBlanks(it, end);
+        bool const negative = it != end && *it == '-';
+        if (it != end && (*it == '-' || *it == '+'))
+            ++it;
+        if (it == end || !isDigit(*it))
+            return false;
+        value = 0;
+        for (; it != end && isDigit(*it); ++it)
+            value = std::min(value * 10 + (*it - '0'), static_cast<long long>(std::numeric_limits<int>::max()) + 1);
+        if (negative)
+            value = -value;
+        return true;
+    } //...parseInt()
+
+    /** \brief Finds data line \p lineId, returns false if the file has fewer lines. */
+    bool findDataLine(
+        std::vector<Chunk> const& chunks,
+        size_t             const  lineId,
+        char const*             & lineBegin,
+        char const*             & lineEnd
+    ) {
+        for (Chunk const& chunk : chunks) {
+            if (lineId >= chunk.firstLine + chunk.nLines)
+                continue;
+            size_t current = chunk.firstLine;
+            forEachDataLine(chunk.begin, chunk.end, [&](char const* begin, char const* end) {
+                if (current++ != lineId)
+                    return true;
+                lineBegin = begin;
+                lineEnd   = end;
+                return false;
+            });
+            return true;
+        }
+        return false;
+    } //...findDataLine()
+
+    bool
+    readOffImpl(
+        std::string const& path,
+        CloudT           & vertices,
+        FacesT           & faces,
+        NormalsT         * normals,
+        ReadStats        * stats,
+        unsigned    const  nThreads
+    ) {
+        typedef std::chrono::steady_clock ClockT;
+        ClockT::time_point const start = ClockT::now();
+
+        MappedFile file;
+        if (!file.open(path))
+            return false;
+        char const* const data = file.data();
+        char const* const end  = data + file.size();
+
+        // Line aligned chunks
+        std::vector<Chunk> chunks;
+        for (char const* begin = data; begin < end; ) {
+            char const* chunkEnd = std::min(begin + CHUNK_BYTES, end);
+            if (chunkEnd != end) {
+                char const* newline = static_cast<char const*>(std::memchr(chunkEnd, '\n', end - chunkEnd));
+                chunkEnd = newline ? newline + 1 : end;
+            }
+            Chunk chunk;
+            chunk.begin     = begin;
+            chunk.end       = chunkEnd;
+            chunk.firstLine = 0;
+            chunk.nLines    = 0;
+            chunks.push_back(chunk);
+            begin = chunkEnd;
+        }
+
+        // Count data lines per chunk, then number them by prefix sum
+        parallelFor(chunks.size(), [&](size_t const chunkId) {
+            Chunk &chunk = chunks[chunkId];
+            forEachDataLine(chunk.begin, chunk.end, [&](char const*, char const*) {
+                ++chunk.nLines;
+                return true;
+            });
+        }, 1, nThreads);
+        size_t nLines = 0;
+        for (Chunk &chunk : chunks) {
+            chunk.firstLine = nLines;
+            nLines         += chunk.nLines;
+        }
+
+        // Header: keyword, optionally followed by the counts on the same line
+        char const *lineBegin = nullptr, *lineEnd = nullptr;
+        if (!findDataLine(chunks, 0, lineBegin, lineEnd)) {
+            std::cerr << "[readOff] " << path << " is empty\n";
+            return false;
+        }
+        skipBlanks(lineBegin, lineEnd);
+        char const* keywordEnd = lineBegin;
+        while (keywordEnd != lineEnd && !isBlank(*keywordEnd))
+            ++keywordEnd;
+        std::string const keyword(lineBegin, keywordEnd);
+        if (keyword.size() < 3 || keyword.compare(keyword.size() - 3, 3, "OFF")) {
+            std::cerr << "[readOff] " << path << " does not start with OFF, but " << keyword << "\n";
+            return false;
+        }
+        bool const hasNormals = keyword.find('N') != std::string::npos;
+
+        size_t    vertexStart = 1;
+        long long nVertices = -1, nFaces = -1;
+        char const* it = keywordEnd;
+        if (!parseInt(it, lineEnd, nVertices)) {
+            if (!findDataLine(chunks, 1, lineBegin, lineEnd)) {
+                std::cerr << "[readOff] " << path << " has no element counts\n";
+                return false;
+            }
+            it          = lineBegin;
+            vertexStart = 2;
+            parseInt(it, lineEnd, nVertices);
+        }
+        if (!parseInt(it, lineEnd, nFaces) || nVertices < 0 || nFaces < 0) {
+            std::cerr << "[readOff] " << path << " has invalid element counts\n";
+            return false;
+        }
+        size_t const faceStart = vertexStart + nVertices;
+        if (nLines < faceStart + nFaces) {
+            std::cerr << "[readOff] " << path << " is truncated, expected " << nVertices << " vertices and "
+                      << nFaces << " faces\n";
+            return false;
+        }
+
+        // Face size from the first face
+        long long faceSize = 3;
+        if (nFaces) {
+            findDataLine(chunks, faceStart, lineBegin, lineEnd);
+            if (!parseInt(lineBegin, lineEnd, faceSize) || faceSize < 1) {
+                std::cerr << "[readOff] " << path << " has an invalid first face\n";
+                return false;
+            }
+        }
+
+        vertices.resize(nVertices, 3);
+        faces.resize(nFaces, faceSize);
+        if (normals)
+            normals->resize(hasNormals ? nVertices : 0, 3);
+
+        // Parse all chunks at once, remembering the first bad line of each
+        size_t const noError = std::numeric_limits<size_t>::max();
+        std::vector<size_t> badLine(chunks.size(), noError);
+        parallelFor(chunks.size(), [&](size_t const chunkId) {
+            Chunk const& chunk  = chunks[chunkId];
+            size_t       lineId = chunk.firstLine;
+            forEachDataLine(chunk.begin, chunk.end, [&](char const* begin, char const* end) {
+                bool ok = true;
+                if (lineId >= vertexStart && lineId < faceStart) {
+                    Eigen::Index const row = lineId - vertexStart;
+                    double x, y, z;
+                    ok = parseDouble(begin, end, x) && parseDouble(begin, end, y) && parseDouble(begin, end, z);
+                    vertices(row, 0) = x;
+                    vertices(row, 1) = y;
+                    vertices(row, 2) = z;
+                    if (ok && hasNormals) {
+                        ok = parseDouble(begin, end, x) && parseDouble(begin, end, y) && parseDouble(begin, end, z);
+                        if (normals) {
+                            (*normals)(row, 0) = x;
+                            (*normals)(row, 1) = y;
+                            (*normals)(row, 2) = z;
+                        }
+                    }
+                } else if (lineId >= faceStart && lineId < faceStart + nFaces) {
+                    Eigen::Index const row = lineId - faceStart;
+                    long long count, index;
+                    ok = parseInt(begin, end, count) && count == faceSize;
+                    for (Eigen::Index col = 0; ok && col != faceSize; ++col) {
+                        ok = parseInt(begin, end, index) && index >= 0 && index < nVertices;
+                        faces(row, col) = static_cast<int>(index);
+                    }
+                } else if (lineId >= faceStart + nFaces)
+                    return false; // Ignore anything after the faces
+
+                if (!ok) {
+                    badLine[chunkId] = lineId;
+                    return false;
+                }
+                ++lineId;
+                return true;
+            });
+        }, 1, nThreads);
+
+        size_t const firstBad = *std::min_element(badLine.begin(), badLine.end());
+        if (firstBad != noError) {
+            std::cerr << "[readOff] " << path << ": could not parse data line " << firstBad
+                      << (firstBad < faceStart ? " (vertex)" : " (face, all need " + std::to_string(faceSize)
+                                                               + " valid indices)") << "\n";
+            return false;
+        }
+
+        if (stats) {
+            stats->bytes   = file.size();
+            stats->chunks  = chunks.size();
+            stats->seconds = std::chrono::duration<double>(ClockT::now() - start).count();
+        }
+        return true;
+    } //...readOffImpl()
+} //...ns anonymous
+
+bool
+readOff(
+    std::string const& path,
+    CloudT           & vertices,
+    FacesT           & faces,
+    ReadStats        * stats,
+    unsigned    const  nThreads
+) {
+    return readOffImpl(path, vertices, faces, nullptr, stats, nThreads);
+} //...readOff()
+
+bool
+readOff(
+    std::string const& path,
+    DecoratedCloud   & cloud,
+    ReadStats        * stats,
+    unsigned    const  nThreads
+) {
+    return readOffImpl(path, cloud.getVertices(), cloud.getFaces(), &cloud.getNormals(), stats, nThreads);
+} //...readOff()
+
+std::string
+getExtension(std::string const& path) {
+    size_t const dot = path.find_last_of('.');
+    if (dot == std::string::npos || path.find_first_of("/\\", dot) != std::string::npos)
+        return std::string();
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char const c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+} //...getExtension()
+
+bool
+readMesh(
+    std::string const& path,
+    DecoratedCloud   & cloud,
+    ReadStats        * stats,
+    unsigned    const  nThreads
+) {
+    std::string const extension = getExtension(path);
+    if (extension == "off")
+        return readOff(path, cloud, stats, nThreads);
+    if (extension == "ply")
+        return readPly(path, cloud, stats);
+    if (extension == "acqc") {
+        typedef std::chrono::steady_clock ClockT;
+        ClockT::time_point const start = ClockT::now();
+        CloudFile const file(path);
+        if (!file.isOpen())
+            return false;
+        file.copyTo(cloud);
+        if (stats) {
+            stats->bytes   = file.getFileSize();
+            stats->chunks  = 1;
+            stats->seconds = std::chrono::duration<double>(ClockT::now() - start).count();
+        }
+        return true;
+    }
+
+    std::cerr << "[readMesh] Unknown extension of " << path << ", expected .off, .ply or .acqc\n";
+    return false;
+} //...readMesh()
+
+} //...ns acq
@@ -0,0 +1,205 @@
+#include "acq/modelAccumulator.h"
+
+#include "new_nanoflann/nanoflann.hpp" // Nearest neighbour lookup in a pointcloud
+
+#include <cmath>
+#include <vector>
+
+namespace acq {
+
+/** \brief nanoflann dataset adaptor and dynamic tree over \ref ModelAccumulator::_points. */
+struct ModelAccumulator::Tree {
+    //! Point dimensions
+    enum { Dim = 3 };
+    //! Dynamic KD-tree type
+    typedef nanoflann::KDTreeSingleIndexDynamicAdaptor<
+        /* Distance metric: */ nanoflann::L2_Simple_Adaptor<double, Tree>,
+        /* Dataset adaptor: */ Tree,
+        /*  Dimensionality: */ Dim,
+        /*      Index type: */ size_t
+    > KdTreeT;
+
+    /** \brief Dynamic KD-tree inserting a block of points at once.
+     *
+     * nanoflann's addPoints() merges and rebuilds sub-trees for every single point. Here the
+     * sub-trees up to the highest one whose occupancy changes are gathered with the whole
+     * block, and each refilled sub-tree is built once.
+     */
+    struct IndexT : public KdTreeT {
+        IndexT(Tree &dataset, nanoflann::KDTreeSingleIndexAdaptorParams const& params)
+            : KdTreeT(Dim, dataset, params)
+        {}
+
+        /** \brief Inserts points [\p first, \p last] keeping sub-tree i of size 2^i iff bit i of the point count is set. */
+        void addBlock(size_t const first, size_t const last) {
+            size_t const newCount = pointCount + (last - first + 1);
+            treeIndex.resize(newCount);
+
+            // Sub-trees above the highest changed bit keep their points
+            int top = 0;
+            for (size_t changed = (pointCount ^ newCount) >> 1; changed; changed >>= 1)
+                ++top;
+
+            std::vector<size_t> pointIds;
+            pointIds.reserve(newCount & ((size_t(2) << top) - 1));
+            for (int level = 0; level <= top; ++level) {
+                pointIds.insert(pointIds.end(), index[level].vind.begin(), index[level].vind.end());
+                index[level].vind.clear();
+                index[level].freeIndex(index[level]);
+            }
+            for (size_t pointId = first; pointId <= last; ++pointId)
+                pointIds.push_back(pointId);
+
+            std::vector<size_t>::const_iterator next = pointIds.begin();
+            for (int level = top; level >= 0; --level) {
+                if (!((newCount >> level) & 1))
+                    continue;
+                std::vector<size_t>::const_iterator const end = next + (size_t(1) << level);
+                index[level].vind.assign(next, end);
+                for (; next != end; ++next)
+                    treeIndex[*next] = level;
+                index[level].buildIndex();
+            }
+            pointCount = newCount;
+        } //...addBlock()
+    }; //...struct IndexT
+
+    Tree(std::deque<Eigen::Vector3d> const& points, int const maxLeafs)
+        : _points(points),
+          _index(*this, nanoflann::KDTreeSingleIndexAdaptorParams(maxLeafs))
+    {}
+
+    // nanoflann dataset interface
+    size_t kdtree_get_point_count() const { return _points.size(); }
+    double kdtree_get_pt(size_t const idx, int const dim) const { return _points[idx][dim]; }
+    template <class BBOX> bool kdtree_get_bbox(BBOX&) const { return false; }
+
+    std::deque<Eigen::Vector3d> const& _points; //!< Owned by the enclosing \ref ModelAccumulator.
+    IndexT                             _index;  //!< The tree, has to be initialized after \ref _points.
+}; //...struct ModelAccumulator::Tree
+
+ModelAccumulator::ModelAccumulator(double const voxelSize, int const maxLeafs)
+    : _voxelSize(voxelSize), _hasNormals(true), _tree(new Tree(_points, maxLeafs))
+{}
+
+ModelAccumulator::~ModelAccumulator() {}
+
+size_t ModelAccumulator::addScan(CloudT const& vertices, PoseT const& pose) {
+    return addScan(vertices, NormalsT(), pose);
+} //...ModelAccumulator::addScan()
+
+size_t ModelAccumulator::addScan(CloudT const& vertices, NormalsT const& normals, PoseT const& pose) {
+    size_t const first = _points.size();
+    if (!vertices.rows())
+        return first;
+
+    bool const withNormals = normals.rows() == vertices.rows();
+    _hasNormals &= withNormals;
+
+    Eigen::Matrix3d const R = pose.topLeftCorner<3, 3>();
+    Eigen::Vector3d const t = pose.topRightCorner<3, 1>();
+    for (Eigen::Index row = 0; row != vertices.rows(); ++row) {
+        Eigen::Vector3d const point  = R * vertices.row(row).transpose() + t;
+        Eigen::Vector3d       normal =
+            withNormals ? Eigen::Vector3d(R * normals.row(row).transpose())
+                        : Eigen::Vector3d::Zero();
+
+        // Keep every point
+        if (_voxelSize <= 0.) {
+            _points.push_back(point);
+            _normals.push_back(normal);
+            continue;
+        }
+
+        std::pair<std::unordered_map<uint64_t, size_t>::iterator, bool> const voxel =
+            _voxels.insert(std::make_pair(getVoxelKey(point), _points.size()));
+        if (voxel.second) {
+            // First point in voxel, becomes a new model point
+            _points.push_back(point);
+            _normals.push_back(normal);
+            _sums.push_back(point);
+            _counts.push_back(1);
+        } else {
+            // Merge into existing model point
+            size_t const pointId = voxel.first->second;
+            _sums[pointId] += point;
+            ++_counts[pointId];
+            _points[pointId] = _sums[pointId] / _counts[pointId];
+            // Average normals regardless of their orientation
+            if (_normals[pointId].dot(normal) < 0.)
+                normal = -normal;
+            _normals[pointId] += normal;
+        } //...if voxel existed
+    } //...for points
+
+    // Only new model points are indexed, in one block, inclusive range
+    if (_points.size() > first)
+        _tree->_index.addBlock(first, _points.size() - 1);
+    return first;
+} //...ModelAccumulator::addScan()
+
+uint64_t ModelAccumulator::getVoxelKey(Eigen::Vector3d const& point) const {
+    // 21 bits per axis, wraps around after 2^21 voxels
+    uint64_t const mask = (uint64_t(1) << 21) - 1;
+    uint64_t key = 0;
+    for (int dim = 0; dim != 3; ++dim) {
+        int64_t const cell = static_cast<int64_t>(std::floor(point(dim) / _voxelSize));
+        key |= (static_cast<uint64_t>(cell) & mask) << (21 * dim);
+    }
+    return key;
+} //...ModelAccumulator::getVoxelKey()
+
+bool ModelAccumulator::findNearest(Eigen::Vector3d const& query, size_t &pointId, double &distSqr) const {
+    if (_points.empty())
+        return false;
+
+    nanoflann::KNNResultSet<double, size_t> resultSet(1);
+    resultSet.init(&pointId, &distSqr);
+
+    // Search the largest sub-trees first, the smaller ones are then mostly pruned
+    // by the distance found so far
+    auto const& subTrees = _tree->_index.getAllIndices();
+    for (auto it = subTrees.rbegin(); it != subTrees.rend(); ++it)
+        if (!it->vind.empty())
+            it->findNeighbors(resultSet, query.data(), nanoflann::SearchParams());
+
+    return resultSet.size() > 0;
+} //...ModelAccumulator::findNearest()
+
+CloudT ModelAccumulator::getVertices() const {
+    CloudT vertices(_points.size(), 3);
+    for (size_t pointId = 0; pointId != _points.size(); ++pointId)
+        vertices.row(pointId) = _points[pointId].transpose();
+    return vertices;
+} //...ModelAccumulator::getVertices()
+
+NormalsT ModelAccumulator::getNormals() const {
+    if (!hasNormals())
+        return NormalsT();
+
+    NormalsT normals(_normals.size(), 3);
+    for (size_t pointId = 0; pointId != _normals.size(); ++pointId)
+        normals.row(pointId) = _normals[pointId].normalized().transpose();
+    return normals;
+} //...ModelAccumulator::getNormals()
+
+} //...ns acq
+
+
+//
+// Template instantiation
+//
+
+#include "acq/impl/icp.hpp"
+
+namespace acq {
+
+template IcpResult
+alignPointToPoint(
+    CloudT           const& source,
+    ModelAccumulator const& target,
+    PoseT            const& initialPose,
+    IcpParams        const& params
+);
+
+} //...ns acq
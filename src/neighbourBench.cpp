@@ -0,0 +1,115 @@
+#include "acq/decoratedCloud.h"
+#include "acq/halfEdges.h"
+#include "acq/meshIO.h"
+#include "acq/normalEstimation.h"
+#include "acq/parallel.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <utility>
+
+/** \brief Times acq::calculateCloudNeighbours() and acq::calculateCloudNormals() with 1, 2, 4, ... threads
+ *         and checks the results agree. Also times adaptive-radius neighbourhoods of at most k points,
+ *         see acq::calculatePointSpacing(), and on meshes acq::calculateCloudNormalsFromFaces(),
+ *         acq::calculateCloudNeighboursFromFaces() and acq::HalfEdges::fromFaces().
+ *
+ * Usage: neighbourBench [nPoints|input.off|input.ply] [k] [maxThreads]
+ * Without an input, 10M points are sampled from a noisy unit sphere. Defaults: k = 10, maxThreads = 64.
+ */
+int main(int argc, char *argv[]) {
+    typedef std::chrono::steady_clock ClockT;
+
+    std::string const input      = argc > 1 ? argv[1] : "10000000";
+    int         const k          = argc > 2 ? std::atoi(argv[2]) : 10;
+    unsigned    const maxThreads = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 64u;
+    if (k <= 0 || !maxThreads) {
+        std::cerr << "Usage: " << argv[0] << " [nPoints|input.off|input.ply] [k] [maxThreads]\n";
+        return EXIT_FAILURE;
+    }
+
+    acq::CloudT cloud;
+    acq::FacesT faces;
+    if (input.find_first_not_of("0123456789") == std::string::npos) {
+        // Deterministic surface-like samples, so the neighbourhoods are not degenerate
+        std::mt19937                     generator(42);
+        std::normal_distribution<double> normal(0., 1.);
+        std::uniform_real_distribution<double> noise(-0.001, 0.001);
+        cloud.resize(std::atol(input.c_str()), 3);
+        for (Eigen::Index pointId = 0; pointId != cloud.rows(); ++pointId) {
+            Eigen::Vector3d const direction(normal(generator), normal(generator), normal(generator));
+            cloud.row(pointId) = (direction.normalized() * (1. + noise(generator))).transpose();
+        }
+    } else {
+        acq::DecoratedCloud decorated;
+        if (!acq::readMesh(input, decorated)) {
+            std::cerr << "Could not read " << input << "\n";
+            return EXIT_FAILURE;
+        }
+        cloud = decorated.getVertices();
+        faces = decorated.getFaces();
+    }
+    std::cout << cloud.rows() << " points, " << faces.rows() << " faces, k = " << k << ", " << acq::defaultThreadCount() << " cores" << std::endl;
+
+    // Estimated once, as on read
+    Eigen::VectorXd const radii = 3. * acq::calculatePointSpacing(cloud);
+
+    acq::NeighboursT reference;
+    acq::NormalsT    referenceNormals;
+    double           serialTime       = 0.;
+    double           serialNormalTime = 0.;
+    int              nFailed          = 0;
+    for (unsigned nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+        ClockT::time_point const start = ClockT::now();
+        acq::NeighboursT neighbours =
+            acq::calculateCloudNeighbours(cloud, k, std::sqrt(std::numeric_limits<float>::max()) - 1.f, 10, nThreads);
+        ClockT::time_point const searched = ClockT::now();
+        acq::NormalsT normals = acq::calculateCloudNormals(cloud, neighbours, nullptr, nThreads);
+        double const time       = std::chrono::duration<double>(searched - start).count();
+        double const normalTime = std::chrono::duration<double>(ClockT::now() - searched).count();
+        ClockT::time_point const adaptiveStart = ClockT::now();
+        acq::calculateCloudNeighboursInRadius(cloud, radii, k, 10, nThreads);
+        double const adaptiveTime = std::chrono::duration<double>(ClockT::now() - adaptiveStart).count();
+        double       faceTime      = 0.;
+        double       adjacencyTime = 0.;
+        double       halfEdgeTime  = 0.;
+        if (faces.rows()) {
+            ClockT::time_point const faceStart = ClockT::now();
+            acq::calculateCloudNormalsFromFaces(cloud, faces, acq::FACE_WEIGHT_AREA, nullptr, nThreads);
+            ClockT::time_point const adjacencyStart = ClockT::now();
+            acq::calculateCloudNeighboursFromFaces(faces, nThreads);
+            ClockT::time_point const halfEdgeStart = ClockT::now();
+            acq::HalfEdges::fromFaces(faces, static_cast<size_t>(cloud.rows()), nThreads);
+            faceTime      = std::chrono::duration<double>(adjacencyStart - faceStart).count();
+            adjacencyTime = std::chrono::duration<double>(halfEdgeStart - adjacencyStart).count();
+            halfEdgeTime  = std::chrono::duration<double>(ClockT::now() - halfEdgeStart).count();
+        }
+
+        bool same = true;
+        if (nThreads == 1) {
+            serialTime       = time;
+            serialNormalTime = normalTime;
+            reference        = std::move(neighbours);
+            referenceNormals = std::move(normals);
+        } else {
+            same = neighbours.getOffsets() == reference.getOffsets() && neighbours.getIds() == reference.getIds()
+                   && normals == referenceNormals;
+            nFailed += !same;
+        }
+
+        std::cout << nThreads << " threads: neighbours " << time << " s, speedup " << serialTime / time
+                  << ", efficiency " << serialTime / time / nThreads
+                  << "; normals " << normalTime << " s, speedup " << serialNormalTime / normalTime
+                  << "; adaptive neighbours " << adaptiveTime << " s";
+        if (faces.rows())
+            std::cout << "; from faces " << faceTime << " s, " << (time + normalTime) / faceTime << "x cheaper"
+                      << "; face adjacency " << adjacencyTime << " s, half-edges " << halfEdgeTime << " s";
+        std::cout << (same ? "" : ", MISMATCH") << std::endl;
+    } //...for thread counts
+
+    return nFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+} //...main()
@@ -0,0 +1,161 @@
+#include "acq/neighbours.h"
+
+#include "acq/impl/parallel.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace acq {
+
+Neighbours::Neighbours()
+    : _offsets(1, 0)
+{}
+
+Neighbours::Neighbours(
+    std::vector<size_t> offsets,
+    std::vector<IdT>    ids,
+    std::vector<double> distsSqr
+) : _offsets(std::move(offsets)), _ids(std::move(ids)), _distsSqr(std::move(distsSqr))
+{
+    if (_offsets.empty() || _offsets.front() != 0 || _offsets.back() != _ids.size()
+        || !std::is_sorted(_offsets.begin(), _offsets.end())
+        || (!_distsSqr.empty() && _distsSqr.size() != _ids.size())) {
+        std::cerr << "[Neighbours::Neighbours] Invalid CSR arrays: " << _offsets.size() << " offsets, "
+                  << _ids.size() << " ids, " << _distsSqr.size() << " distances\n";
+        throw new std::runtime_error("Invalid neighbour offsets");
+    }
+} //...Neighbours::Neighbours()
+
+Neighbours
+Neighbours::fromRows(
+    size_t              const  stride,
+    std::vector<size_t> const& counts,
+    std::vector<IdT>    const& ids,
+    std::vector<double> const& distsSqr,
+    unsigned            const  nThreads
+) {
+    size_t const nPoints = counts.size();
+    if (ids.size() != nPoints * stride || (!distsSqr.empty() && distsSqr.size() != ids.size())) {
+        std::cerr << "[Neighbours::fromRows] Expected " << nPoints << " x " << stride << " ids and distances, got "
+                  << ids.size() << " ids and " << distsSqr.size() << " distances\n";
+        throw new std::runtime_error("Neighbour row size mismatch");
+    }
+
+    // Prefix sum of the row lengths
+    Neighbours neighbours;
+    neighbours._offsets.resize(nPoints + 1);
+    for (size_t pointId = 0; pointId != nPoints; ++pointId)
+        neighbours._offsets[pointId + 1] = neighbours._offsets[pointId] + std::min(counts[pointId], stride);
+    neighbours._ids.resize(neighbours._offsets.back());
+    if (!distsSqr.empty())
+        neighbours._distsSqr.resize(neighbours._offsets.back());
+
+    // Rows land in disjoint ranges
+    parallelFor(nPoints, [&](size_t const pointId) {
+        size_t const from  = pointId * stride;
+        size_t const to    = neighbours._offsets[pointId];
+        size_t const count = neighbours._offsets[pointId + 1] - to;
+        std::copy(ids.begin() + from, ids.begin() + from + count, neighbours._ids.begin() + to);
+        if (!distsSqr.empty())
+            std::copy(distsSqr.begin() + from, distsSqr.begin() + from + count, neighbours._distsSqr.begin() + to);
+    }, 4096, nThreads);
+
+    return neighbours;
+} //...Neighbours::fromRows()
+
+Neighbours
+Neighbours::fromEdges(
+    std::vector<std::pair<IdT, IdT> > const& edges,
+    size_t                            const  nPoints,
+    unsigned                          const  nThreads
+) {
+    std::vector<uint64_t> keys(edges.size());
+    parallelFor(edges.size(), [&](size_t const edgeId) {
+        std::pair<IdT, IdT> const& edge = edges[edgeId];
+        if (edge.first < 0 || static_cast<size_t>(edge.first) >= nPoints
+            || edge.second < 0 || static_cast<size_t>(edge.second) >= nPoints) {
+            std::cerr << "[Neighbours::fromEdges] Edge " << edge.first << " -> " << edge.second
+                      << " outside of " << nPoints << " points\n";
+            throw new std::runtime_error("Edge out of range");
+        }
+        keys[edgeId] = edgeKey(edge.first, edge.second, nPoints);
+    }, 4096, nThreads);
+    return fromEdgeKeys(std::move(keys), nPoints, nThreads);
+} //...Neighbours::fromEdges()
+
+Neighbours
+Neighbours::fromEdgeKeys(
+    std::vector<uint64_t>        keys,
+    size_t                const  nPoints,
+    unsigned              const  nThreads
+) {
+    Neighbours neighbours;
+    neighbours._offsets.assign(nPoints + 1, 0);
+    if (keys.empty())
+        return neighbours;
+
+    uint64_t const maxKey = static_cast<uint64_t>(nPoints) * nPoints - 1;
+    if (!nPoints || *std::max_element(keys.begin(), keys.end()) > maxKey) {
+        std::cerr << "[Neighbours::fromEdgeKeys] Edge keys outside of " << nPoints << " points\n";
+        throw new std::runtime_error("Edge key out of range");
+    }
+
+    // Group by start, then end
+    parallelRadixSort(keys, maxKey, nullptr, nThreads);
+
+    // Keep the first of equal keys, drop self-loops: count per chunk, then each chunk writes its part
+    size_t const n       = keys.size();
+    size_t const nChunks = std::max<size_t>(1, std::min<size_t>(nThreads ? nThreads : defaultThreadCount(), n / 65536));
+    auto const chunkBegin = [&](size_t const chunkId) { return chunkId * n / nChunks; };
+    auto const keep = [&](size_t const i) {
+        return (!i || keys[i] != keys[i - 1]) && keys[i] / nPoints != keys[i] % nPoints;
+    };
+    std::vector<size_t> chunkStarts(nChunks + 1, 0);
+    parallelFor(nChunks, [&](size_t const chunkId) {
+        size_t count = 0;
+        for (size_t i = chunkBegin(chunkId); i != chunkBegin(chunkId + 1); ++i)
+            count += keep(i);
+        chunkStarts[chunkId + 1] = count;
+    }, 1, nThreads);
+    for (size_t chunkId = 0; chunkId != nChunks; ++chunkId)
+        chunkStarts[chunkId + 1] += chunkStarts[chunkId];
+
+    std::vector<uint64_t> unique(chunkStarts.back());
+    parallelFor(nChunks, [&](size_t const chunkId) {
+        size_t to = chunkStarts[chunkId];
+        for (size_t i = chunkBegin(chunkId); i != chunkBegin(chunkId + 1); ++i)
+            if (keep(i))
+                unique[to++] = keys[i];
+    }, 1, nThreads);
+    std::vector<uint64_t>().swap(keys);
+
+    // Row starts are the first keys of each start, the ends are the ids
+    parallelFor(nPoints, [&](size_t const pointId) {
+        neighbours._offsets[pointId] = static_cast<size_t>(
+            std::lower_bound(unique.begin(), unique.end(), static_cast<uint64_t>(pointId) * nPoints) - unique.begin());
+    }, 4096, nThreads);
+    neighbours._offsets[nPoints] = unique.size();
+    neighbours._ids.resize(unique.size());
+    parallelFor(unique.size(), [&](size_t const i) {
+        neighbours._ids[i] = static_cast<IdT>(unique[i] % nPoints);
+    }, 65536, nThreads);
+
+    return neighbours;
+} //...Neighbours::fromEdgeKeys()
+
+Neighbours
+Neighbours::symmetrized(size_t const nPoints, unsigned const nThreads) const {
+    size_t const nLists = std::max(nPoints, size());
+    std::vector<uint64_t> keys(2 * _ids.size());
+    parallelFor(size(), [&](size_t const pointId) {
+        for (size_t i = _offsets[pointId]; i != _offsets[pointId + 1]; ++i) {
+            keys[2 * i]     = edgeKey(static_cast<IdT>(pointId), _ids[i], nLists);
+            keys[2 * i + 1] = edgeKey(_ids[i], static_cast<IdT>(pointId), nLists);
+        }
+    }, 4096, nThreads);
+    return fromEdgeKeys(std::move(keys), nLists, nThreads);
+} //...Neighbours::symmetrized()
+
+} //...ns acq
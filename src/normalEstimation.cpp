@@ -5,35 +5,268 @@
 #include "acq/normalEstimation.h"
 
 #include "acq/impl/normalEstimation.hpp" // Templated functions
+#include "acq/quantizedCloud.h"
 
-#include "nanoflann/nanoflann.hpp"  // Nearest neighbour lookup in a pointcloud
+#include "acq/cloudIndex.h"
+#include "acq/impl/parallel.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
 #include <queue>
-#include <set>
 #include <iostream>
 
 namespace acq {
 
+namespace {
+    /** \brief Sorts the first \p count neighbour ids of a row, and their distances with them. */
+    void sortRow(Neighbours::IdT *ids, double *distsSqr, size_t const count) {
+        if (count > 32) {
+            // Long radius rows, sort pairs
+            std::vector<std::pair<Neighbours::IdT, double> > row(count);
+            for (size_t i = 0; i != count; ++i)
+                row[i] = std::make_pair(ids[i], distsSqr[i]);
+            std::sort(row.begin(), row.end());
+            for (size_t i = 0; i != count; ++i) {
+                ids[i]      = row[i].first;
+                distsSqr[i] = row[i].second;
+            }
+            return;
+        }
+
+        // Rows are short, insertion sort
+        for (size_t i = 1; i < count; ++i) {
+            Neighbours::IdT const id      = ids[i];
+            double          const distSqr = distsSqr[i];
+            size_t j = i;
+            for (; j > 0 && ids[j - 1] > id; --j) {
+                ids[j]      = ids[j - 1];
+                distsSqr[j] = distsSqr[j - 1];
+            }
+            ids[j]      = id;
+            distsSqr[j] = distSqr;
+        }
+    } //...sortRow()
+
+    //! Points a thread takes at a time, amortizes the scratch buffers and keeps the writes apart.
+    size_t const NEIGHBOUR_BLOCK = 1024;
+
+    /** \brief Collects the neighbours \p query finds for every point, closer than \p maxDist.
+     *
+     * Rows of a flat N x k buffer are filled in parallel, each block of points by one thread,
+     * then packed, see \ref Neighbours::fromRows().
+     *
+     * \tparam _QueryT Concept: void(size_t pointId, std::vector<size_t> &ids, std::vector<double> &distsSqr),
+     *                 safe to call concurrently.
+     *
+     * \param[in] nRows    Number of points to query.
+     * \param[in] pointIds Point of each row, nullptr for row i querying point i.
+     */
+    template <typename _QueryT>
+    NeighboursT gatherNeighbours(
+        size_t                              const  nRows,
+        std::vector<Neighbours::IdT> const* const  pointIds,
+        int                                 const  k,
+        float                               const  maxDist,
+        unsigned                            const  nThreads,
+        _QueryT                             const& query
+    ) {
+        // Squared max distance
+        double const maxDistSqr = static_cast<double>(maxDist) * maxDist;
+        // One row of k slots per point, the point itself is dropped
+        size_t const stride = static_cast<size_t>(std::max(k, 0));
+
+        std::vector<size_t>          counts(nRows, 0);
+        std::vector<Neighbours::IdT> ids(nRows * stride);
+        std::vector<double>          dists(nRows * stride);
+
+        size_t const nBlocks = (nRows + NEIGHBOUR_BLOCK - 1) / NEIGHBOUR_BLOCK;
+        parallelFor(nBlocks, [&](size_t const blockId) {
+            // Neighbour indices, reused for the block
+            std::vector<size_t> neighbourIndices;
+            std::vector<double> distsSqr;
+
+            size_t const end = std::min(nRows, (blockId + 1) * NEIGHBOUR_BLOCK);
+            for (size_t rowId = blockId * NEIGHBOUR_BLOCK; rowId != end; ++rowId) {
+                size_t const pointId = pointIds ? static_cast<size_t>((*pointIds)[rowId]) : rowId;
+                query(pointId, neighbourIndices, distsSqr);
+
+                // Filter neighbours by squared distance straight into the row of the point
+                size_t const row   = rowId * stride;
+                size_t       count = 0;
+                for (size_t i = 0; i != neighbourIndices.size(); ++i) {
+                    // if not same point and close enough
+                    if ((neighbourIndices[i] != pointId   ) &&
+                        (distsSqr        [i] <  maxDistSqr)) {
+                        ids  [row + count] = static_cast<Neighbours::IdT>(neighbourIndices[i]);
+                        dists[row + count] = distsSqr[i];
+                        ++count;
+                    }
+                }
+                sortRow(ids.data() + row, dists.data() + row, count);
+                counts[rowId] = count;
+            } //...for points of block
+        }, 1, nThreads);
+
+        return Neighbours::fromRows(stride, counts, ids, dists, nThreads);
+    } //...gatherNeighbours()
+
+    /** \brief Collects the neighbours \p query finds for every point, any number per point.
+     *
+     * Like \ref gatherNeighbours(), but each block of points keeps its rows in its own buffers,
+     * which are concatenated afterwards, so there is no N x k buffer to bound the row lengths.
+     *
+     * \tparam _QueryT Concept: void(size_t pointId, std::vector<size_t> &ids, std::vector<double> &distsSqr),
+     *                 safe to call concurrently, distances filtered already.
+     */
+    template <typename _QueryT>
+    NeighboursT gatherVaryingNeighbours(
+        size_t   const  nRows,
+        unsigned const  nThreads,
+        _QueryT  const& query
+    ) {
+        std::vector<size_t>                        counts(nRows, 0);
+        size_t                               const nBlocks = (nRows + NEIGHBOUR_BLOCK - 1) / NEIGHBOUR_BLOCK;
+        std::vector<std::vector<Neighbours::IdT> > blockIds(nBlocks);
+        std::vector<std::vector<double> >          blockDists(nBlocks);
+        parallelFor(nBlocks, [&](size_t const blockId) {
+            // Neighbour indices, reused for the block
+            std::vector<size_t> neighbourIndices;
+            std::vector<double> distsSqr;
+            std::vector<Neighbours::IdT> &ids   = blockIds[blockId];
+            std::vector<double>          &dists = blockDists[blockId];
+
+            size_t const end = std::min(nRows, (blockId + 1) * NEIGHBOUR_BLOCK);
+            for (size_t pointId = blockId * NEIGHBOUR_BLOCK; pointId != end; ++pointId) {
+                query(pointId, neighbourIndices, distsSqr);
+
+                // Append all but the point itself
+                size_t const row = ids.size();
+                for (size_t i = 0; i != neighbourIndices.size(); ++i) {
+                    if (neighbourIndices[i] != pointId) {
+                        ids.push_back(static_cast<Neighbours::IdT>(neighbourIndices[i]));
+                        dists.push_back(distsSqr[i]);
+                    }
+                }
+                sortRow(ids.data() + row, dists.data() + row, ids.size() - row);
+                counts[pointId] = ids.size() - row;
+            } //...for points of block
+        }, 1, nThreads);
+
+        // Blocks are consecutive rows, each lands in one piece
+        std::vector<size_t> offsets(nRows + 1, 0);
+        for (size_t rowId = 0; rowId != nRows; ++rowId)
+            offsets[rowId + 1] = offsets[rowId] + counts[rowId];
+        std::vector<Neighbours::IdT> ids(offsets.back());
+        std::vector<double>          dists(offsets.back());
+        parallelFor(nBlocks, [&](size_t const blockId) {
+            size_t const to = offsets[blockId * NEIGHBOUR_BLOCK];
+            std::copy(blockIds[blockId].begin(), blockIds[blockId].end(), ids.begin() + to);
+            std::copy(blockDists[blockId].begin(), blockDists[blockId].end(), dists.begin() + to);
+        }, 1, nThreads);
+
+        return Neighbours(std::move(offsets), std::move(ids), std::move(dists));
+    } //...gatherVaryingNeighbours()
+
+    //! Points per block of the normal kernel, the covariances of a block stay in L1.
+    size_t const NORMAL_BLOCK = 256;
+
+    /** \brief Normals from neighbourhood covariances, see \ref calculateCloudNormals().
+     *
+     * Blocks of points are handed to the threads. Per block, the six distinct covariance
+     * entries are accumulated into separate arrays, then each 3 x 3 system is solved in
+     * closed form, avoiding the iterations of the general symmetric solver.
+     *
+     * \tparam _CloudT Concept: acq::CloudT, or an acq::QuantizedCloud.
+     *
+     * \param[in ] pointIds   Point of each neighbour row, nullptr for row i describing point i.
+     * \param[out] normals    Receives the rows of the points, has to be N x 3.
+     * \param[out] curvatures Optionally receives the entries of the points, has to have N entries.
+     */
+    template <typename _CloudT>
+    void estimateNormals(
+        _CloudT                      const& cloud,
+        NeighboursT                  const& neighbours,
+        std::vector<Neighbours::IdT> const* pointIds,
+        NormalsT                          & normals,
+        Eigen::VectorXd                   * curvatures,
+        unsigned                     const  nThreads
+    ) {
+        size_t const nRows = neighbours.size();
+        size_t const nBlocks = (nRows + NORMAL_BLOCK - 1) / NORMAL_BLOCK;
+        parallelFor(nBlocks, [&](size_t const blockId) {
+            // Covariance entries xx, xy, xz, yy, yz, zz of the points of the block
+            double cov[6][NORMAL_BLOCK];
+
+            size_t const first = blockId * NORMAL_BLOCK;
+            size_t const count = std::min(NORMAL_BLOCK, nRows - first);
+            for (size_t i = 0; i != count; ++i) {
+                size_t const pointId = pointIds ? static_cast<size_t>((*pointIds)[first + i]) : first + i;
+                Eigen::Vector3d const point = cloud.row(pointId).transpose();
+                double xx = 0., xy = 0., xz = 0., yy = 0., yz = 0., zz = 0.;
+                // Same covariance as calculatePointNormal(): vectors to the neighbours
+                for (Neighbours::IdT const neighbourId : neighbours[first + i]) {
+                    Eigen::Vector3d const d = cloud.row(neighbourId).transpose() - point;
+                    xx += d(0) * d(0); xy += d(0) * d(1); xz += d(0) * d(2);
+                    yy += d(1) * d(1); yz += d(1) * d(2); zz += d(2) * d(2);
+                }
+                cov[0][i] = xx; cov[1][i] = xy; cov[2][i] = xz;
+                cov[3][i] = yy; cov[4][i] = yz; cov[5][i] = zz;
+            } //...for points of block
+
+            Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> es;
+            for (size_t i = 0; i != count; ++i) {
+                Eigen::Matrix3d matrix;
+                matrix << cov[0][i], cov[1][i], cov[2][i],
+                          cov[1][i], cov[3][i], cov[4][i],
+                          cov[2][i], cov[4][i], cov[5][i];
+                // Analytic 3 x 3 solution, eigenvalues in increasing order
+                es.computeDirect(matrix);
+                size_t const pointId = pointIds ? static_cast<size_t>((*pointIds)[first + i]) : first + i;
+                normals.row(pointId) = es.eigenvectors().col(0).normalized().transpose();
+                if (curvatures) {
+                    // Surface variation: share of the smallest eigenvalue
+                    double const sum = es.eigenvalues().sum();
+                    (*curvatures)(pointId) = sum > 0. ? std::max(es.eigenvalues()(0), 0.) / sum : 0.;
+                }
+            } //...for points of block
+        }, 1, nThreads);
+    } //...estimateNormals()
+
+    /** \brief Normals of all points of \p cloud, see \ref calculateCloudNormals(). */
+    template <typename _CloudT>
+    NormalsT estimateCloudNormals(
+        _CloudT         const& cloud,
+        NeighboursT     const& neighbours,
+        Eigen::VectorXd      * curvatures,
+        unsigned        const  nThreads
+    ) {
+        if (neighbours.size() != static_cast<size_t>(cloud.rows())) {
+            std::cerr << "[calculateCloudNormals] Expected neighbours of " << cloud.rows()
+                      << " points, got " << neighbours.size() << "\n";
+            throw new std::runtime_error("Neighbour count mismatch");
+        }
+
+        // Output normals: N x 3
+        NormalsT normals(cloud.rows(), 3);
+        if (curvatures)
+            curvatures->resize(cloud.rows());
+        estimateNormals(cloud, neighbours, nullptr, normals, curvatures, nThreads);
+        return normals;
+    } //...estimateCloudNormals()
+} //...ns anonymous
+
 NeighboursT
 calculateCloudNeighbours(
-    CloudT  const& cloud,
-    int     const  k,
-    float   const  maxDist,
-    int     const  maxLeafs
+    CloudT   const& cloud,
+    int      const  k,
+    float    const  maxDist,
+    int      const  maxLeafs,
+    unsigned const  nThreads
 ) {
-    // Floating point type
-    typedef typename CloudT::Scalar Scalar;
     // Point dimensions
     enum { Dim = 3 };
-    // Copy-free Eigen->FLANN wrapper
-    typedef nanoflann::KDTreeEigenMatrixAdaptor <
-        /*    Eigen matrix type: */ CloudT,
-        /* Space dimensionality: */ Dim,
-        /*      Distance metric: */ nanoflann::metric_L2
-    > KdTreeWrapperT;
-
-    // Squared max distance
-    float const maxDistSqr = maxDist * maxDist;
 
     // Safety check dimensionality
     if (cloud.cols() != Dim) {
@@ -44,160 +277,417 @@ calculateCloudNeighbours(
     } //...check dimensionality
 
     // Build KdTree
-    KdTreeWrapperT cloudIndex(Dim, cloud, maxLeafs);
-    cloudIndex.index->buildIndex();
-
-    // Neighbour indices
-    std::vector<size_t> neighbourIndices(k);
-    std::vector<Scalar> distsSqr(k);
-
-    // Placeholder structure for nanoFLANN
-    nanoflann::KNNResultSet <Scalar> resultSet(k);
-
-    // Associative list of neighbours: { pointId => [neighbourId_0, nId_1, ... nId_k-1] }
-    NeighboursT neighbours;
-    // For each point, store normal
-    for (int pointId = 0; pointId != cloud.rows(); ++pointId) {
-        // Initialize nearest neighhbour estimation
-        resultSet.init(&neighbourIndices[0], &distsSqr[0]);
-
-        // Make sure it's ok to expose raw data pointer of point
-        static_assert(
-            std::is_same<Scalar, double>::value,
-            "Double input assumed next. Otherwise, explicit copy is needed!"
-        );
-
-        // Find neighbours of point in "pointId"-th row
-        cloudIndex.index->findNeighbors(
-            /*                Output wrapper: */ resultSet,
-            /* Query point double[3] pointer: */ cloud.row(pointId).data(),
-            /*    How many neighbours to use: */ nanoflann::SearchParams(k)
-        );
-
-        // Filter neighbours by squared distance
-        NeighboursT::mapped_type currNeighbours;
-        for (int i = 0; i != neighbourIndices.size(); ++i) {
-            // if not same point and close enough
-            if ((neighbourIndices[i] != pointId   ) &&
-                (distsSqr        [i] <  maxDistSqr))
-                currNeighbours.insert(neighbourIndices[i]);
-        }
+    CloudIndex const cloudIndex(cloud, maxLeafs);
 
-        // Store list of neighbours
-        std::pair<NeighboursT::iterator, bool> const success =
-            neighbours.insert(
-                std::make_pair(
-                    pointId,
-                    currNeighbours
-                )
-            );
+    return gatherNeighbours(
+        static_cast<size_t>(cloud.rows()), nullptr, k, maxDist, nThreads,
+        [&](size_t const pointId, std::vector<size_t> &neighbourIndices, std::vector<double> &distsSqr) {
+            cloudIndex.findNeighbours(cloud.row(pointId).transpose(), k, neighbourIndices, distsSqr);
+        });
+} //...calculateCloudNeighbours()
 
-        if (!success.second)
-            std::cerr << "Could not store neighbours of point " << pointId
-                      << ", already inserted?\n";
+NeighboursT
+calculateCloudNeighboursInRadius(
+    CloudT               const& cloud,
+    float                const  radius,
+    int                  const  maxNeighbours,
+    int                  const  maxLeafs,
+    unsigned             const  nThreads
+) {
+    // Build KdTree
+    CloudIndex const cloudIndex(cloud, maxLeafs);
 
-    } //...for all points
+    // One more, the point finds itself
+    size_t const maxCount = maxNeighbours > 0 ? static_cast<size_t>(maxNeighbours) + 1 : 0;
+    return gatherVaryingNeighbours(
+        static_cast<size_t>(cloud.rows()), nThreads,
+        [&](size_t const pointId, std::vector<size_t> &neighbourIndices, std::vector<double> &distsSqr) {
+            cloudIndex.findInRadius(cloudIndex.getPoint(pointId), radius, maxCount, neighbourIndices, distsSqr);
+        });
+} //...calculateCloudNeighboursInRadius()
 
-    // return estimated normals
-    return neighbours;
-} //...calculateCloudNormals()
+NeighboursT
+calculateCloudNeighboursInRadius(
+    CloudT               const& cloud,
+    Eigen::VectorXd      const& radii,
+    int                  const  maxNeighbours,
+    int                  const  maxLeafs,
+    unsigned             const  nThreads
+) {
+    if (radii.size() != cloud.rows()) {
+        std::cerr << "[calculateCloudNeighboursInRadius] Expected " << cloud.rows() << " radii, got "
+                  << radii.size() << "\n";
+        throw new std::runtime_error("Radius count mismatch");
+    }
+
+    // Build KdTree
+    CloudIndex const cloudIndex(cloud, maxLeafs);
+
+    // One more, the point finds itself
+    size_t const maxCount = maxNeighbours > 0 ? static_cast<size_t>(maxNeighbours) + 1 : 0;
+    return gatherVaryingNeighbours(
+        static_cast<size_t>(cloud.rows()), nThreads,
+        [&](size_t const pointId, std::vector<size_t> &neighbourIndices, std::vector<double> &distsSqr) {
+            cloudIndex.findInRadius(
+                cloudIndex.getPoint(pointId), radii(pointId), maxCount, neighbourIndices, distsSqr);
+        });
+} //...calculateCloudNeighboursInRadius()
+
+Eigen::VectorXd
+calculatePointSpacing(
+    CloudT               const& cloud,
+    int                  const  k,
+    int                  const  maxLeafs,
+    unsigned             const  nThreads
+) {
+    // Build KdTree
+    CloudIndex const cloudIndex(cloud, maxLeafs);
+
+    Eigen::VectorXd spacing(cloud.rows());
+    size_t const nPoints = static_cast<size_t>(cloud.rows());
+    size_t const nBlocks = (nPoints + NEIGHBOUR_BLOCK - 1) / NEIGHBOUR_BLOCK;
+    parallelFor(nBlocks, [&](size_t const blockId) {
+        // Neighbour indices, reused for the block
+        std::vector<size_t> neighbourIndices;
+        std::vector<double> distsSqr;
+
+        size_t const end = std::min(nPoints, (blockId + 1) * NEIGHBOUR_BLOCK);
+        for (size_t pointId = blockId * NEIGHBOUR_BLOCK; pointId != end; ++pointId) {
+            // The point itself comes first at distance 0
+            cloudIndex.findNeighbours(
+                cloudIndex.getPoint(pointId), static_cast<size_t>(std::max(k, 1)) + 1, neighbourIndices, distsSqr);
+            double sum   = 0.;
+            int    count = 0;
+            for (size_t i = 0; i != neighbourIndices.size(); ++i) {
+                if (neighbourIndices[i] != pointId) {
+                    sum += std::sqrt(distsSqr[i]);
+                    ++count;
+                }
+            }
+            spacing(pointId) = count ? sum / count : 0.;
+        } //...for points of block
+    }, 1, nThreads);
+
+    return spacing;
+} //...calculatePointSpacing()
 
 NormalsT
 calculateCloudNormals(
-    CloudT      const& cloud,
-    NeighboursT const& neighbours
+    CloudT          const& cloud,
+    NeighboursT     const& neighbours,
+    Eigen::VectorXd      * curvatures,
+    unsigned        const  nThreads
 ) {
-    // Output normals: N x 3
-    CloudT normals(cloud.rows(), 3);
-
-    // For each point, store normal
-    for (int pointId = 0; pointId != cloud.rows(); ++pointId) {
-        // Estimate vertex normal from neighbourhood indices and cloud
-        normals.row(pointId) =
-            calculatePointNormal(
-                /*        PointCloud: */ cloud,
-                /*      ID of vertex: */ pointId,
-                /* Ids of neighbours: */ neighbours.at(pointId)
-            );
-    } //...for all points
+    return estimateCloudNormals(cloud, neighbours, curvatures, nThreads);
+} //...calculateCloudNormals()
 
-    // Return estimated normals
-    return normals;
+NeighboursT
+calculateCloudNeighbours(
+    CloudIndex                   const& cloudIndex,
+    std::vector<Neighbours::IdT> const& pointIds,
+    int                          const  k,
+    float                        const  maxDist,
+    unsigned                     const  nThreads
+) {
+    return gatherNeighbours(
+        pointIds.size(), &pointIds, k, maxDist, nThreads,
+        [&](size_t const pointId, std::vector<size_t> &neighbourIndices, std::vector<double> &distsSqr) {
+            cloudIndex.findNeighbours(cloudIndex.getPoint(pointId), k, neighbourIndices, distsSqr);
+        });
+} //...calculateCloudNeighbours()
+
+void
+updateCloudNormals(
+    CloudT                       const& cloud,
+    std::vector<Neighbours::IdT> const& pointIds,
+    NeighboursT                  const& neighbours,
+    NormalsT                          & normals,
+    Eigen::VectorXd                   * curvatures,
+    unsigned                     const  nThreads
+) {
+    if (neighbours.size() != pointIds.size() || normals.rows() != cloud.rows() || normals.cols() != 3
+        || (curvatures && curvatures->size() != cloud.rows())) {
+        std::cerr << "[updateCloudNormals] Expected neighbours of " << pointIds.size() << " points and "
+                  << cloud.rows() << " normals and curvatures, got " << neighbours.size() << ", "
+                  << normals.rows() << " and " << (curvatures ? curvatures->size() : 0) << "\n";
+        throw new std::runtime_error("Normal update size mismatch");
+    }
+    estimateNormals(cloud, neighbours, &pointIds, normals, curvatures, nThreads);
+} //...updateCloudNormals()
+
+NeighboursT
+calculateCloudNeighbours(
+    QuantizedCloud const& cloud,
+    int            const  k,
+    float          const  maxDist,
+    int            const  maxLeafs,
+    unsigned       const  nThreads
+) {
+    // Build KdTree over the encoded points
+    QuantizedIndex const cloudIndex(cloud, maxLeafs);
+
+    return gatherNeighbours(
+        static_cast<size_t>(cloud.rows()), nullptr, k, maxDist, nThreads,
+        [&](size_t const pointId, std::vector<size_t> &neighbourIndices, std::vector<double> &distsSqr) {
+            cloudIndex.findNeighbours(cloud.getPoint(pointId), k, neighbourIndices, distsSqr);
+        });
+} //...calculateCloudNeighbours()
+
+NormalsT
+calculateCloudNormals(
+    QuantizedCloud  const& cloud,
+    NeighboursT     const& neighbours,
+    Eigen::VectorXd      * curvatures,
+    unsigned        const  nThreads
+) {
+    // Neighbours are decoded on the fly
+    return estimateCloudNormals(cloud, neighbours, curvatures, nThreads);
 } //...calculateCloudNormals()
 
 int
 orientCloudNormals(
-    NeighboursT const& neighbours,
-    NormalsT         & normals
+    NeighboursT     const& neighbours,
+    NormalsT             & normals,
+    Eigen::VectorXd const* curvatures,
+    unsigned        const  nThreads
 ) {
     if (!normals.size()) {
         std::cerr << "[orientCloudNormals] No normals to work on...\n";
         return -1;
     }
+    size_t const nPoints = static_cast<size_t>(normals.rows());
+    if (curvatures && static_cast<size_t>(curvatures->size()) != nPoints) {
+        std::cerr << "[orientCloudNormals] Expected " << nPoints << " curvatures, got " << curvatures->size() << "\n";
+        throw new std::runtime_error("Curvature count mismatch");
+    }
 
-    // List of points to visit
-    std::queue<int> queue;
-    // Quick-lookup unique container of already visited points
-    std::set<int> visited;
-
-    // Count changes
-    int nFlips = 0;
-
-    while (visited.size() != normals.size()) {
-        // Traverse a connected component
-        if (queue.empty()) {
-            if (!visited.size()) {
-                // Initialize queue with one random point
-                queue.push(rand() % normals.size()); // TODO: pick point with low curvature
-            } else {
-                // Expand queue with first unvisited point
-                for (int i = 0; i != normals.size() && queue.empty(); ++i) {
-                    // if unvisited, use
-                    if (visited.find(i) == visited.end())
-                        queue.push(i); // enqueue
-                } //...for each point
-            } //...next component
-
-            // Set visited
-            visited.insert(queue.front());
-        } //...if queue empty
-
-        // While points to visit exist
-        while (!queue.empty()) {
-            // Read next point from queue
-            int const pointId = queue.front();
-            // Remove point from queue
-            queue.pop();
-
-            // Fetch neighbours
-            NeighboursT::const_iterator const iter = neighbours.find(pointId);
-            // Check, if any neighbours
-            if (iter == neighbours.end()) {
-                //std::cerr << "Could not find neighbours of point " << pointId << "\n";
-                continue;
+    // Orientation has to spread both ways along kNN relations
+    NeighboursT const graph = neighbours.symmetrized(nPoints, nThreads);
+
+    // Label connected components breadth-first, component ids in order of their first point
+    std::vector<int> componentIds(nPoints, -1);
+    std::vector<Neighbours::IdT> queue;
+    queue.reserve(nPoints);
+    int nComponents = 0;
+    for (size_t startId = 0; startId != nPoints; ++startId) {
+        if (componentIds[startId] >= 0)
+            continue;
+        componentIds[startId] = nComponents;
+        queue.assign(1, static_cast<Neighbours::IdT>(startId));
+        for (size_t head = 0; head != queue.size(); ++head) {
+            for (Neighbours::IdT const neighbourId : graph[queue[head]]) {
+                if (componentIds[neighbourId] < 0) {
+                    componentIds[neighbourId] = nComponents;
+                    queue.push_back(neighbourId);
+                }
             }
-
-            for (int const neighbourId : iter->second) {
-                // If unvisited
-                if (visited.find(neighbourId) == visited.end()) {
-                    // Enqueue for next level
-                    queue.push(neighbourId);
-                    // Mark visited
-                    visited.insert(neighbourId);
-
-                    // Flip neighbour normal, if not same direction as precursor point
-                    if (normals.row(pointId).dot(normals.row(neighbourId)) < 0.f) {
-                        normals.row(neighbourId) *= -1.f;
-                        ++nFlips;
-                    }
-                } //...if neighbour unvisited
-            } //...for each neighbour of point
         } //...while points in queue
+        ++nComponents;
+    } //...for all points
+
+    // Points of each component, counting sort by component id
+    std::vector<size_t> componentStarts(nComponents + 1, 0);
+    for (int const componentId : componentIds)
+        ++componentStarts[componentId + 1];
+    for (int componentId = 0; componentId != nComponents; ++componentId)
+        componentStarts[componentId + 1] += componentStarts[componentId];
+    std::vector<Neighbours::IdT> members(nPoints);
+    {
+        std::vector<size_t> next(componentStarts.begin(), componentStarts.end() - 1);
+        for (size_t pointId = 0; pointId != nPoints; ++pointId)
+            members[next[componentIds[pointId]]++] = static_cast<Neighbours::IdT>(pointId);
     }
 
+    // Largest components first, so they do not end up last on one thread
+    std::vector<int> order;
+    for (int componentId = 0; componentId != nComponents; ++componentId)
+        if (componentStarts[componentId + 1] - componentStarts[componentId] > 1)
+            order.push_back(componentId);
+    std::sort(order.begin(), order.end(), [&componentStarts](int const a, int const b) {
+        return componentStarts[a + 1] - componentStarts[a] > componentStarts[b + 1] - componentStarts[b];
+    });
+
+    //! Unoriented angle cost of an edge, small between parallel normals.
+    auto const edgeCost = [&normals](Neighbours::IdT const a, Neighbours::IdT const b) {
+        return 1. - std::abs(normals.row(a).dot(normals.row(b)));
+    };
+
+    // Components are disjoint, so are the visited flags and normals they touch
+    std::vector<unsigned char> visited(nPoints, 0);
+    std::atomic<int>           nFlips(0);
+    parallelFor(order.size(), [&](size_t const orderId) {
+        int const componentId = order[orderId];
+        Neighbours::IdT const* const first = members.data() + componentStarts[componentId];
+        Neighbours::IdT const* const last  = members.data() + componentStarts[componentId + 1];
+
+        // Seed at the flattest point: lowest curvature, or least normal variation around it
+        Neighbours::IdT seedId   = *first;
+        double          seedCost = std::numeric_limits<double>::max();
+        for (Neighbours::IdT const* pointId = first; pointId != last; ++pointId) {
+            double cost = 0.;
+            if (curvatures)
+                cost = (*curvatures)(*pointId);
+            else {
+                for (Neighbours::IdT const neighbourId : graph[*pointId])
+                    cost += edgeCost(*pointId, neighbourId);
+                cost /= graph.count(*pointId);
+            }
+            if (cost < seedCost) {
+                seedCost = cost;
+                seedId   = *pointId;
+            }
+        } //...for points of component
+
+        // Prim's minimum spanning tree over the angle costs (Hoppe et al. 1992),
+        // each point oriented by the tree neighbour it is reached from
+        typedef std::pair<double, std::pair<Neighbours::IdT, Neighbours::IdT> > EdgeT; // cost, (point, parent)
+        std::priority_queue<EdgeT, std::vector<EdgeT>, std::greater<EdgeT> > front;
+        front.push(EdgeT(0., std::make_pair(seedId, seedId)));
+        int nComponentFlips = 0;
+        while (!front.empty()) {
+            Neighbours::IdT const pointId  = front.top().second.first;
+            Neighbours::IdT const parentId = front.top().second.second;
+            front.pop();
+            if (visited[pointId])
+                continue;
+            visited[pointId] = 1;
+
+            // Flip normal, if not same direction as tree parent
+            if (normals.row(parentId).dot(normals.row(pointId)) < 0.) {
+                normals.row(pointId) *= -1.;
+                ++nComponentFlips;
+            }
+
+            for (Neighbours::IdT const neighbourId : graph[pointId])
+                if (!visited[neighbourId])
+                    front.push(EdgeT(edgeCost(pointId, neighbourId), std::make_pair(neighbourId, pointId)));
+        } //...while front
+
+        nFlips += nComponentFlips;
+    }, 1, nThreads);
+
     return nFlips;
 } //...orientCloudNormals()
 
+NormalsT
+calculateCloudNormalsFromFaces(
+    CloudT        const& cloud,
+    FacesT        const& faces,
+    FaceWeighting const  weighting,
+    bool               * consistent,
+    unsigned      const  nThreads
+) {
+    size_t const nPoints  = static_cast<size_t>(cloud.rows());
+    size_t const nFaces   = static_cast<size_t>(faces.rows());
+    int    const nCorners = static_cast<int>(faces.cols());
+    if (nFaces && nCorners < 3) {
+        std::cerr << "[calculateCloudNormalsFromFaces] Faces need 3 vertices at least, got " << nCorners << "\n";
+        throw new std::runtime_error("Not enough face vertices");
+    }
+    if (static_cast<size_t>(faces.size()) > std::numeric_limits<unsigned>::max()) {
+        std::cerr << "[calculateCloudNormalsFromFaces] Too many face corners: " << faces.size() << "\n";
+        throw new std::runtime_error("Too many face corners");
+    }
+    // Every pass below reads vertices by face index unchecked
+    if (nFaces) {
+        Eigen::Index minFace, maxFace, corner;
+        int const minId = faces.minCoeff(&minFace, &corner);
+        int const maxId = faces.maxCoeff(&maxFace, &corner);
+        if (minId < 0 || static_cast<size_t>(maxId) >= nPoints) {
+            std::cerr << "[calculateCloudNormalsFromFaces] Face " << (minId < 0 ? minFace : maxFace)
+                      << " refers to vertex " << (minId < 0 ? minId : maxId) << " of " << nPoints << "\n";
+            throw new std::runtime_error("Face vertex out of range");
+        }
+    }
+
+    // Face normals scaled by twice the area (Newell), and for angle weighting the corner angles over that
+    std::vector<Eigen::Vector3d> faceNormals(nFaces);
+    std::vector<double>          cornerWeights(weighting == FACE_WEIGHT_ANGLE ? nFaces * nCorners : 0);
+    parallelFor(nFaces, [&](size_t const faceId) {
+        Eigen::Vector3d normal(Eigen::Vector3d::Zero());
+        for (int corner = 0; corner != nCorners; ++corner) {
+            Eigen::Vector3d const from = cloud.row(faces(faceId, corner)).transpose();
+            Eigen::Vector3d const to   = cloud.row(faces(faceId, (corner + 1) % nCorners)).transpose();
+            normal += from.cross(to);
+        }
+        faceNormals[faceId] = normal;
+        if (cornerWeights.empty())
+            return;
+
+        double const length = normal.norm();
+        for (int corner = 0; corner != nCorners; ++corner) {
+            Eigen::Vector3d const at   = cloud.row(faces(faceId, corner)).transpose();
+            Eigen::Vector3d const prev = cloud.row(faces(faceId, (corner + nCorners - 1) % nCorners)).transpose() - at;
+            Eigen::Vector3d const next = cloud.row(faces(faceId, (corner + 1) % nCorners)).transpose() - at;
+            double const angle = std::atan2(prev.cross(next).norm(), prev.dot(next));
+            cornerWeights[faceId * nCorners + corner] = length > 0. ? angle / length : 0.;
+        }
+    }, 4096, nThreads);
+
+    // Face corners sorted by vertex (counting sort), each vertex's in face order
+    std::vector<size_t> offsets(nPoints + 1, 0);
+    for (int corner = 0; corner != nCorners; ++corner) {
+        for (size_t faceId = 0; faceId != nFaces; ++faceId)
+            ++offsets[faces(faceId, corner) + 1];
+    }
+    for (size_t pointId = 1; pointId <= nPoints; ++pointId)
+        offsets[pointId] += offsets[pointId - 1];
+    std::vector<unsigned> incidence(offsets.back());
+    {
+        std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+        for (size_t faceId = 0; faceId != nFaces; ++faceId)
+            for (int corner = 0; corner != nCorners; ++corner)
+                incidence[next[faces(faceId, corner)]++] = static_cast<unsigned>(faceId * nCorners + corner);
+    }
+
+    // Gather: every vertex sums its own faces, rows written once
+    NormalsT normals(nPoints, 3);
+    std::atomic<bool> wound(true);
+    size_t const nBlocks = (nPoints + NEIGHBOUR_BLOCK - 1) / NEIGHBOUR_BLOCK;
+    parallelFor(nBlocks, [&](size_t const blockId) {
+        // Edge ends leaving and entering the vertex, reused for the block
+        std::vector<int> outgoing, incoming;
+
+        size_t const end = std::min(nPoints, (blockId + 1) * NEIGHBOUR_BLOCK);
+        for (size_t pointId = blockId * NEIGHBOUR_BLOCK; pointId != end; ++pointId) {
+            // Consistently wound faces traverse each edge at the vertex once per direction
+            outgoing.clear();
+            incoming.clear();
+            for (size_t i = offsets[pointId]; i != offsets[pointId + 1]; ++i) {
+                size_t const faceId = incidence[i] / nCorners;
+                int    const corner = static_cast<int>(incidence[i] % nCorners);
+                outgoing.push_back(faces(faceId, (corner + 1) % nCorners));
+                incoming.push_back(faces(faceId, (corner + nCorners - 1) % nCorners));
+            }
+            std::sort(outgoing.begin(), outgoing.end());
+            std::sort(incoming.begin(), incoming.end());
+            bool const local =
+                std::adjacent_find(outgoing.begin(), outgoing.end()) == outgoing.end() &&
+                std::adjacent_find(incoming.begin(), incoming.end()) == incoming.end();
+            if (!local)
+                wound.store(false, std::memory_order_relaxed);
+
+            Eigen::Vector3d sum(Eigen::Vector3d::Zero());
+            for (size_t i = offsets[pointId]; i != offsets[pointId + 1]; ++i) {
+                Eigen::Vector3d contribution = faceNormals[incidence[i] / nCorners];
+                if (!cornerWeights.empty())
+                    contribution *= cornerWeights[incidence[i]];
+                // Flipped faces would cancel out, sum them up to sign
+                if (!local && sum.dot(contribution) < 0.)
+                    contribution = -contribution;
+                sum += contribution;
+            }
+            // Stays zero without faces
+            double const length = sum.norm();
+            normals.row(pointId) = sum.transpose() / (length > 0. ? length : 1.);
+        } //...for points of block
+    }, 1, nThreads);
+
+    if (consistent)
+        *consistent = wound.load();
+    return normals;
+} //...calculateCloudNormalsFromFaces()
+
 } //...ns acq
 
 
@@ -209,13 +699,15 @@ namespace acq {
 
 template int
 orientCloudNormalsFromFaces(
-    FacesT  const& faces,
-    NormalsT     & normals
+    FacesT   const& faces,
+    NormalsT      & normals,
+    unsigned const  nThreads
 );
 
 template NeighboursT
 calculateCloudNeighboursFromFaces(
-    FacesT const& faces
+    FacesT   const& faces,
+    unsigned const  nThreads
 );
 
 } //...ns acq
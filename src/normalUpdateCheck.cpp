@@ -0,0 +1,141 @@
+#include "acq/decoratedCloud.h"
+#include "acq/meshIO.h"
+#include "acq/normalEstimation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** \brief Flags the points of \p cloud whose k-th neighbour is as far as the next one.
+ *
+ * Which of those is in the neighbourhood depends on the shape of the tree, so the normals of
+ * such points are not comparable between estimates, e.g. on the grid of a range scan.
+ */
+void
+flagTies(
+    acq::CloudT                const& cloud,
+    int                        const  k,
+    std::vector<unsigned char>      & ties
+) {
+    acq::NeighboursT const neighbours = acq::calculateCloudNeighbours(cloud, k + 1);
+    for (size_t pointId = 0; pointId != neighbours.size(); ++pointId) {
+        std::vector<double> distsSqr(
+            neighbours.getDistancesSqr(pointId), neighbours.getDistancesSqr(pointId) + neighbours.count(pointId));
+        std::sort(distsSqr.begin(), distsSqr.end());
+        size_t const n = distsSqr.size();
+        if (n >= static_cast<size_t>(k) && distsSqr[n - 1] == distsSqr[n - 2])
+            ties[pointId] = 1;
+    }
+} //...flagTies()
+
+/** \brief Number of points not in \p ties whose normals are further apart than \p maxCos,
+ *         or whose curvatures differ, if \p updated has them.
+ */
+size_t
+countMismatches(
+    acq::DecoratedCloud        const& updated,
+    acq::DecoratedCloud        const& reference,
+    std::vector<unsigned char> const& ties,
+    double                     const  maxCos
+) {
+    size_t count = 0;
+    for (Eigen::Index pointId = 0; pointId != reference.getNormals().rows(); ++pointId) {
+        if (ties[pointId])
+            continue;
+        double const cosine = std::abs(updated.getNormals().row(pointId).dot(reference.getNormals().row(pointId)));
+        double const curvatureError = updated.hasCurvatures()
+                                      ? std::abs(updated.getCurvatures()(pointId) - reference.getCurvatures()(pointId))
+                                      : 0.;
+        if (!(cosine >= maxCos) || !(curvatureError <= 1.e-9))
+            ++count;
+    }
+    return count;
+} //...countMismatches()
+
+} //...ns anonymous
+
+/** \brief Checks that acq::DecoratedCloud::updateNormals() after moving some of the points
+ *         gives the normals and curvatures acq::DecoratedCloud::estimateNormals() gives.
+ *
+ * For each fraction of jittered points, the update is checked for normals estimated by the
+ * cloud and for the same normals given by acq::DecoratedCloud::setNormals(), which keeps no
+ * neighbourhoods, so the latter is only compared for k = acq::DecoratedCloud::DEFAULT_NORMAL_NEIGHBOURS.
+ * Points with ties at their k-th neighbour are skipped, see flagTies().
+ *
+ * Usage: normalUpdateCheck [input.off|input.ply] [k] [sigma]
+ * Without an input, 20k points are sampled from a noisy unit sphere. Defaults: k = 10, sigma =
+ * 0.002, the standard deviation of the jitter.
+ */
+int main(int argc, char *argv[]) {
+    std::string const input = argc > 1 ? argv[1] : "";
+    int         const k     = argc > 2 ? std::atoi(argv[2]) : 10;
+    double      const sigma = argc > 3 ? std::atof(argv[3]) : 0.002;
+    if (k <= 0 || sigma <= 0.) {
+        std::cerr << "Usage: " << argv[0] << " [input.off|input.ply] [k] [sigma]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::mt19937                     generator(42);
+    std::normal_distribution<double> normal(0., 1.);
+
+    acq::CloudT cloud;
+    if (input.empty()) {
+        cloud.resize(20000, 3);
+        for (Eigen::Index pointId = 0; pointId != cloud.rows(); ++pointId) {
+            Eigen::Vector3d const direction(normal(generator), normal(generator), normal(generator));
+            cloud.row(pointId) = (direction.normalized() * (1. + 0.01 * normal(generator))).transpose();
+        }
+    } else {
+        acq::DecoratedCloud decorated;
+        if (!acq::readMesh(input, decorated)) {
+            std::cerr << "Could not read " << input << "\n";
+            return EXIT_FAILURE;
+        }
+        cloud = decorated.getVertices();
+    }
+
+    bool ok = true;
+    double const fractions[] = { 0.01, 0.1 };
+    for (double const fraction : fractions) {
+        std::bernoulli_distribution pick(fraction);
+        acq::CloudT moved = cloud;
+        for (Eigen::Index pointId = 0; pointId != moved.rows(); ++pointId)
+            if (pick(generator))
+                moved.row(pointId) += sigma * Eigen::RowVector3d(normal(generator), normal(generator), normal(generator));
+
+        acq::DecoratedCloud reference(moved);
+        reference.estimateNormals(k);
+        std::vector<unsigned char> ties(static_cast<size_t>(cloud.rows()), 0);
+        flagTies(cloud, k, ties);
+        flagTies(moved, k, ties);
+
+        int const nCases = k == acq::DecoratedCloud::DEFAULT_NORMAL_NEIGHBOURS ? 2 : 1;
+        for (int given = 0; given != nCases; ++given) {
+            acq::DecoratedCloud updated(cloud);
+            updated.estimateNormals(k);
+            if (given) {
+                // The same normals, without curvatures and neighbourhoods, as if read from a file
+                acq::NormalsT const normals = updated.getNormals();
+                updated.setNormals(normals);
+            }
+            updated.setVertices(moved);
+            size_t const nDirty   = updated.getDirtyCount();
+            size_t const nUpdated = updated.updateNormals();
+            size_t const nWrong   = countMismatches(updated, reference, ties, 0.999);
+            std::cout << fraction * 100. << "% moved" << (given ? ", normals given" : "") << ": "
+                      << nDirty << " dirty, " << nUpdated << " updated, " << nWrong << " differ, "
+                      << std::count(ties.begin(), ties.end(), 1) << " tied skipped" << std::endl;
+            if (nWrong) {
+                std::cerr << "Updated normals differ from a full estimate\n";
+                ok = false;
+            }
+        }
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+} //...main()
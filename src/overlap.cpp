@@ -0,0 +1,158 @@
+#include "acq/impl/overlap.hpp"
+
+#include "acq/cloudIndex.h"
+
+#include "Eigen/Eigenvalues"        // SelfAdjointEigenSolver
+
+#include <cmath>
+
+namespace acq {
+
+OrientedBox
+computeOrientedBox(
+    CloudT const& cloud
+) {
+    OrientedBox box;
+    if (!cloud.rows())
+        return box;
+
+    // Principal axes of the points
+    Eigen::RowVector3d const mean     = cloud.colwise().mean();
+    CloudT             const centered = cloud.rowwise() - mean;
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> es(centered.transpose() * centered);
+
+    box.axes = es.eigenvectors();
+    // Keep right-handed
+    if (box.axes.determinant() < 0.)
+        box.axes.col(0) *= -1.;
+
+    // Extents in the box frame
+    CloudT const local = centered * box.axes;
+    Eigen::RowVector3d const minimum = local.colwise().minCoeff();
+    Eigen::RowVector3d const maximum = local.colwise().maxCoeff();
+
+    box.halfExtents = 0.5 * (maximum - minimum).transpose();
+    box.center      = mean.transpose() + box.axes * (0.5 * (maximum + minimum)).transpose();
+    return box;
+} //...computeOrientedBox()
+
+OrientedBox
+transformBox(
+    OrientedBox const& box,
+    PoseT       const& pose
+) {
+    OrientedBox moved(box);
+    moved.center = pose.topLeftCorner<3, 3>() * box.center + pose.topRightCorner<3, 1>();
+    moved.axes   = pose.topLeftCorner<3, 3>() * box.axes;
+    return moved;
+} //...transformBox()
+
+bool
+intersects(
+    OrientedBox const& a,
+    OrientedBox const& b,
+    double      const  margin
+) {
+    // Guards against parallel edges producing near-zero cross products
+    static double const epsilon = 1.e-9;
+
+    Eigen::Vector3d const extentsA = a.halfExtents.array() + margin;
+    Eigen::Vector3d const extentsB = b.halfExtents.array() + margin;
+
+    // b's axes and center in a's frame
+    Eigen::Matrix3d const R    = a.axes.transpose() * b.axes;
+    Eigen::Vector3d const t    = a.axes.transpose() * (b.center - a.center);
+    Eigen::Matrix3d const absR = R.cwiseAbs().array() + epsilon;
+
+    // Face axes of a
+    for (int i = 0; i != 3; ++i)
+        if (std::abs(t(i)) > extentsA(i) + absR.row(i).dot(extentsB))
+            return false;
+
+    // Face axes of b
+    for (int j = 0; j != 3; ++j)
+        if (std::abs(t.dot(R.col(j))) > absR.col(j).dot(extentsA) + extentsB(j))
+            return false;
+
+    // Edge-edge axes
+    for (int i = 0; i != 3; ++i) {
+        int const i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+        for (int j = 0; j != 3; ++j) {
+            int const j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+            double const ra = extentsA(i1) * absR(i2, j) + extentsA(i2) * absR(i1, j);
+            double const rb = extentsB(j1) * absR(i, j2) + extentsB(j2) * absR(i, j1);
+            if (std::abs(t(i2) * R(i1, j) - t(i1) * R(i2, j)) > ra + rb)
+                return false;
+        }
+    } //...for edge pairs
+
+    return true;
+} //...intersects()
+
+std::vector<int>
+computeMaxSpanningTree(
+    Eigen::MatrixXd const& weights,
+    int             const  root
+) {
+    int const nNodes = static_cast<int>(weights.rows());
+    std::vector<int> parents(nNodes, -1);
+    if (root < 0 || root >= nNodes)
+        return parents;
+
+    // Dense Prim, the graphs have one node per scan
+    std::vector<char>   inTree(nNodes, 0);
+    std::vector<double> bestWeight(nNodes, 0.);
+    int current = root;
+    inTree[root] = 1;
+    for (int added = 1; added < nNodes; ++added) {
+        // Relax edges of the latest node
+        for (int nodeId = 0; nodeId != nNodes; ++nodeId) {
+            if (inTree[nodeId])
+                continue;
+            double const weight = weights(current, nodeId);
+            if (weight > bestWeight[nodeId]) {
+                bestWeight[nodeId] = weight;
+                parents[nodeId]    = current;
+            }
+        }
+
+        // Pick the strongest connection to the tree
+        int next = -1;
+        for (int nodeId = 0; nodeId != nNodes; ++nodeId)
+            if (!inTree[nodeId] && parents[nodeId] != -1 &&
+                (next == -1 || bestWeight[nodeId] > bestWeight[next]))
+                next = nodeId;
+        // Rest is disconnected
+        if (next == -1)
+            break;
+
+        inTree[next] = 1;
+        current      = next;
+    } //...while nodes left
+
+    // Unreached nodes keep no parent
+    for (int nodeId = 0; nodeId != nNodes; ++nodeId)
+        if (!inTree[nodeId])
+            parents[nodeId] = -1;
+
+    return parents;
+} //...computeMaxSpanningTree()
+
+} //...ns acq
+
+
+//
+// Template instantiation
+//
+
+namespace acq {
+
+template double
+estimateOverlap(
+    CloudT        const& source,
+    CloudIndex    const& target,
+    PoseT         const& pose,
+    OverlapParams const& params
+);
+
+} //...ns acq
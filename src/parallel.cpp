@@ -0,0 +1,81 @@
+#include "acq/impl/parallel.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace acq {
+
+unsigned
+defaultThreadCount() {
+    unsigned const nThreads = std::thread::hardware_concurrency();
+    return nThreads ? nThreads : 1u;
+} //...defaultThreadCount()
+
+void
+parallelRadixSort(
+    std::vector<uint64_t>      & keys,
+    uint64_t              const  maxKey,
+    std::vector<int>           * values,
+    unsigned              const  nThreads
+) {
+    //! Bits per pass, the counts of a chunk stay in L1.
+    int    const DIGIT_BITS = 11;
+    size_t const N_BUCKETS  = size_t(1) << DIGIT_BITS;
+
+    size_t const n = keys.size();
+    if (values && values->size() != n) {
+        std::cerr << "[parallelRadixSort] Expected " << n << " values, got " << values->size() << "\n";
+        throw new std::runtime_error("Radix sort payload size mismatch");
+    }
+    if (n < 2)
+        return;
+
+    // One chunk per thread, unless the keys are few
+    unsigned const nWorkers = nThreads ? nThreads : defaultThreadCount();
+    size_t   const nChunks  = std::max<size_t>(1, std::min<size_t>(nWorkers, n / 65536));
+    auto const chunkBegin = [&](size_t const chunkId) { return chunkId * n / nChunks; };
+
+    std::vector<uint64_t> keysOut(n);
+    std::vector<int>      valuesOut(values ? n : 0);
+    std::vector<size_t>   counts(nChunks * N_BUCKETS);
+    for (int shift = 0; shift < 64 && (maxKey >> shift); shift += DIGIT_BITS) {
+        // Digit histogram of each chunk
+        std::fill(counts.begin(), counts.end(), 0);
+        parallelFor(nChunks, [&](size_t const chunkId) {
+            size_t *chunkCounts = counts.data() + chunkId * N_BUCKETS;
+            for (size_t i = chunkBegin(chunkId); i != chunkBegin(chunkId + 1); ++i)
+                ++chunkCounts[(keys[i] >> shift) & (N_BUCKETS - 1)];
+        }, 1, nThreads);
+
+        // Digit-major, chunk-minor exclusive prefix sum: where each chunk writes each digit
+        bool   skip  = false;
+        size_t start = 0;
+        for (size_t digit = 0; digit != N_BUCKETS; ++digit) {
+            size_t total = 0;
+            for (size_t chunkId = 0; chunkId != nChunks; ++chunkId) {
+                size_t const count = counts[chunkId * N_BUCKETS + digit];
+                counts[chunkId * N_BUCKETS + digit] = start + total;
+                total += count;
+            }
+            skip  |= total == n;
+            start += total;
+        }
+        if (skip)
+            continue;
+
+        parallelFor(nChunks, [&](size_t const chunkId) {
+            size_t *next = counts.data() + chunkId * N_BUCKETS;
+            for (size_t i = chunkBegin(chunkId); i != chunkBegin(chunkId + 1); ++i) {
+                size_t const to = next[(keys[i] >> shift) & (N_BUCKETS - 1)]++;
+                keysOut[to] = keys[i];
+                if (values)
+                    valuesOut[to] = (*values)[i];
+            }
+        }, 1, nThreads);
+        keys.swap(keysOut);
+        if (values)
+            values->swap(valuesOut);
+    } //...for digits
+} //...parallelRadixSort()
+
+} //...ns acq
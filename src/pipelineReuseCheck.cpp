@@ -0,0 +1,122 @@
+#include "acq/decoratedCloud.h"
+#include "acq/icp.h"
+#include "acq/meshIO.h"
+#include "acq/registrationPipeline.h"
+
+#include "Eigen/Geometry"    // AngleAxis
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** \brief Largest difference between the entries of \p a and \p b. */
+double
+getPoseDifference(
+    acq::PosesT const& a,
+    acq::PosesT const& b
+) {
+    double difference = 0.;
+    for (size_t poseId = 0; poseId != a.size(); ++poseId)
+        difference = std::max(difference, (a[poseId] - b[poseId]).cwiseAbs().maxCoeff());
+    return difference;
+} //...getPoseDifference()
+
+/** \brief Runs \p pipeline on the scans added to it, and refines the poses by \p params. */
+acq::PosesT
+registerScans(
+    acq::RegistrationPipeline                    & pipeline,
+    acq::RegistrationPipeline::RefineParams const& params
+) {
+    return pipeline.refine(pipeline.run(1), params, 1);
+} //...registerScans()
+
+} //...ns anonymous
+
+/** \brief Checks that acq::RegistrationPipeline gives the same poses when it is reused after
+ *         the points of a scan changed as a fresh pipeline does, instead of searching trees or
+ *         boxes of the old points.
+ *
+ * Usage: pipelineReuseCheck [input.off|input.ply]
+ * Without an input, a curved patch is sampled. Three overlapping parts of it are registered,
+ * then the target of the others is moved, and reduced to a part of its points, and registered again.
+ */
+int main(int argc, char *argv[]) {
+    std::string const input = argc > 1 ? argv[1] : "";
+
+    acq::CloudT world;
+    if (input.empty()) {
+        std::mt19937                           generator(42);
+        std::uniform_real_distribution<double> uniform(-1., 1.);
+        world.resize(6000, 3);
+        for (Eigen::Index pointId = 0; pointId != world.rows(); ++pointId) {
+            double const x = 1.5 * uniform(generator), y = 0.5 * uniform(generator);
+            world.row(pointId) << x, y, 0.2 * x * x - 0.3 * y * y + 0.1 * x * y;
+        }
+    } else {
+        acq::DecoratedCloud decorated;
+        if (!acq::readMesh(input, decorated)) {
+            std::cerr << "Could not read " << input << "\n";
+            return EXIT_FAILURE;
+        }
+        world = decorated.getVertices();
+    }
+    double const extent = (world.colwise().maxCoeff() - world.colwise().minCoeff()).norm();
+
+    // Overlapping slices along x, each slightly off its true pose
+    double const minX = world.col(0).minCoeff(), width = world.col(0).maxCoeff() - minX;
+    std::vector<acq::DecoratedCloud> scans(3);
+    for (int scanId = 0; scanId != 3; ++scanId) {
+        std::vector<Eigen::Index> rows;
+        for (Eigen::Index pointId = 0; pointId != world.rows(); ++pointId) {
+            double const u = (world(pointId, 0) - minX) / width;
+            if (u >= 0.3 * scanId && u <= 0.3 * scanId + 0.4)
+                rows.push_back(pointId);
+        }
+        acq::CloudT part(rows.size(), 3);
+        for (size_t i = 0; i != rows.size(); ++i)
+            part.row(i) = world.row(rows[i]);
+
+        acq::PoseT offset(acq::PoseT::Identity());
+        offset.topLeftCorner<3, 3>() = Eigen::AngleAxisd(0.02 * (scanId - 1), Eigen::Vector3d::UnitZ()).toRotationMatrix();
+        offset.topRightCorner<3, 1>() << 0.005 * extent * (scanId - 1), 0., 0.;
+        scans[scanId] = acq::DecoratedCloud(acq::transformCloud(part, offset));
+    }
+
+    acq::IcpParams params;
+    params.maxDistSqr = 0.01 * extent * extent;
+    acq::RegistrationPipeline::RefineParams refineParams;
+    refineParams.maxDistSqr = 1.e-4 * extent * extent;
+
+    acq::RegistrationPipeline reused(params);
+    for (acq::DecoratedCloud const& scan : scans)
+        reused.addScan(scan);
+    reused.setPairing(acq::RegistrationPipeline::STAR, 1);
+    registerScans(reused, refineParams);
+
+    // The reference scan moves and loses points, as after an edit in the viewer
+    acq::PoseT edit(acq::PoseT::Identity());
+    edit.topLeftCorner<3, 3>() = Eigen::AngleAxisd(0.05, Eigen::Vector3d::UnitY()).toRotationMatrix();
+    edit.topRightCorner<3, 1>() << 0., 0.01 * extent, 0.;
+    acq::CloudT const moved = acq::transformCloud(scans[1].getVertices(), edit);
+    scans[1].setVertices(moved.topRows(moved.rows() * 3 / 4));
+    acq::PosesT const again = registerScans(reused, refineParams);
+
+    acq::RegistrationPipeline fresh(params);
+    for (acq::DecoratedCloud const& scan : scans)
+        fresh.addScan(scan);
+    fresh.setPairing(acq::RegistrationPipeline::STAR, 1);
+    acq::PosesT const expected = registerScans(fresh, refineParams);
+
+    double const difference = getPoseDifference(again, expected);
+    std::cout << "Reused and fresh poses differ by " << difference << std::endl;
+    if (!(difference <= 1.e-12)) {
+        std::cerr << "The reused pipeline kept data of the old points\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+} //...main()
@@ -0,0 +1,522 @@
+#include "acq/plyIO.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+namespace acq {
+
+namespace {
+    //! Bytes read from the file at a time.
+    size_t const BUFFER_BYTES = 1 << 20;
+
+    inline bool isLittleEndian() {
+        uint16_t const one = 1;
+        return *reinterpret_cast<unsigned char const*>(&one) == 1;
+    }
+
+    /** \brief Removes a trailing carriage return left by Windows line endings. */
+    inline void trimLine(std::string &line) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+    }
+
+    /** \brief Writes \p size bytes of \p value in little endian order. */
+    inline void putLittleEndian(char *dst, void const* value, size_t const size) {
+        std::memcpy(dst, value, size);
+        if (!isLittleEndian())
+            std::reverse(dst, dst + size);
+    }
+} //...ns anonymous
+
+/** \brief Decodes the body of a PLY file value by value, from a buffer for binary files. */
+class PlyReader::Source {
+public:
+    enum Format { ASCII, BINARY_LITTLE_ENDIAN, BINARY_BIG_ENDIAN };
+
+    Source() : format(ASCII), _begin(0), _end(0) {}
+
+    /** \brief Reads the next value of type \p type. */
+    bool readValue(Type const type, double &value) {
+        if (format == ASCII)
+            return static_cast<bool>(in >> value);
+
+        size_t const size = getSize(type);
+        char bytes[8];
+        if (!readBytes(bytes, size))
+            return false;
+        if ((format == BINARY_LITTLE_ENDIAN) != isLittleEndian())
+            std::reverse(bytes, bytes + size);
+
+        switch (type) {
+            case INT8:    { int8_t   v; std::memcpy(&v, bytes, size); value = v; break; }
+            case UINT8:   { uint8_t  v; std::memcpy(&v, bytes, size); value = v; break; }
+            case INT16:   { int16_t  v; std::memcpy(&v, bytes, size); value = v; break; }
+            case UINT16:  { uint16_t v; std::memcpy(&v, bytes, size); value = v; break; }
+            case INT32:   { int32_t  v; std::memcpy(&v, bytes, size); value = v; break; }
+            case UINT32:  { uint32_t v; std::memcpy(&v, bytes, size); value = v; break; }
+            case FLOAT32: { float    v; std::memcpy(&v, bytes, size); value = v; break; }
+            case FLOAT64: { double   v; std::memcpy(&v, bytes, size); value = v; break; }
+        }
+        return true;
+    } //...readValue()
+
+    /** \brief Size of \p type in bytes. */
+    static size_t getSize(Type const type) {
+        switch (type) {
+            case INT8:  case UINT8:   return 1;
+            case INT16: case UINT16:  return 2;
+            case INT32: case UINT32:
+            case FLOAT32:             return 4;
+            default:                  return 8;
+        }
+    } //...getSize()
+
+    std::ifstream in;     //!< The file, positioned after the header once it was parsed.
+    Format        format; //!< Encoding of the body.
+
+protected:
+    /** \brief Copies the next \p size bytes to \p dst, refilling the buffer as needed. */
+    bool readBytes(char *dst, size_t size) {
+        while (size) {
+            if (_begin == _end) {
+                _buffer.resize(BUFFER_BYTES);
+                in.read(_buffer.data(), _buffer.size());
+                _begin = 0;
+                _end   = static_cast<size_t>(in.gcount());
+                if (!_end)
+                    return false;
+            }
+            size_t const n = std::min(size, _end - _begin);
+            std::memcpy(dst, _buffer.data() + _begin, n);
+            _begin += n;
+            dst    += n;
+            size   -= n;
+        }
+        return true;
+    } //...readBytes()
+
+    std::vector<char> _buffer; //!< Binary data read ahead.
+    size_t            _begin;  //!< Next unread byte in \ref _buffer.
+    size_t            _end;    //!< One past the last valid byte in \ref _buffer.
+}; //...class PlyReader::Source
+
+PlyReader::PlyReader(size_t const chunkSize)
+    : _chunkSize(std::max(chunkSize, size_t(1))), _nVertices(0), _nFaces(0), _hasNormals(false)
+{}
+
+PlyReader::~PlyReader() {}
+
+bool PlyReader::open(std::string const& path) {
+    _path = path;
+    _elements.clear();
+    _nVertices = _nFaces = 0;
+    _hasNormals = false;
+
+    _source.reset(new Source());
+    _source->in.open(path, std::ios::binary);
+    if (!_source->in) {
+        std::cerr << "[PlyReader::open] Could not open " << path << "\n";
+        return false;
+    }
+
+    std::string line;
+    std::getline(_source->in, line);
+    trimLine(line);
+    if (line != "ply") {
+        std::cerr << "[PlyReader::open] " << path << " is not a PLY file\n";
+        return false;
+    }
+
+    static std::pair<char const*, Type> const typeNames[] = {
+        { "char",  INT8    }, { "int8",    INT8    }, { "uchar",   UINT8   }, { "uint8",  UINT8  },
+        { "short", INT16   }, { "int16",   INT16   }, { "ushort",  UINT16  }, { "uint16", UINT16 },
+        { "int",   INT32   }, { "int32",   INT32   }, { "uint",    UINT32  }, { "uint32", UINT32 },
+        { "float", FLOAT32 }, { "float32", FLOAT32 }, { "double",  FLOAT64 }, { "float64", FLOAT64 }
+    };
+    auto const parseType = [&](std::string const& name, Type &type) {
+        for (auto const& typeName : typeNames)
+            if (name == typeName.first) {
+                type = typeName.second;
+                return true;
+            }
+        std::cerr << "[PlyReader::open] Unknown property type " << name << " in " << path << "\n";
+        return false;
+    };
+
+    bool hasFormat = false;
+    while (std::getline(_source->in, line)) {
+        trimLine(line);
+        std::istringstream tokens(line);
+        std::string keyword;
+        tokens >> keyword;
+
+        if (keyword == "end_header") {
+            if (!hasFormat) {
+                std::cerr << "[PlyReader::open] " << path << " has no format line\n";
+                return false;
+            }
+            for (Element const& element : _elements) {
+                if (element.name == "vertex") {
+                    _nVertices = element.count;
+                    int nNormals = 0;
+                    for (Property const& property : element.properties)
+                        nNormals += property.name == "nx" || property.name == "ny" || property.name == "nz";
+                    _hasNormals = nNormals == 3;
+                } else if (element.name == "face")
+                    _nFaces = element.count;
+            }
+            return true;
+        } else if (keyword == "format") {
+            std::string format;
+            tokens >> format;
+            if (format == "ascii")
+                _source->format = Source::ASCII;
+            else if (format == "binary_little_endian")
+                _source->format = Source::BINARY_LITTLE_ENDIAN;
+            else if (format == "binary_big_endian")
+                _source->format = Source::BINARY_BIG_ENDIAN;
+            else {
+                std::cerr << "[PlyReader::open] Unknown format " << format << " in " << path << "\n";
+                return false;
+            }
+            hasFormat = true;
+        } else if (keyword == "element") {
+            Element element;
+            if (!(tokens >> element.name >> element.count)) {
+                std::cerr << "[PlyReader::open] Invalid element line \"" << line << "\" in " << path << "\n";
+                return false;
+            }
+            _elements.push_back(element);
+        } else if (keyword == "property") {
+            if (_elements.empty()) {
+                std::cerr << "[PlyReader::open] Property before any element in " << path << "\n";
+                return false;
+            }
+            Property property;
+            std::string typeName;
+            tokens >> typeName;
+            property.isList    = typeName == "list";
+            property.countType = UINT8;
+            if (property.isList) {
+                std::string countTypeName;
+                tokens >> countTypeName >> typeName;
+                if (!parseType(countTypeName, property.countType))
+                    return false;
+            }
+            if (!parseType(typeName, property.type) || !(tokens >> property.name)) {
+                std::cerr << "[PlyReader::open] Invalid property line \"" << line << "\" in " << path << "\n";
+                return false;
+            }
+            _elements.back().properties.push_back(property);
+        } // ...else comment, obj_info
+    } //...while header lines
+
+    std::cerr << "[PlyReader::open] " << path << " has no end_header\n";
+    return false;
+} //...PlyReader::open()
+
+bool PlyReader::read(VertexCallbackT const& onVertices, FaceCallbackT const& onFaces) {
+    if (!_source || !_source->in) {
+        std::cerr << "[PlyReader::read] Call open() first\n";
+        return false;
+    }
+    for (Element const& element : _elements)
+        if (!readElement(element, onVertices, onFaces))
+            return false;
+    return true;
+} //...PlyReader::read()
+
+bool PlyReader::readElement(Element const& element, VertexCallbackT const& onVertices, FaceCallbackT const& onFaces) {
+    Source &source = *_source;
+    bool const isVertex = element.name == "vertex";
+    bool const isFace   = element.name == "face";
+
+    // Where each property goes: 0..2 coordinates, 3..5 normals, 6 face indices, -1 nowhere
+    static char const* const slotNames[] = { "x", "y", "z", "nx", "ny", "nz" };
+    std::vector<int> slots(element.properties.size(), -1);
+    for (size_t propertyId = 0; propertyId != element.properties.size(); ++propertyId) {
+        Property const& property = element.properties[propertyId];
+        if (isVertex && !property.isList) {
+            for (int slot = 0; slot != (_hasNormals ? 6 : 3); ++slot)
+                if (property.name == slotNames[slot])
+                    slots[propertyId] = slot;
+        } else if (isFace && property.isList && (property.name == "vertex_indices" || property.name == "vertex_index"))
+            slots[propertyId] = 6;
+    }
+    if (isVertex && std::count_if(slots.begin(), slots.end(), [](int const slot) { return slot >= 0 && slot < 3; }) != 3) {
+        std::cerr << "[PlyReader::read] Vertices of " << _path << " have no x, y, z\n";
+        return false;
+    }
+
+    PlyVertexChunk vertexChunk;
+    PlyFaceChunk   faceChunk;
+    Eigen::Index   faceSize = -1;
+    double         value, count;
+    for (size_t first = 0; first < element.count; first += _chunkSize) {
+        Eigen::Index const nRecords = static_cast<Eigen::Index>(std::min(_chunkSize, element.count - first));
+        if (isVertex) {
+            vertexChunk.first = first;
+            vertexChunk.vertices.resize(nRecords, 3);
+            vertexChunk.normals.resize(_hasNormals ? nRecords : 0, 3);
+        } else if (isFace) {
+            faceChunk.first = first;
+            faceChunk.faces.resize(nRecords, std::max(faceSize, Eigen::Index(0)));
+        }
+
+        for (Eigen::Index row = 0; row != nRecords; ++row) {
+            for (size_t propertyId = 0; propertyId != element.properties.size(); ++propertyId) {
+                Property const& property = element.properties[propertyId];
+                int      const  slot     = slots[propertyId];
+                if (!property.isList) {
+                    if (!source.readValue(property.type, value))
+                        goto truncated;
+                    if (slot >= 3)
+                        vertexChunk.normals(row, slot - 3) = value;
+                    else if (slot >= 0)
+                        vertexChunk.vertices(row, slot) = value;
+                    continue;
+                }
+
+                if (!source.readValue(property.countType, count) || count < 0)
+                    goto truncated;
+                Eigen::Index const length = static_cast<Eigen::Index>(count);
+                if (slot == 6) {
+                    // The first face decides the width of all
+                    if (faceSize < 0) {
+                        faceSize = length;
+                        faceChunk.faces.resize(nRecords, faceSize);
+                    }
+                    if (length != faceSize) {
+                        std::cerr << "[PlyReader::read] Face " << first + row << " of " << _path << " has "
+                                  << length << " vertices, expected " << faceSize << "\n";
+                        return false;
+                    }
+                }
+                for (Eigen::Index entry = 0; entry != length; ++entry) {
+                    if (!source.readValue(property.type, value))
+                        goto truncated;
+                    if (slot != 6)
+                        continue;
+                    // Also rejects NaN, and values beyond int before the cast
+                    if (!(value >= 0.) || value > static_cast<double>(std::numeric_limits<int>::max())
+                        || value >= static_cast<double>(_nVertices)) {
+                        std::cerr << "[PlyReader::read] Face " << first + row << " of " << _path << " refers to vertex "
+                                  << value << " of " << _nVertices << "\n";
+                        return false;
+                    }
+                    faceChunk.faces(row, entry) = static_cast<int>(value);
+                }
+            } //...for properties
+        } //...for records
+
+        if (isVertex && onVertices)
+            onVertices(vertexChunk);
+        else if (isFace && onFaces)
+            onFaces(faceChunk);
+    } //...for chunks
+
+    return true;
+
+truncated:
+    std::cerr << "[PlyReader::read] " << _path << " ended early or is invalid in element " << element.name << "\n";
+    return false;
+} //...PlyReader::readElement()
+
+PlyWriter::PlyWriter()
+    : _nVertices(0), _nFaces(0), _vertexCount(0), _faceCount(0),
+      _hasNormals(false), _faceSize(3), _binary(true)
+{}
+
+PlyWriter::~PlyWriter() {
+    if (_file.is_open())
+        close();
+}
+
+bool PlyWriter::open(
+    std::string const& path,
+    size_t      const  nVertices,
+    size_t      const  nFaces,
+    bool        const  hasNormals,
+    int         const  faceSize,
+    bool        const  binary
+) {
+    if (_file.is_open())
+        close();
+
+    _path        = path;
+    _nVertices   = nVertices;
+    _nFaces      = nFaces;
+    _vertexCount = 0;
+    _faceCount   = 0;
+    _hasNormals  = hasNormals;
+    _faceSize    = faceSize;
+    _binary      = binary;
+
+    if (faceSize < 1 || faceSize > std::numeric_limits<uint8_t>::max()) {
+        std::cerr << "[PlyWriter::open] Invalid face size " << faceSize << "\n";
+        return false;
+    }
+
+    _file.open(path, std::ios::binary | std::ios::trunc);
+    if (!_file) {
+        std::cerr << "[PlyWriter::open] Could not create " << path << "\n";
+        return false;
+    }
+
+    _file << "ply\n"
+          << "format " << (binary ? "binary_little_endian" : "ascii") << " 1.0\n"
+          << "element vertex " << nVertices << "\n"
+          << "property double x\nproperty double y\nproperty double z\n";
+    if (hasNormals)
+        _file << "property double nx\nproperty double ny\nproperty double nz\n";
+    _file << "element face " << nFaces << "\n"
+          << "property list uchar int vertex_indices\n"
+          << "end_header\n";
+    if (!binary)
+        _file << std::setprecision(std::numeric_limits<double>::max_digits10);
+
+    return static_cast<bool>(_file);
+} //...PlyWriter::open()
+
+bool PlyWriter::writeVertices(CloudT const& vertices, NormalsT const& normals) {
+    if (!_file.is_open() || _faceCount || _vertexCount + vertices.rows() > _nVertices || vertices.cols() != 3
+        || (_hasNormals && (normals.rows() != vertices.rows() || normals.cols() != 3))) {
+        std::cerr << "[PlyWriter::writeVertices] Unexpected " << vertices.rows() << " vertices (and "
+                  << normals.rows() << " normals) after " << _vertexCount << " of " << _nVertices
+                  << " vertices and " << _faceCount << " faces\n";
+        return false;
+    }
+
+    int const nCols = _hasNormals ? 6 : 3;
+    if (_binary) {
+        // Interleave rows in one buffer, one write per chunk
+        std::vector<char> buffer(vertices.rows() * nCols * sizeof(double));
+        char *dst = buffer.data();
+        for (Eigen::Index row = 0; row != vertices.rows(); ++row)
+            for (int col = 0; col != nCols; ++col, dst += sizeof(double)) {
+                double const value = col < 3 ? vertices(row, col) : normals(row, col - 3);
+                putLittleEndian(dst, &value, sizeof(double));
+            }
+        _file.write(buffer.data(), buffer.size());
+    } else {
+        for (Eigen::Index row = 0; row != vertices.rows(); ++row) {
+            _file << vertices(row, 0) << " " << vertices(row, 1) << " " << vertices(row, 2);
+            if (_hasNormals)
+                _file << " " << normals(row, 0) << " " << normals(row, 1) << " " << normals(row, 2);
+            _file << "\n";
+        }
+    }
+
+    _vertexCount += vertices.rows();
+    return static_cast<bool>(_file);
+} //...PlyWriter::writeVertices()
+
+bool PlyWriter::writeFaces(FacesT const& faces) {
+    if (!_file.is_open() || _vertexCount != _nVertices || _faceCount + faces.rows() > _nFaces
+        || (faces.rows() && faces.cols() != _faceSize)) {
+        std::cerr << "[PlyWriter::writeFaces] Unexpected " << faces.rows() << " x " << faces.cols()
+                  << " faces after " << _vertexCount << " of " << _nVertices << " vertices and "
+                  << _faceCount << " of " << _nFaces << " faces\n";
+        return false;
+    }
+
+    if (_binary) {
+        size_t const recordSize = 1 + _faceSize * sizeof(int32_t);
+        std::vector<char> buffer(faces.rows() * recordSize);
+        char *dst = buffer.data();
+        for (Eigen::Index row = 0; row != faces.rows(); ++row) {
+            *dst++ = static_cast<char>(_faceSize);
+            for (int col = 0; col != _faceSize; ++col, dst += sizeof(int32_t)) {
+                int32_t const index = faces(row, col);
+                putLittleEndian(dst, &index, sizeof(int32_t));
+            }
+        }
+        _file.write(buffer.data(), buffer.size());
+    } else {
+        for (Eigen::Index row = 0; row != faces.rows(); ++row) {
+            _file << _faceSize;
+            for (int col = 0; col != _faceSize; ++col)
+                _file << " " << faces(row, col);
+            _file << "\n";
+        }
+    }
+
+    _faceCount += faces.rows();
+    return static_cast<bool>(_file);
+} //...PlyWriter::writeFaces()
+
+bool PlyWriter::close() {
+    if (!_file.is_open())
+        return false;
+
+    bool const complete = _vertexCount == _nVertices && _faceCount == _nFaces;
+    if (!complete)
+        std::cerr << "[PlyWriter::close] " << _path << " announced " << _nVertices << " vertices and "
+                  << _nFaces << " faces, got " << _vertexCount << " and " << _faceCount << "\n";
+    _file.close();
+    return complete && !_file.fail();
+} //...PlyWriter::close()
+
+bool
+readPly(
+    std::string const& path,
+    DecoratedCloud   & cloud,
+    ReadStats        * stats
+) {
+    typedef std::chrono::steady_clock ClockT;
+    ClockT::time_point const start = ClockT::now();
+
+    PlyReader reader;
+    if (!reader.open(path))
+        return false;
+
+    CloudT   &vertices = cloud.getVertices();
+    NormalsT &normals  = cloud.getNormals();
+    FacesT   &faces    = cloud.getFaces();
+    vertices.resize(reader.getVertexCount(), 3);
+    normals.resize(reader.hasNormals() ? reader.getVertexCount() : 0, 3);
+    faces.resize(0, 3);
+    bool const ok = reader.read(
+        [&](PlyVertexChunk const& chunk) {
+            vertices.middleRows(chunk.first, chunk.vertices.rows()) = chunk.vertices;
+            if (chunk.normals.size())
+                normals.middleRows(chunk.first, chunk.normals.rows()) = chunk.normals;
+        },
+        [&](PlyFaceChunk const& chunk) {
+            if (!chunk.first)
+                faces.resize(reader.getFaceCount(), chunk.faces.cols());
+            faces.middleRows(chunk.first, chunk.faces.rows()) = chunk.faces;
+        });
+    if (!ok)
+        return false;
+
+    if (stats) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        stats->bytes   = static_cast<size_t>(file.tellg());
+        stats->chunks  = 1;
+        stats->seconds = std::chrono::duration<double>(ClockT::now() - start).count();
+    }
+    return true;
+} //...readPly()
+
+bool
+writePly(
+    std::string    const& path,
+    DecoratedCloud const& cloud,
+    bool           const  binary
+) {
+    PlyWriter writer;
+    return writer.open(path, cloud.getVertices().rows(), cloud.getFaces().rows(), cloud.hasNormals(),
+                       cloud.hasFaces() ? static_cast<int>(cloud.getFaces().cols()) : 3, binary)
+           && writer.writeVertices(cloud.getVertices(), cloud.getNormals())
+           && writer.writeFaces(cloud.getFaces())
+           && writer.close();
+} //...writePly()
+
+} //...ns acq
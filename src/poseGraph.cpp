@@ -0,0 +1,195 @@
+#include "acq/poseGraph.h"
+
+#include "acq/icp.h"                 // invertPose()
+
+#include "Eigen/Geometry"            // AngleAxis
+#include "Eigen/SparseCore"
+#include "Eigen/SparseCholesky"      // SimplicialLDLT
+
+#include <iostream>
+#include <stdexcept>
+
+namespace acq {
+
+namespace {
+
+//! 6x6 block type
+typedef Eigen::Matrix<double, 6, 6> Matrix6;
+
+/** \brief Small rigid motion: rotation by axis-angle \p xi.head(3), then translation by \p xi.tail(3). */
+PoseT
+expPose(
+    PoseGraph::Vector6 const& xi
+) {
+    PoseT pose(PoseT::Identity());
+    double const angle = xi.head<3>().norm();
+    if (angle > 0.)
+        pose.topLeftCorner<3, 3>() =
+            Eigen::AngleAxisd(angle, xi.head<3>() / angle).toRotationMatrix();
+    pose.topRightCorner<3, 1>() = xi.tail<3>();
+    return pose;
+} //...expPose()
+
+/** \brief Inverse of \ref expPose(). */
+PoseGraph::Vector6
+logPose(
+    PoseT const& pose
+) {
+    Eigen::AngleAxisd const rotation(Eigen::Matrix3d(pose.topLeftCorner<3, 3>()));
+    PoseGraph::Vector6 xi;
+    xi.head<3>() = rotation.angle() * rotation.axis();
+    xi.tail<3>() = pose.topRightCorner<3, 1>();
+    return xi;
+} //...logPose()
+
+/** \brief Error of measurement \p measurement between poses \p source and \p target.
+ *
+ * The motion, applied in source coordinates, that is left between the measurement and the
+ * poses: measurement * exp(error) = target^-1 * source. \ref CorrespondenceStats::information
+ * weights motions in the same frame.
+ */
+PoseGraph::Vector6
+edgeError(
+    PoseT const& source,
+    PoseT const& target,
+    PoseT const& measurement
+) {
+    return logPose(invertPose(measurement) * invertPose(target) * source);
+} //...edgeError()
+
+} //...ns anonymous
+
+int PoseGraph::addNode(PoseT const& pose) {
+    _poses.push_back(pose);
+    return static_cast<int>(_poses.size()) - 1;
+} //...PoseGraph::addNode()
+
+int PoseGraph::addEdge(int const source, int const target, PoseT const& measurement, InformationT const& information) {
+    int const nNodes = static_cast<int>(_poses.size());
+    if (source < 0 || source >= nNodes || target < 0 || target >= nNodes || source == target) {
+        std::cerr << "[PoseGraph::addEdge] Invalid edge " << source << " -> " << target
+                  << " in graph of " << nNodes << " nodes\n";
+        throw new std::runtime_error("Invalid edge");
+    }
+
+    Edge edge;
+    edge.source      = source;
+    edge.target      = target;
+    edge.measurement = measurement;
+    edge.information = information;
+    _edges.push_back(edge);
+    return static_cast<int>(_edges.size()) - 1;
+} //...PoseGraph::addEdge()
+
+void PoseGraph::setEdge(int const edgeId, PoseT const& measurement, InformationT const& information) {
+    _edges.at(edgeId).measurement = measurement;
+    _edges.at(edgeId).information = information;
+} //...PoseGraph::setEdge()
+
+PoseGraph::Vector6 PoseGraph::getError(Edge const& edge) const {
+    return edgeError(_poses[edge.source], _poses[edge.target], edge.measurement);
+} //...PoseGraph::getError()
+
+double PoseGraph::getChiSquared() const {
+    double chi2 = 0.;
+    for (Edge const& edge : _edges) {
+        Vector6 const error = getError(edge);
+        chi2 += error.dot(edge.information * error);
+    }
+    return chi2;
+} //...PoseGraph::getChiSquared()
+
+int PoseGraph::optimize(int const maxIterations, double const minUpdate) {
+    // Central differences step for the Jacobians
+    static double const h = 1.e-6;
+    // Keeps unconstrained directions solvable
+    static double const damping = 1.e-6;
+
+    int const nNodes = static_cast<int>(_poses.size());
+    if (nNodes < 2 || _edges.empty())
+        return 0;
+
+    // Variable block of each node, -1 for the fixed node
+    std::vector<int> blockIds(nNodes, -1);
+    int nBlocks = 0;
+    for (int nodeId = 0; nodeId != nNodes; ++nodeId)
+        if (nodeId != _fixed)
+            blockIds[nodeId] = nBlocks++;
+
+    double chi2      = getChiSquared();
+    int    iteration = 0;
+    for (; iteration < maxIterations; ++iteration) {
+        std::vector<Eigen::Triplet<double> > triplets;
+        triplets.reserve(_edges.size() * 4 * 36 + nBlocks * 6);
+        Eigen::VectorXd b(Eigen::VectorXd::Zero(nBlocks * 6));
+
+        for (Edge const& edge : _edges) {
+            PoseT const& source = _poses[edge.source];
+            PoseT const& target = _poses[edge.target];
+            Vector6 const error = edgeError(source, target, edge.measurement);
+
+            // Numeric Jacobians w.r.t. left perturbations of both poses
+            Matrix6 A, B;
+            for (int dim = 0; dim != 6; ++dim) {
+                Vector6 step(Vector6::Zero());
+                step(dim) = h;
+                A.col(dim) = (edgeError(expPose( step) * source, target, edge.measurement) -
+                              edgeError(expPose(-step) * source, target, edge.measurement)) / (2. * h);
+                B.col(dim) = (edgeError(source, expPose( step) * target, edge.measurement) -
+                              edgeError(source, expPose(-step) * target, edge.measurement)) / (2. * h);
+            }
+
+            int const          blocks[2]    = { blockIds[edge.source], blockIds[edge.target] };
+            Matrix6 const      jacobians[2] = { A, B };
+            for (int i = 0; i != 2; ++i) {
+                if (blocks[i] < 0)
+                    continue;
+                b.segment<6>(blocks[i] * 6) += jacobians[i].transpose() * edge.information * error;
+                for (int j = 0; j != 2; ++j) {
+                    if (blocks[j] < 0)
+                        continue;
+                    Matrix6 const Hij = jacobians[i].transpose() * edge.information * jacobians[j];
+                    for (int row = 0; row != 6; ++row)
+                        for (int col = 0; col != 6; ++col)
+                            triplets.push_back(
+                                Eigen::Triplet<double>(blocks[i] * 6 + row, blocks[j] * 6 + col, Hij(row, col)));
+                }
+            } //...for both ends
+        } //...for edges
+        for (int var = 0; var != nBlocks * 6; ++var)
+            triplets.push_back(Eigen::Triplet<double>(var, var, damping));
+
+        // Duplicates are summed
+        Eigen::SparseMatrix<double> H(nBlocks * 6, nBlocks * 6);
+        H.setFromTriplets(triplets.begin(), triplets.end());
+
+        Eigen::SimplicialLDLT<Eigen::SparseMatrix<double> > solver(H);
+        if (solver.info() != Eigen::Success) {
+            std::cerr << "[PoseGraph::optimize] Factorization failed\n";
+            break;
+        }
+        Eigen::VectorXd const dx = solver.solve(-b);
+
+        // Apply, revert if worse
+        PosesT const previous = _poses;
+        for (int nodeId = 0; nodeId != nNodes; ++nodeId)
+            if (blockIds[nodeId] >= 0)
+                _poses[nodeId] = expPose(dx.segment<6>(blockIds[nodeId] * 6)) * _poses[nodeId];
+
+        double const newChi2 = getChiSquared();
+        if (newChi2 > chi2) {
+            _poses = previous;
+            break;
+        }
+        chi2 = newChi2;
+
+        if (dx.lpNorm<Eigen::Infinity>() < minUpdate) {
+            ++iteration;
+            break;
+        }
+    } //...for iterations
+
+    return iteration;
+} //...PoseGraph::optimize()
+
+} //...ns acq
@@ -0,0 +1,152 @@
+#include "acq/cloudIndex.h"
+#include "acq/decoratedCloud.h"
+#include "acq/icp.h"
+#include "acq/meshIO.h"
+#include "acq/poseGraph.h"
+
+#include "Eigen/Cholesky"    // LLT
+#include "Eigen/Geometry"    // AngleAxis
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** \brief Rigid motion rotating by axis-angle \p xi.head(3), then translating by \p xi.tail(3). */
+acq::PoseT
+makePose(
+    acq::PoseGraph::Vector6 const& xi
+) {
+    acq::PoseT pose(acq::PoseT::Identity());
+    double const angle = xi.head<3>().norm();
+    if (angle > 0.)
+        pose.topLeftCorner<3, 3>() = Eigen::AngleAxisd(angle, xi.head<3>() / angle).toRotationMatrix();
+    pose.topRightCorner<3, 1>() = xi.tail<3>();
+    return pose;
+} //...makePose()
+
+/** \brief Root mean squared distance of \p cloud placed by \p pose and by \p truth. */
+double
+getPointError(
+    acq::CloudT const& cloud,
+    acq::PoseT  const& pose,
+    acq::PoseT  const& truth
+) {
+    acq::CloudT const difference = acq::transformCloud(cloud, pose) - acq::transformCloud(cloud, truth);
+    return std::sqrt(difference.rowwise().squaredNorm().mean());
+} //...getPointError()
+
+} //...ns anonymous
+
+/** \brief Checks that acq::PoseGraph::optimize() reduces the edge error of a noisy loop and
+ *         brings the poses closer to the truth than the drifted chain they start from.
+ *
+ * A ring of scans views the same surface, the edges are the exact relative poses perturbed in
+ * source coordinates, with noise following the inverse of their
+ * acq::CorrespondenceStats::information.
+ *
+ * Usage: poseGraphCheck [input.off|input.ply] [nNodes] [noise]
+ * Without an input, a curved, elongated patch is sampled. Defaults: nNodes = 8, noise = 0.01
+ * (point noise relative to the extent of the surface).
+ */
+int main(int argc, char *argv[]) {
+    std::string const input  = argc > 1 ? argv[1] : "";
+    int         const nNodes = argc > 2 ? std::atoi(argv[2]) : 8;
+    double      const noise  = argc > 3 ? std::atof(argv[3]) : 0.01;
+    if (nNodes < 3 || noise <= 0.) {
+        std::cerr << "Usage: " << argv[0] << " [input.off|input.ply] [nNodes] [noise]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::mt19937                     generator(42);
+    std::normal_distribution<double> normal(0., 1.);
+
+    acq::CloudT world;
+    if (input.empty()) {
+        std::uniform_real_distribution<double> uniform(-1., 1.);
+        world.resize(5000, 3);
+        for (Eigen::Index pointId = 0; pointId != world.rows(); ++pointId) {
+            double const x = 2. * uniform(generator), y = 0.5 * uniform(generator);
+            world.row(pointId) << x, y, 0.2 * x * x - 0.5 * y * y + 0.1 * x * y;
+        }
+    } else {
+        acq::DecoratedCloud decorated;
+        if (!acq::readMesh(input, decorated)) {
+            std::cerr << "Could not read " << input << "\n";
+            return EXIT_FAILURE;
+        }
+        world = decorated.getVertices();
+    }
+    double const extent = (world.colwise().maxCoeff() - world.colwise().minCoeff()).norm();
+    Eigen::RowVector3d const centroid = world.colwise().mean();
+
+    // Scanners on a ring around the surface, each scan in its own coordinates
+    acq::PosesT truth;
+    std::vector<acq::CloudT> clouds;
+    for (int nodeId = 0; nodeId != nNodes; ++nodeId) {
+        acq::PoseGraph::Vector6 xi;
+        xi << 0., 2. * M_PI * nodeId / nNodes, 0.1 * normal(generator),
+              0., 0., 0.;
+        acq::PoseT pose = makePose(xi);
+        pose.topRightCorner<3, 1>() = centroid.transpose() - pose.topLeftCorner<3, 3>() * Eigen::Vector3d(0., 0., extent);
+        truth.push_back(pose);
+        clouds.push_back(acq::transformCloud(world, acq::invertPose(pose)));
+    }
+
+    // Chain and loop closure, with noise drawn from the covariance of each edge
+    acq::IcpParams params;
+    params.maxDistSqr = 1.e-6 * extent * extent;
+    acq::PoseGraph graph;
+    acq::PosesT chain(1, truth[0]);
+    for (int nodeId = 0; nodeId != nNodes; ++nodeId)
+        graph.addNode(truth[nodeId]);
+    for (int source = 0; source != nNodes; ++source) {
+        int const target = (source + 1) % nNodes;
+        acq::PoseT const relative = acq::invertPose(truth[target]) * truth[source];
+        acq::CloudIndex const index(clouds[target]);
+        acq::CorrespondenceStats const stats = acq::measureCorrespondences(clouds[source], index, relative, params);
+        if (stats.matched != stats.sampled) {
+            std::cerr << "Edge " << source << " -> " << target << " matched " << stats.matched << " of " << stats.sampled << " points\n";
+            return EXIT_FAILURE;
+        }
+
+        acq::PoseGraph::Vector6 z;
+        for (int i = 0; i != 6; ++i)
+            z(i) = normal(generator);
+        Eigen::LLT<acq::InformationT> const llt(stats.information);
+        acq::PoseGraph::Vector6 const xi = noise * extent * llt.matrixU().solve(z);
+        acq::PoseT const measurement = relative * makePose(xi);
+        graph.addEdge(source, target, measurement, stats.information);
+        if (target)
+            chain.push_back(chain.back() * acq::invertPose(measurement));
+    }
+    for (int nodeId = 0; nodeId != nNodes; ++nodeId)
+        graph.setPose(nodeId, chain[nodeId]);
+
+    double const chi2Before = graph.getChiSquared();
+    double pointErrorBefore = 0.;
+    for (int nodeId = 0; nodeId != nNodes; ++nodeId)
+        pointErrorBefore += getPointError(clouds[nodeId], chain[nodeId], truth[nodeId]) / nNodes;
+
+    int const iterations = graph.optimize();
+
+    double const chi2After = graph.getChiSquared();
+    double pointErrorAfter = 0.;
+    for (int nodeId = 0; nodeId != nNodes; ++nodeId)
+        pointErrorAfter += getPointError(clouds[nodeId], graph.getPoses()[nodeId], truth[nodeId]) / nNodes;
+
+    std::cout << world.rows() << " points, " << nNodes << " nodes, " << iterations << " iterations\n"
+              << "chi2:        " << chi2Before << " -> " << chi2After << "\n"
+              << "point error: " << pointErrorBefore / extent << " -> " << pointErrorAfter / extent
+              << " (relative to the extent)" << std::endl;
+
+    if (!(chi2After < chi2Before) || !(pointErrorAfter < pointErrorBefore)) {
+        std::cerr << "Optimizing the loop did not reduce its error\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+} //...main()
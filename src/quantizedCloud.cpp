@@ -0,0 +1,201 @@
+#include "acq/quantizedCloud.h"
+
+#include "new_nanoflann/nanoflann.hpp" // Nearest neighbour lookup in a pointcloud
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+namespace acq {
+
+namespace {
+    //! Largest octahedral coordinate code, even, so the axes are encoded exactly.
+    double const NORMAL_LEVELS = 65534.;
+
+    /** \brief Sign, with +1 for 0. */
+    inline double signNotZero(double const value) { return value < 0. ? -1. : 1.; }
+
+    /** \brief Octahedral coordinates in [-1, 1]^2 of the unit vector \p normal. */
+    inline Eigen::Vector2d toOctahedron(Eigen::Vector3d const& normal) {
+        double const l1 = normal.cwiseAbs().sum();
+        if (l1 <= 0.)
+            return Eigen::Vector2d::Zero();
+        Eigen::Vector2d oct = normal.head<2>() / l1;
+        // Fold the lower hemisphere over the diagonals
+        if (normal(2) < 0.)
+            oct = Eigen::Vector2d((1. - std::abs(oct(1))) * signNotZero(oct(0)),
+                                  (1. - std::abs(oct(0))) * signNotZero(oct(1)));
+        return oct;
+    } //...toOctahedron()
+
+    /** \brief 32 bit code of the grid coordinates \p u and \p v. */
+    inline uint32_t packNormal(uint32_t const u, uint32_t const v) { return u | v << 16; }
+} //...ns anonymous
+
+QuantizedCloud::QuantizedCloud()
+    : _nPoints(0), _bits(16), _min(Eigen::Vector3d::Zero()), _step(Eigen::Vector3d::Zero())
+{}
+
+QuantizedCloud::QuantizedCloud(CloudT const& cloud, NormalsT const& normals, int const bits)
+    : _nPoints(static_cast<size_t>(cloud.rows())), _bits(bits),
+      _min(Eigen::Vector3d::Zero()), _step(Eigen::Vector3d::Zero())
+{
+    if ((bits != 16 && bits != 21) || (cloud.rows() && cloud.cols() != 3)
+        || (normals.size() && (normals.rows() != cloud.rows() || normals.cols() != 3))) {
+        std::cerr << "[QuantizedCloud::QuantizedCloud] Expected 16 or 21 bits, N x 3 points and normals, got "
+                  << bits << " bits, " << cloud.rows() << " x " << cloud.cols() << " points and "
+                  << normals.rows() << " x " << normals.cols() << " normals\n";
+        throw new std::runtime_error("Invalid quantization input");
+    }
+    if (!_nPoints)
+        return;
+
+    // Grid spanning the bounding box, a flat axis keeps step 0
+    double const levels = static_cast<double>((uint64_t(1) << bits) - 1);
+    _min = cloud.colwise().minCoeff().transpose();
+    _step = (cloud.colwise().maxCoeff().transpose() - _min) / levels;
+    Eigen::Vector3d const scale = (_step.array() > 0.).select(_step.cwiseInverse(), Eigen::Vector3d::Zero());
+
+    if (bits == 16)
+        _codes16.resize(3 * _nPoints);
+    else
+        _codes21.resize(_nPoints);
+    for (size_t pointId = 0; pointId != _nPoints; ++pointId) {
+        uint64_t packed = 0;
+        for (int dim = 0; dim != 3; ++dim) {
+            double const code = std::min(std::max(std::round((cloud(pointId, dim) - _min(dim)) * scale(dim)), 0.), levels);
+            if (bits == 16)
+                _codes16[3 * pointId + dim] = static_cast<uint16_t>(code);
+            else
+                packed |= static_cast<uint64_t>(code) << (21 * dim);
+        }
+        if (bits == 21)
+            _codes21[pointId] = packed;
+    } //...for points
+
+    if (normals.size()) {
+        _normals.resize(_nPoints);
+        for (size_t pointId = 0; pointId != _nPoints; ++pointId)
+            _normals[pointId] = encodeNormal(normals.row(pointId).transpose());
+    }
+} //...QuantizedCloud::QuantizedCloud()
+
+CloudT QuantizedCloud::getVertices() const {
+    CloudT vertices(_nPoints, 3);
+    for (size_t pointId = 0; pointId != _nPoints; ++pointId)
+        vertices.row(pointId) = row(pointId);
+    return vertices;
+} //...QuantizedCloud::getVertices()
+
+NormalsT QuantizedCloud::getNormals() const {
+    NormalsT normals(_normals.size(), 3);
+    for (size_t pointId = 0; pointId != _normals.size(); ++pointId)
+        normals.row(pointId) = decodeNormal(_normals[pointId]).transpose();
+    return normals;
+} //...QuantizedCloud::getNormals()
+
+size_t QuantizedCloud::getBytes() const {
+    return _codes16.size() * sizeof(uint16_t) + _codes21.size() * sizeof(uint64_t)
+           + _normals.size() * sizeof(uint32_t);
+} //...QuantizedCloud::getBytes()
+
+uint32_t QuantizedCloud::encodeNormal(Eigen::Vector3d const& normal) {
+    Eigen::Vector2d const grid = (toOctahedron(normal).array() * 0.5 + 0.5).matrix() * NORMAL_LEVELS;
+    Eigen::Vector3d const unit = normal.normalized();
+
+    // Rounding the coordinates separately is not always closest on the sphere, try all four neighbours
+    uint32_t best     = packNormal(0, 0);
+    double   bestDot  = -std::numeric_limits<double>::max();
+    for (int corner = 0; corner != 4; ++corner) {
+        double const u = corner & 1 ? std::ceil(grid(0)) : std::floor(grid(0));
+        double const v = corner & 2 ? std::ceil(grid(1)) : std::floor(grid(1));
+        uint32_t const code = packNormal(static_cast<uint32_t>(std::min(std::max(u, 0.), NORMAL_LEVELS)),
+                                         static_cast<uint32_t>(std::min(std::max(v, 0.), NORMAL_LEVELS)));
+        double const dot = decodeNormal(code).dot(unit);
+        if (dot > bestDot) {
+            bestDot = dot;
+            best    = code;
+        }
+    }
+    return best;
+} //...QuantizedCloud::encodeNormal()
+
+Eigen::Vector3d QuantizedCloud::decodeNormal(uint32_t const code) {
+    double const x = (code & 0xFFFF) / NORMAL_LEVELS * 2. - 1.;
+    double const y = (code >> 16)    / NORMAL_LEVELS * 2. - 1.;
+    double const z = 1. - std::abs(x) - std::abs(y);
+    // Unfold the lower hemisphere
+    Eigen::Vector3d normal = z >= 0. ? Eigen::Vector3d(x, y, z)
+                                     : Eigen::Vector3d((1. - std::abs(y)) * signNotZero(x),
+                                                       (1. - std::abs(x)) * signNotZero(y), z);
+    return normal.normalized();
+} //...QuantizedCloud::decodeNormal()
+
+/** \brief nanoflann dataset adaptor and tree decoding a \ref QuantizedCloud. */
+struct QuantizedIndex::Tree {
+    //! Point dimensions
+    enum { Dim = 3 };
+    //! KD-tree type
+    typedef nanoflann::KDTreeSingleIndexAdaptor<
+        /* Distance metric: */ nanoflann::L2_Simple_Adaptor<double, Tree>,
+        /* Dataset adaptor: */ Tree,
+        /*  Dimensionality: */ Dim,
+        /*      Index type: */ size_t
+    > KdTreeT;
+
+    Tree(QuantizedCloud const& cloud, int const maxLeafs)
+        : _cloud(cloud),
+          _index(Dim, *this, nanoflann::KDTreeSingleIndexAdaptorParams(maxLeafs))
+    {
+        _index.buildIndex();
+    }
+
+    // nanoflann dataset interface
+    size_t kdtree_get_point_count() const { return static_cast<size_t>(_cloud.rows()); }
+    double kdtree_get_pt(size_t const idx, int const dim) const { return _cloud.coeff(idx, dim); }
+    template <class BBOX> bool kdtree_get_bbox(BBOX&) const { return false; }
+
+    QuantizedCloud const& _cloud; //!< Owned by the caller of \ref QuantizedIndex.
+    KdTreeT               _index; //!< The tree, has to be initialized after \ref _cloud.
+}; //...struct QuantizedIndex::Tree
+
+QuantizedIndex::QuantizedIndex(QuantizedCloud const& cloud, int const maxLeafs)
+    : _cloud(cloud), _tree(new Tree(cloud, maxLeafs))
+{}
+
+QuantizedIndex::~QuantizedIndex() {}
+
+bool QuantizedIndex::findNearest(Eigen::Vector3d const& query, size_t &pointId, double &distSqr) const {
+    if (!_cloud.rows())
+        return false;
+
+    nanoflann::KNNResultSet<double, size_t> resultSet(1);
+    resultSet.init(&pointId, &distSqr);
+    _tree->_index.findNeighbors(resultSet, query.data(), nanoflann::SearchParams());
+    return true;
+} //...QuantizedIndex::findNearest()
+
+size_t QuantizedIndex::findNeighbours(
+    Eigen::Vector3d     const& query,
+    size_t              const  k,
+    std::vector<size_t>      & pointIds,
+    std::vector<double>      & distsSqr
+) const {
+    pointIds.resize(k);
+    distsSqr.resize(k);
+    if (!k || !_cloud.rows())
+        return 0;
+
+    nanoflann::KNNResultSet<double, size_t> resultSet(k);
+    resultSet.init(&pointIds[0], &distsSqr[0]);
+    _tree->_index.findNeighbors(resultSet, query.data(), nanoflann::SearchParams());
+
+    // Trim, if fewer points than requested
+    size_t const found = resultSet.size();
+    pointIds.resize(found);
+    distsSqr.resize(found);
+    return found;
+} //...QuantizedIndex::findNeighbours()
+
+} //...ns acq
@@ -0,0 +1,167 @@
+#include "acq/registrationCache.h"
+
+#include "acq/impl/hash.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#   include <direct.h>
+#else
+#   include <sys/stat.h>
+#endif
+
+namespace acq {
+
+namespace {
+    //! Identifies cache files, bump the version whenever the layout changes.
+    char     const FILE_MAGIC[4]     = { 'A', 'C', 'Q', 'R' };
+    uint32_t const FILE_VERSION      = 1;
+    //! Part of every key, bump whenever alignPointToPoint() computes other results for the same inputs.
+    uint32_t const ALGORITHM_VERSION = 1;
+
+    /** \brief Fixed-size record stored per key. */
+    struct Record {
+        char     magic[4];
+        uint32_t version;
+        HashT    key;
+        double   pose[16];
+        double   meanSqrError; // IcpResult::error
+        int64_t  iterations;
+        int64_t  correspondences;
+    }; //...struct Record
+} //...ns anonymous
+
+RegistrationCache::RegistrationCache(std::string const& directory, size_t const capacity)
+    : _directory(directory), _capacity(capacity), _hits(0), _misses(0)
+{
+    if (_directory.empty())
+        return;
+#ifdef _WIN32
+    _mkdir(_directory.c_str());
+#else
+    mkdir(_directory.c_str(), 0755);
+#endif
+} //...RegistrationCache::RegistrationCache()
+
+HashT RegistrationCache::makeKey(
+    HashT     const  sourceHash,
+    HashT     const  targetHash,
+    PoseT     const& initialPose,
+    IcpParams const& params
+) {
+    HashT key = hashValue(ALGORITHM_VERSION);
+    key = hashValue(sourceHash, key);
+    key = hashValue(targetHash, key);
+    key = hashMatrix(initialPose, key);
+    key = hashValue(params.maxIterations, key);
+    key = hashValue(params.stepSize, key);
+    key = hashValue(params.maxDistSqr, key);
+    key = hashValue(params.minError, key);
+    key = hashValue(params.minImprovement, key);
+    return key;
+} //...RegistrationCache::makeKey()
+
+std::string RegistrationCache::getPath(HashT const key) const {
+    std::ostringstream path;
+    path << _directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".icp";
+    return path.str();
+} //...RegistrationCache::getPath()
+
+void RegistrationCache::remember(HashT const key, IcpResult const& result) {
+    auto const it = _entries.find(key);
+    if (it != _entries.end())
+        _lru.erase(it->second);
+    _lru.push_front(std::make_pair(key, result));
+    _entries[key] = _lru.begin();
+
+    while (_lru.size() > _capacity) {
+        _entries.erase(_lru.back().first);
+        _lru.pop_back();
+    }
+} //...RegistrationCache::remember()
+
+bool RegistrationCache::find(HashT const key, IcpResult &result) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto const it = _entries.find(key);
+        if (it != _entries.end()) {
+            result = it->second->second;
+            _lru.splice(_lru.begin(), _lru, it->second);
+            ++_hits;
+            return true;
+        }
+    }
+
+    // Disk tier, read without holding the lock
+    Record record;
+    bool   found = false;
+    if (!_directory.empty()) {
+        std::ifstream file(getPath(key), std::ios::binary);
+        found = file.read(reinterpret_cast<char*>(&record), sizeof(Record))
+                && std::equal(FILE_MAGIC, FILE_MAGIC + 4, record.magic)
+                && record.version == FILE_VERSION
+                && record.key == key;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!found) {
+        ++_misses;
+        return false;
+    }
+
+    result.pose            = Eigen::Map<PoseT const>(record.pose);
+    result.error           = record.meanSqrError;
+    result.iterations      = static_cast<int>(record.iterations);
+    result.correspondences = static_cast<size_t>(record.correspondences);
+    remember(key, result);
+    ++_hits;
+    return true;
+} //...RegistrationCache::find()
+
+void RegistrationCache::insert(HashT const key, IcpResult const& result) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        remember(key, result);
+    }
+    if (_directory.empty())
+        return;
+
+    Record record;
+    std::copy(FILE_MAGIC, FILE_MAGIC + 4, record.magic);
+    record.version         = FILE_VERSION;
+    record.key             = key;
+    record.meanSqrError    = result.error;
+    record.iterations      = result.iterations;
+    record.correspondences = static_cast<int64_t>(result.correspondences);
+    Eigen::Map<PoseT>(record.pose) = result.pose;
+
+    // Write aside and rename, so readers never see half a record
+    std::string const path = getPath(key);
+    std::ostringstream tmpPath;
+    tmpPath << path << "." << std::this_thread::get_id() << ".tmp";
+    {
+        std::ofstream file(tmpPath.str(), std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<char const*>(&record), sizeof(Record))) {
+            std::cerr << "[RegistrationCache::insert] Could not write " << tmpPath.str() << "\n";
+            return;
+        }
+    }
+    if (std::rename(tmpPath.str().c_str(), path.c_str())) {
+        std::cerr << "[RegistrationCache::insert] Could not rename " << tmpPath.str() << " to " << path << "\n";
+        std::remove(tmpPath.str().c_str());
+    }
+} //...RegistrationCache::insert()
+
+void RegistrationCache::clearMemory() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _lru.clear();
+    _entries.clear();
+} //...RegistrationCache::clearMemory()
+
+} //...ns acq
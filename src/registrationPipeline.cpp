@@ -0,0 +1,682 @@
+#include "acq/registrationPipeline.h"
+
+#include "acq/cloudIndex.h"
+#include "acq/indexCache.h"
+#include "acq/modelAccumulator.h"
+#include "acq/registrationCache.h"
+#include "acq/impl/hash.hpp"
+#include "acq/impl/icp.hpp"
+#include "acq/impl/overlap.hpp"
+#include "acq/impl/parallel.hpp"
+
+#include "Eigen/LU"    // inverse()
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace acq {
+
+RegistrationPipeline::RegistrationPipeline(IcpParams const& params)
+    : _params(params), _strategy(SEQUENTIAL), _reference(0), _voxelSize(0.), _cache(nullptr), _indexCache(nullptr)
+{}
+
+RegistrationPipeline::~RegistrationPipeline() {}
+
+int RegistrationPipeline::addScan(DecoratedCloud const& scan, PoseT const& initialPose) {
+    _scans.push_back(&scan);
+    _initial.push_back(initialPose);
+    return static_cast<int>(_scans.size()) - 1;
+} //...RegistrationPipeline::addScan()
+
+void RegistrationPipeline::setPairing(PairingStrategy const strategy, int const reference) {
+    _strategy  = strategy;
+    _reference = reference;
+} //...RegistrationPipeline::setPairing()
+
+void RegistrationPipeline::setSpanningTree(std::vector<int> const& parents) {
+    _strategy = SPANNING_TREE;
+    _parents  = parents;
+} //...RegistrationPipeline::setSpanningTree()
+
+std::vector<int> RegistrationPipeline::getParents() const {
+    int const nScans = getScanCount();
+    if (_strategy == SPANNING_TREE || _strategy == MAX_OVERLAP)
+        return _parents;
+
+    std::vector<int> parents(nScans, -1);
+    for (int scanId = 0; scanId != nScans; ++scanId) {
+        if (scanId == _reference)
+            continue;
+        if (_strategy == STAR || _strategy == INCREMENTAL)
+            parents[scanId] = _reference;
+        else // SEQUENTIAL: step towards the reference
+            parents[scanId] = scanId < _reference ? scanId + 1 : scanId - 1;
+    } //...for scans
+
+    return parents;
+} //...RegistrationPipeline::getParents()
+
+PosesT RegistrationPipeline::run(unsigned const nThreads) {
+    typedef std::chrono::steady_clock ClockT;
+
+    if (_strategy == INCREMENTAL)
+        return runIncremental();
+
+    int const nScans = getScanCount();
+    refreshScans(nThreads);
+    if (_strategy == MAX_OVERLAP) {
+        // Strongest overlaps at the initial guesses decide the pairs
+        _parents = computeMaxSpanningTree(measureOverlaps(_initial, _overlapParams, nThreads), _reference);
+        for (int scanId = 0; scanId != nScans; ++scanId) {
+            if (scanId != _reference && _parents[scanId] == -1) {
+                std::cerr << "[RegistrationPipeline::run] Scan " << scanId
+                          << " does not overlap any other, aligning to the reference\n";
+                _parents[scanId] = _reference;
+            }
+        }
+    } //...if MAX_OVERLAP
+
+    std::vector<int> const parents = getParents();
+
+    // Check, that the pairs form a tree
+    if (static_cast<int>(parents.size()) != nScans) {
+        std::cerr << "[RegistrationPipeline::run] Expected " << nScans
+                  << " parents, got " << parents.size() << "\n";
+        throw new std::runtime_error("Invalid pairing");
+    }
+    for (int scanId = 0; scanId != nScans; ++scanId) {
+        int ancestor = scanId, depth = 0;
+        while (ancestor != -1 && depth <= nScans) {
+            if (ancestor < -1 || ancestor >= nScans) {
+                std::cerr << "[RegistrationPipeline::run] Invalid parent " << ancestor
+                          << " on path of scan " << scanId << "\n";
+                throw new std::runtime_error("Invalid pairing");
+            }
+            ancestor = parents[ancestor];
+            ++depth;
+        }
+        if (ancestor != -1) {
+            std::cerr << "[RegistrationPipeline::run] Scan " << scanId
+                      << " is part of a cycle\n";
+            throw new std::runtime_error("Invalid pairing");
+        }
+    } //...for scans
+
+    // List pairs, answering unchanged ones from the cache
+    _pairResults.clear();
+    std::vector<HashT> keys;
+    for (int scanId = 0; scanId != nScans; ++scanId) {
+        if (parents[scanId] == -1)
+            continue;
+        PairResult pair;
+        pair.source = scanId;
+        pair.target = parents[scanId];
+        pair.time   = 0.;
+        pair.cached = false;
+        if (_cache) {
+            keys.push_back(RegistrationCache::makeKey(
+                _hashes[pair.source], _hashes[pair.target],
+                PoseT(_initial[pair.target].inverse() * _initial[pair.source]), _params));
+            pair.cached = _cache->find(keys.back(), pair.icp);
+        }
+        _pairResults.push_back(pair);
+    }
+
+    // Index every target, and align each pair as soon as its target is indexed
+    _indices.resize(nScans);
+    _tasks.clear();
+    std::vector<TaskGraph::TaskId> indexTasks(nScans);
+    std::vector<char>              indexed(nScans, 0);
+    for (PairResult const& pair : _pairResults) {
+        int const target = pair.target;
+        if (pair.cached || indexed[target])
+            continue;
+        indexed[target]    = 1;
+        indexTasks[target] = _tasks.addTask("index " + std::to_string(target), [this, target]() {
+            if (!_indices[target])
+                _indices[target] = makeIndex(target);
+        });
+    } //...for targets
+
+    for (size_t pairId = 0; pairId != _pairResults.size(); ++pairId) {
+        PairResult const& pair = _pairResults[pairId];
+        if (pair.cached)
+            continue;
+        TaskGraph::TaskId const alignTask = _tasks.addTask(
+            "align " + std::to_string(pair.source) + " -> " + std::to_string(pair.target),
+            [this, pairId, &keys]() {
+                PairResult &pair = _pairResults[pairId];
+                ClockT::time_point const start = ClockT::now();
+                pair.icp = alignPointToPoint(
+                    /*      Moving points: */ _scans[pair.source]->getVertices(),
+                    /*       Fixed points: */ *_indices[pair.target],
+                    /* Relative pose guess: */ PoseT(_initial[pair.target].inverse() * _initial[pair.source]),
+                    /*           Settings: */ _params);
+                pair.time = std::chrono::duration<double>(ClockT::now() - start).count();
+                if (_cache)
+                    _cache->insert(keys[pairId], pair.icp);
+            });
+        _tasks.addDependency(indexTasks[pair.target], alignTask);
+    } //...for pairs
+
+    _tasks.run(nThreads);
+
+    // Compose world poses along the tree
+    std::vector<PoseT const*> relative(nScans, nullptr);
+    for (PairResult const& pair : _pairResults)
+        relative[pair.source] = &pair.icp.pose;
+
+    PosesT           poses(nScans, PoseT::Identity());
+    std::vector<int> resolved(nScans, 0);
+    for (int scanId = 0; scanId != nScans; ++scanId) {
+        // Collect unresolved ancestors
+        std::vector<int> path;
+        for (int ancestor = scanId; ancestor != -1 && !resolved[ancestor]; ancestor = parents[ancestor])
+            path.push_back(ancestor);
+        // Resolve from the top
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            int const id = *it;
+            if (parents[id] == -1)
+                poses[id] = _initial[id];
+            else
+                poses[id] = poses[parents[id]] * (*relative[id]);
+            resolved[id] = 1;
+        }
+    } //...for scans
+
+    return poses;
+} //...RegistrationPipeline::run()
+
+PosesT RegistrationPipeline::runIncremental() {
+    typedef std::chrono::steady_clock ClockT;
+
+    int const nScans = getScanCount();
+    if (_reference < 0 || _reference >= nScans) {
+        std::cerr << "[RegistrationPipeline::runIncremental] Invalid reference " << _reference
+                  << " for " << nScans << " scans\n";
+        throw new std::runtime_error("Invalid pairing");
+    }
+
+    // The reference seeds the model at its initial pose
+    PosesT poses(_initial);
+    _model.reset(new ModelAccumulator(_voxelSize));
+    ModelAccumulator &model = *_model;
+    model.addScan(_scans[_reference]->getVertices(), _scans[_reference]->getNormals(), poses[_reference]);
+
+    _pairResults.clear();
+    for (int scanId = 0; scanId != nScans; ++scanId) {
+        if (scanId == _reference)
+            continue;
+
+        PairResult pair;
+        pair.source = scanId;
+        pair.target = -1;
+        pair.cached = false;
+
+        ClockT::time_point const start = ClockT::now();
+        pair.icp = alignPointToPoint(
+            /*    Moving points: */ _scans[scanId]->getVertices(),
+            /*     Model so far: */ model,
+            /* World pose guess: */ _initial[scanId],
+            /*         Settings: */ _params);
+        poses[scanId] = pair.icp.pose;
+
+        // Only the new scan is indexed
+        model.addScan(_scans[scanId]->getVertices(), _scans[scanId]->getNormals(), poses[scanId]);
+        pair.time = std::chrono::duration<double>(ClockT::now() - start).count();
+
+        _pairResults.push_back(pair);
+    } //...for scans
+
+    return poses;
+} //...RegistrationPipeline::runIncremental()
+
+void RegistrationPipeline::buildIndices(std::vector<int> const& scanIds, unsigned const nThreads) {
+    _indices.resize(_scans.size());
+
+    std::vector<int> missing;
+    for (int const scanId : scanIds)
+        if (!_indices.at(scanId))
+            missing.push_back(scanId);
+
+    parallelFor(missing.size(), [&](size_t const i) {
+        _indices[missing[i]] = makeIndex(missing[i]);
+    }, 1, nThreads);
+} //...RegistrationPipeline::buildIndices()
+
+std::unique_ptr<CloudIndex> RegistrationPipeline::makeIndex(int const scanId) const {
+    CloudT const& vertices = _scans[scanId]->getVertices();
+    if (!_indexCache)
+        return std::unique_ptr<CloudIndex>(new CloudIndex(vertices));
+    return _indexCache->getIndex(CloudIndex::PointsT(vertices.data(), vertices.rows(), vertices.cols()), _hashes[scanId]);
+} //...RegistrationPipeline::makeIndex()
+
+Eigen::MatrixXd RegistrationPipeline::estimateOverlaps(
+    PosesT        const& poses,
+    OverlapParams const& params,
+    unsigned      const  nThreads
+) {
+    refreshScans(nThreads);
+    return measureOverlaps(poses, params, nThreads);
+} //...RegistrationPipeline::estimateOverlaps()
+
+Eigen::MatrixXd RegistrationPipeline::measureOverlaps(
+    PosesT        const& poses,
+    OverlapParams const& params,
+    unsigned      const  nThreads
+) {
+    int const nScans = getScanCount();
+    if (static_cast<int>(poses.size()) != nScans) {
+        std::cerr << "[RegistrationPipeline::estimateOverlaps] Expected " << nScans
+                  << " poses, got " << poses.size() << "\n";
+        throw new std::runtime_error("Scan and pose count mismatch");
+    }
+
+    // Boxes are cheap, but only computed once per scan
+    if (static_cast<int>(_boxes.size()) != nScans) {
+        _boxes.resize(nScans);
+        parallelFor(nScans, [&](size_t const scanId) {
+            _boxes[scanId] = computeOrientedBox(_scans[scanId]->getVertices());
+        }, 1, nThreads);
+    }
+
+    // Candidates: pairs with intersecting boxes
+    double const margin = std::sqrt(params.maxDistSqr) + params.boxMargin;
+    std::vector<std::pair<int, int> > pairs;
+    for (int first = 0; first != nScans; ++first)
+        for (int second = first + 1; second != nScans; ++second)
+            if (intersects(transformBox(_boxes[first], poses[first]),
+                           transformBox(_boxes[second], poses[second]),
+                           margin))
+                pairs.push_back(std::make_pair(first, second));
+
+    // Indices of the candidates only
+    std::vector<int> scanIds;
+    for (std::pair<int, int> const& pair : pairs) {
+        scanIds.push_back(pair.first);
+        scanIds.push_back(pair.second);
+    }
+    std::sort(scanIds.begin(), scanIds.end());
+    scanIds.erase(std::unique(scanIds.begin(), scanIds.end()), scanIds.end());
+    buildIndices(scanIds, nThreads);
+
+    Eigen::MatrixXd overlaps(Eigen::MatrixXd::Zero(nScans, nScans));
+    parallelFor(pairs.size(), [&](size_t const pairId) {
+        int const first  = pairs[pairId].first;
+        int const second = pairs[pairId].second;
+        PoseT const firstToSecond = invertPose(poses[second]) * poses[first];
+
+        double const overlap = 0.5 * (
+            estimateOverlap(_scans[first ]->getVertices(), *_indices[second], firstToSecond, params) +
+            estimateOverlap(_scans[second]->getVertices(), *_indices[first ], invertPose(firstToSecond), params));
+        overlaps(first, second) = overlaps(second, first) = overlap;
+    }, 1, nThreads);
+
+    return overlaps;
+} //...RegistrationPipeline::measureOverlaps()
+
+int RegistrationPipeline::getRoot() const {
+    if (_strategy != SPANNING_TREE)
+        return _reference;
+    for (size_t scanId = 0; scanId != _parents.size(); ++scanId)
+        if (_parents[scanId] == -1)
+            return static_cast<int>(scanId);
+    return 0;
+} //...RegistrationPipeline::getRoot()
+
+void RegistrationPipeline::refreshScans(unsigned const nThreads) {
+    int const nScans = getScanCount();
+    std::vector<HashT> hashes(nScans);
+    parallelFor(nScans, [&](size_t const scanId) {
+        hashes[scanId] = hashMatrix(_scans[scanId]->getVertices());
+    }, 1, nThreads);
+
+    // Whatever was derived from other points is dropped, or redone right away where it is cheap
+    _indices.resize(nScans);
+    for (int scanId = 0; scanId != nScans; ++scanId) {
+        if (scanId < static_cast<int>(_hashes.size()) && _hashes[scanId] == hashes[scanId])
+            continue;
+        _indices[scanId].reset();
+        if (static_cast<int>(_boxes.size()) == nScans)
+            _boxes[scanId] = computeOrientedBox(_scans[scanId]->getVertices());
+        if (static_cast<int>(_descriptors.size()) == nScans)
+            _descriptors[scanId] = computeGlobalDescriptor(_scans[scanId]->getVertices());
+    }
+    _hashes.swap(hashes);
+} //...RegistrationPipeline::refreshScans()
+
+IcpResult RegistrationPipeline::alignPair(
+    int       const  source,
+    int       const  target,
+    PoseT     const& guess,
+    IcpParams const& params
+) const {
+    HashT     key = 0;
+    IcpResult result;
+    if (_cache) {
+        key = RegistrationCache::makeKey(_hashes.at(source), _hashes.at(target), guess, params);
+        if (_cache->find(key, result))
+            return result;
+    }
+
+    result = alignPointToPoint(_scans[source]->getVertices(), *_indices[target], guess, params);
+    if (_cache)
+        _cache->insert(key, result);
+    return result;
+} //...RegistrationPipeline::alignPair()
+
+CorrespondenceStats RegistrationPipeline::verifyPair(
+    int    const  source,
+    int    const  target,
+    PoseT       & relative,
+    int    const  icpIterations,
+    double const  maxDistSqr
+) const {
+    if (icpIterations > 0) {
+        IcpParams icpParams(_params);
+        icpParams.maxIterations = icpIterations;
+        relative = alignPair(source, target, relative, icpParams).pose;
+    }
+
+    IcpParams overlapParams(_params);
+    overlapParams.maxDistSqr = maxDistSqr;
+    return measureCorrespondences(_scans[source]->getVertices(), *_indices[target], relative, overlapParams);
+} //...RegistrationPipeline::verifyPair()
+
+void RegistrationPipeline::addGraphEdges(
+    std::vector<std::pair<int, int> > const& pairs,
+    RefineParams                      const& params,
+    unsigned                          const  nThreads
+) {
+    PosesT const& poses = _graph.getPoses();
+
+    // Polish and measure every pair independently
+    std::vector<PoseGraph::Edge, Eigen::aligned_allocator<PoseGraph::Edge> > edges(pairs.size());
+    std::vector<char> overlapping(pairs.size(), 0);
+    parallelFor(pairs.size(), [&](size_t const pairId) {
+        int const source = pairs[pairId].first;
+        int const target = pairs[pairId].second;
+
+        PoseT relative = invertPose(poses[target]) * poses[source];
+        CorrespondenceStats const stats =
+            verifyPair(source, target, relative, params.icpIterations, params.maxDistSqr);
+        if (stats.getOverlap() < params.minOverlap)
+            return;
+
+        edges[pairId].source      = source;
+        edges[pairId].target      = target;
+        edges[pairId].measurement = relative;
+        edges[pairId].information = stats.information;
+        overlapping[pairId]       = 1;
+    }, 1, nThreads);
+
+    for (size_t pairId = 0; pairId != pairs.size(); ++pairId)
+        if (overlapping[pairId])
+            _graph.addEdge(edges[pairId].source, edges[pairId].target,
+                           edges[pairId].measurement, edges[pairId].information);
+} //...RegistrationPipeline::addGraphEdges()
+
+PosesT RegistrationPipeline::refine(PosesT const& poses, RefineParams const& params, unsigned const nThreads) {
+    int const nScans = getScanCount();
+    if (static_cast<int>(poses.size()) != nScans) {
+        std::cerr << "[RegistrationPipeline::refine] Expected " << nScans
+                  << " poses, got " << poses.size() << "\n";
+        throw new std::runtime_error("Scan and pose count mismatch");
+    }
+    refreshScans(nThreads);
+
+    _graph = PoseGraph();
+    for (PoseT const& pose : poses)
+        _graph.addNode(pose);
+    _graph.setFixed(getRoot());
+
+    // Cheap overlap estimates decide which pairs are worth polishing
+    OverlapParams overlapParams(_overlapParams);
+    overlapParams.maxDistSqr = params.maxDistSqr;
+    Eigen::MatrixXd const overlaps = measureOverlaps(poses, overlapParams, nThreads);
+
+    // Candidate pairs, one direction each
+    std::vector<std::pair<int, int> > pairs;
+    for (int source = 0; source != nScans; ++source)
+        for (int target = source + 1; target != nScans; ++target)
+            if (overlaps(source, target) >= 0.5 * params.minOverlap)
+                pairs.push_back(std::make_pair(source, target));
+    addGraphEdges(pairs, params, nThreads);
+
+    _graph.optimize(params.graphIterations);
+    return _graph.getPoses();
+} //...RegistrationPipeline::refine()
+
+PosesT RegistrationPipeline::refineScan(int const scanId, RefineParams const& params, unsigned const nThreads) {
+    int const nScans = getScanCount();
+    if (static_cast<int>(_graph.getPoses().size()) != nScans || scanId < 0 || scanId >= nScans) {
+        std::cerr << "[RegistrationPipeline::refineScan] Call refine() first, and with a valid scan id ("
+                  << scanId << ")\n";
+        throw new std::runtime_error("No pose graph to update");
+    }
+
+    // The changed scan gets a fresh hash, index, box and descriptor
+    refreshScans(nThreads);
+    buildIndices(std::vector<int>(1, scanId), nThreads);
+
+    // Keep the edges not involving the scan
+    PoseGraph::EdgesT const edges = _graph.getEdges();
+    _graph.clearEdges();
+    for (PoseGraph::Edge const& edge : edges)
+        if (edge.source != scanId && edge.target != scanId)
+            _graph.addEdge(edge.source, edge.target, edge.measurement, edge.information);
+
+    // Re-measure the overlapping pairs of the scan
+    OverlapParams overlapParams(_overlapParams);
+    overlapParams.maxDistSqr = params.maxDistSqr;
+    Eigen::MatrixXd const overlaps = measureOverlaps(_graph.getPoses(), overlapParams, nThreads);
+
+    std::vector<std::pair<int, int> > pairs;
+    for (int otherId = 0; otherId != nScans; ++otherId)
+        if (otherId != scanId && overlaps(scanId, otherId) >= 0.5 * params.minOverlap)
+            pairs.push_back(std::make_pair(std::min(scanId, otherId), std::max(scanId, otherId)));
+    addGraphEdges(pairs, params, nThreads);
+
+    _graph.optimize(params.graphIterations);
+    return _graph.getPoses();
+} //...RegistrationPipeline::refineScan()
+
+PosesT RegistrationPipeline::closeLoops(PosesT const& poses, LoopClosureParams const& params, unsigned const nThreads) {
+    int const nScans = getScanCount();
+    if (static_cast<int>(poses.size()) != nScans) {
+        std::cerr << "[RegistrationPipeline::closeLoops] Expected " << nScans
+                  << " poses, got " << poses.size() << "\n";
+        throw new std::runtime_error("Scan and pose count mismatch");
+    }
+    refreshScans(nThreads);
+
+    // Continue the graph of refine(), or start from the registration tree
+    if (static_cast<int>(_graph.getPoses().size()) == nScans) {
+        for (int scanId = 0; scanId != nScans; ++scanId)
+            _graph.setPose(scanId, poses[scanId]);
+    } else {
+        _graph = PoseGraph();
+        for (PoseT const& pose : poses)
+            _graph.addNode(pose);
+        _graph.setFixed(getRoot());
+
+        std::vector<int> const parents = getParents();
+        std::vector<std::pair<int, int> > treePairs;
+        for (int scanId = 0; scanId != nScans; ++scanId)
+            if (parents[scanId] != -1)
+                treePairs.push_back(std::make_pair(scanId, parents[scanId]));
+        std::vector<int> targets(parents);
+        targets.erase(std::remove(targets.begin(), targets.end(), -1), targets.end());
+        buildIndices(targets, nThreads);
+
+        // Tree edges keep the graph connected, so they are added whatever their overlap
+        std::vector<CorrespondenceStats> stats(treePairs.size());
+        parallelFor(treePairs.size(), [&](size_t const pairId) {
+            PoseT relative = invertPose(poses[treePairs[pairId].second]) * poses[treePairs[pairId].first];
+            stats[pairId]  = verifyPair(treePairs[pairId].first, treePairs[pairId].second,
+                                        relative, /* icpIterations: */ 0, params.maxDistSqr);
+        }, 1, nThreads);
+        for (size_t pairId = 0; pairId != treePairs.size(); ++pairId)
+            if (stats[pairId].matched)
+                _graph.addEdge(treePairs[pairId].first, treePairs[pairId].second,
+                               invertPose(poses[treePairs[pairId].second]) * poses[treePairs[pairId].first],
+                               stats[pairId].information);
+    } //...if no graph
+
+    // Pairs already connected are not proposed
+    std::vector<char> connected(nScans * nScans, 0);
+    for (PoseGraph::Edge const& edge : _graph.getEdges())
+        connected[edge.source * nScans + edge.target] = connected[edge.target * nScans + edge.source] = 1;
+
+    // Propose by overlap at the current poses...
+    OverlapParams overlapParams(_overlapParams);
+    overlapParams.maxDistSqr = params.maxDistSqr;
+    Eigen::MatrixXd const overlaps = measureOverlaps(poses, overlapParams, nThreads);
+
+    std::vector<char> proposed(nScans * nScans, 0);
+    for (int source = 0; source != nScans; ++source)
+        for (int target = source + 1; target != nScans; ++target)
+            if (overlaps(source, target) >= params.minEstimate)
+                proposed[source * nScans + target] = 1;
+
+    // ...and by similar shape, wherever the scans are
+    if (params.maxDescriptorPairs > 0) {
+        if (static_cast<int>(_descriptors.size()) != nScans) {
+            _descriptors.resize(nScans);
+            parallelFor(nScans, [&](size_t const scanId) {
+                _descriptors[scanId] = computeGlobalDescriptor(_scans[scanId]->getVertices());
+            }, 1, nThreads);
+        }
+
+        for (int scanId = 0; scanId != nScans; ++scanId) {
+            std::vector<std::pair<double, int> > similar;
+            for (int otherId = 0; otherId != nScans; ++otherId)
+                if (otherId != scanId && !connected[scanId * nScans + otherId])
+                    similar.push_back(std::make_pair(compareDescriptors(_descriptors[scanId], _descriptors[otherId]), otherId));
+            size_t const nBest = std::min(similar.size(), static_cast<size_t>(params.maxDescriptorPairs));
+            std::partial_sort(similar.begin(), similar.begin() + nBest, similar.end());
+            for (size_t i = 0; i != nBest; ++i)
+                proposed[std::min(scanId, similar[i].second) * nScans + std::max(scanId, similar[i].second)] |= 2;
+        }
+    } //...if descriptors
+
+    _loopClosures.clear();
+    std::vector<int>  targets;
+    std::vector<char> bySimilarity;
+    for (int source = 0; source != nScans; ++source) {
+        for (int target = source + 1; target != nScans; ++target) {
+            if (!proposed[source * nScans + target] || connected[source * nScans + target])
+                continue;
+            LoopClosure closure;
+            closure.source   = source;
+            closure.target   = target;
+            closure.estimate = overlaps(source, target);
+            closure.overlap  = 0.;
+            closure.error    = 0.;
+            closure.accepted = false;
+            closure.relative = invertPose(poses[target]) * poses[source];
+            _loopClosures.push_back(closure);
+            targets.push_back(target);
+            bySimilarity.push_back(proposed[source * nScans + target] == 2);
+        }
+    } //...for pairs
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+    buildIndices(targets, nThreads);
+
+    // Verify every proposal independently
+    std::vector<InformationT, Eigen::aligned_allocator<InformationT> > information(_loopClosures.size());
+    parallelFor(_loopClosures.size(), [&](size_t const closureId) {
+        LoopClosure &closure = _loopClosures[closureId];
+        CorrespondenceStats stats = verifyPair(closure.source, closure.target, closure.relative,
+                                               params.icpIterations, params.maxDistSqr);
+        if (bySimilarity[closureId]) {
+            // Drift may have moved the pair anywhere, also start from their principal axes
+            PosesT const seeds = computePrincipalAlignments(_scans[closure.source]->getVertices(),
+                                                            _scans[closure.target]->getVertices());
+            for (PoseT relative : seeds) {
+                CorrespondenceStats const seeded =
+                    verifyPair(closure.source, closure.target, relative, params.icpIterations, params.maxDistSqr);
+                if (seeded.getOverlap() > stats.getOverlap()) {
+                    stats            = seeded;
+                    closure.relative = relative;
+                }
+            }
+        }
+        closure.overlap        = stats.getOverlap();
+        closure.error          = stats.error;
+        closure.accepted       = closure.overlap >= params.minOverlap;
+        information[closureId] = stats.information;
+    }, 1, nThreads);
+
+    for (size_t closureId = 0; closureId != _loopClosures.size(); ++closureId) {
+        LoopClosure const& closure = _loopClosures[closureId];
+        if (closure.accepted)
+            _graph.addEdge(closure.source, closure.target, closure.relative, information[closureId]);
+    }
+
+    _graph.optimize(params.graphIterations);
+    return _graph.getPoses();
+} //...RegistrationPipeline::closeLoops()
+
+DecoratedCloud RegistrationPipeline::getModel() const {
+    if (!_model)
+        return DecoratedCloud();
+    if (_model->hasNormals())
+        return DecoratedCloud(_model->getVertices(), _model->getNormals());
+    return DecoratedCloud(_model->getVertices());
+} //...RegistrationPipeline::getModel()
+
+DecoratedCloud
+concatenateClouds(
+    std::vector<DecoratedCloud const*> const& scans,
+    PosesT                             const& poses
+) {
+    if (scans.size() != poses.size()) {
+        std::cerr << "[concatenateClouds] " << scans.size() << " scans, but "
+                  << poses.size() << " poses\n";
+        throw new std::runtime_error("Scan and pose count mismatch");
+    }
+
+    // Count output size
+    Eigen::Index nVertices = 0, nFaces = 0, faceCols = 0;
+    bool hasNormals = !scans.empty();
+    for (DecoratedCloud const* scan : scans) {
+        nVertices  += scan->getVertices().rows();
+        nFaces     += scan->getFaces().rows();
+        hasNormals &= scan->hasNormals();
+        if (scan->hasFaces())
+            faceCols = scan->getFaces().cols();
+    }
+
+    CloudT   vertices(nVertices, 3);
+    FacesT   faces(nFaces, faceCols);
+    NormalsT normals(hasNormals ? nVertices : 0, 3);
+
+    Eigen::Index vertexOffset = 0, faceOffset = 0;
+    for (size_t scanId = 0; scanId != scans.size(); ++scanId) {
+        DecoratedCloud const& scan = *scans[scanId];
+        Eigen::Index const    rows = scan.getVertices().rows();
+
+        vertices.middleRows(vertexOffset, rows) = transformCloud(scan.getVertices(), poses[scanId]);
+        if (hasNormals)
+            normals.middleRows(vertexOffset, rows) =
+                scan.getNormals() * poses[scanId].topLeftCorner<3, 3>().transpose();
+        if (scan.hasFaces()) {
+            faces.middleRows(faceOffset, scan.getFaces().rows()) =
+                scan.getFaces().array() + static_cast<int>(vertexOffset);
+            faceOffset += scan.getFaces().rows();
+        }
+        vertexOffset += rows;
+    } //...for scans
+
+    return hasNormals ? DecoratedCloud(vertices, faces, normals)
+                      : DecoratedCloud(vertices, faces);
+} //...concatenateClouds()
+
+} //...ns acq
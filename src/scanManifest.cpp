@@ -0,0 +1,332 @@
+#include "acq/scanManifest.h"
+
+#include "acq/scanPrefetcher.h"
+#include "acq/impl/parallel.hpp"
+
+#include "Eigen/Geometry" // AngleAxisd
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#   include <glob.h>
+#endif
+
+namespace acq {
+
+namespace {
+    //! First line of a manifest.
+    char const* const MANIFEST_MAGIC = "acqscans 1";
+
+    /** \brief \p path relative to \p directory, unless it is absolute. */
+    std::string joinPath(std::string const& directory, std::string const& path) {
+        bool const absolute = (!path.empty() && (path[0] == '/' || path[0] == '\\'))
+                              || (path.size() > 1 && path[1] == ':');
+        return absolute || directory.empty() ? path : directory + "/" + path;
+    } //...joinPath()
+
+    /** \brief Files matching \p pattern in sorted order, or \p pattern itself, if it is not a glob. */
+    bool expandGlob(std::string const& pattern, std::vector<std::string> &paths) {
+        if (pattern.find_first_of("*?[") == std::string::npos) {
+            paths.push_back(pattern);
+            return true;
+        }
+#ifdef _WIN32
+        std::cerr << "[readScanManifest] Globs are not supported on Windows: " << pattern << "\n";
+        return false;
+#else
+        glob_t matches;
+        int const status = glob(pattern.c_str(), 0, nullptr, &matches);
+        if (status == 0)
+            paths.insert(paths.end(), matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+        globfree(&matches);
+        return status == 0;
+#endif
+    } //...expandGlob()
+
+    /** \brief Pairing strategy called \p name in manifests. */
+    bool parsePairing(std::string const& name, RegistrationPipeline::PairingStrategy &pairing) {
+        if (name == "sequential")
+            pairing = RegistrationPipeline::SEQUENTIAL;
+        else if (name == "star")
+            pairing = RegistrationPipeline::STAR;
+        else if (name == "max_overlap")
+            pairing = RegistrationPipeline::MAX_OVERLAP;
+        else if (name == "incremental")
+            pairing = RegistrationPipeline::INCREMENTAL;
+        else
+            return false;
+        return true;
+    } //...parsePairing()
+
+    /** \brief Reads the options of a scan line following its path. */
+    bool parseScanOptions(std::istringstream &line, ScanEntry &entry) {
+        std::string option;
+        while (line >> option) {
+            if (option == "pose") {
+                for (int row = 0; row != 3; ++row)
+                    for (int col = 0; col != 4; ++col)
+                        if (!(line >> entry.pose(row, col)))
+                            return false;
+            } else if (option == "rotate") {
+                if (!(line >> entry.rotation(0) >> entry.rotation(1) >> entry.rotation(2)))
+                    return false;
+            } else if (option == "parent") {
+                if (!(line >> entry.parent) || entry.parent < -1)
+                    return false;
+            } else if (option == "voxel") {
+                if (!(line >> entry.voxelSize) || entry.voxelSize < 0.)
+                    return false;
+            } else if (option == "normals") {
+                if (!(line >> entry.normalNeighbours) || entry.normalNeighbours < 0)
+                    return false;
+            } else
+                return false;
+        } //...while options
+        return true;
+    } //...parseScanOptions()
+} //...ns anonymous
+
+std::vector<std::string> ScanManifest::getPaths() const {
+    std::vector<std::string> paths;
+    for (ScanEntry const& entry : scans)
+        paths.push_back(entry.path);
+    return paths;
+} //...ScanManifest::getPaths()
+
+unsigned ScanManifest::getThreadCount() const {
+    if (nThreads)
+        return nThreads;
+    return std::max(1u, std::min(defaultThreadCount(), static_cast<unsigned>(scans.size())));
+} //...ScanManifest::getThreadCount()
+
+bool ScanManifest::hasParents() const {
+    return std::any_of(scans.begin(), scans.end(), [](ScanEntry const& entry) { return entry.parent != -2; });
+} //...ScanManifest::hasParents()
+
+std::string ScanManifest::resolvePath(std::string const& path) const {
+    return joinPath(directory, path);
+} //...ScanManifest::resolvePath()
+
+bool
+readScanManifest(
+    std::string  const& path,
+    ScanManifest      & manifest
+) {
+    manifest = ScanManifest();
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "[readScanManifest] Could not open " << path << "\n";
+        return false;
+    }
+    size_t const slash = path.find_last_of("/\\");
+    std::string const directory = slash == std::string::npos ? std::string() : path.substr(0, slash);
+    manifest.directory = directory;
+
+    std::string text;
+    size_t      lineId = 0;
+    bool        magic  = false;
+    while (std::getline(file, text)) {
+        ++lineId;
+        text = text.substr(0, text.find('#'));
+        std::istringstream line(text);
+        std::string keyword;
+        if (!(line >> keyword))
+            continue;
+
+        bool ok = true;
+        if (!magic) {
+            std::string version;
+            ok = (line >> version) && keyword + " " + version == MANIFEST_MAGIC;
+            magic = true;
+        } else if (keyword == "scan") {
+            std::string pattern;
+            ScanEntry   entry;
+            std::vector<std::string> paths;
+            ok = (line >> pattern) && parseScanOptions(line, entry);
+            if (ok && !expandGlob(joinPath(directory, pattern), paths)) {
+                std::cerr << "[readScanManifest] " << path << ":" << lineId << ": " << pattern << " matches no files\n";
+                return false;
+            }
+            for (std::string const& scanPath : paths) {
+                entry.path = scanPath;
+                manifest.scans.push_back(entry);
+            }
+        } else if (keyword == "pairing") {
+            std::string name;
+            std::string reference;
+            ok = (line >> name) && parsePairing(name, manifest.pairing);
+            // The reference is optional
+            if (ok && line >> reference) {
+                std::istringstream number(reference);
+                ok = (number >> manifest.reference) && number.eof();
+            }
+        } else if (keyword == "threads")
+            ok = static_cast<bool>(line >> manifest.nThreads);
+        else if (keyword == "iterations")
+            ok = static_cast<bool>(line >> manifest.icp.maxIterations);
+        else if (keyword == "step")
+            ok = (line >> manifest.icp.stepSize) && manifest.icp.stepSize > 0;
+        else if (keyword == "maxDistSqr")
+            ok = static_cast<bool>(line >> manifest.icp.maxDistSqr);
+        else if (keyword == "minError")
+            ok = static_cast<bool>(line >> manifest.icp.minError);
+        else if (keyword == "minImprovement")
+            ok = static_cast<bool>(line >> manifest.icp.minImprovement);
+        else if (keyword == "modelVoxel")
+            ok = static_cast<bool>(line >> manifest.modelVoxel);
+        else
+            ok = false;
+
+        std::string rest;
+        if (!ok || (keyword != "scan" && line >> rest)) {
+            std::cerr << "[readScanManifest] " << path << ":" << lineId << ": invalid line \"" << text << "\"\n";
+            return false;
+        }
+    } //...while lines
+
+    // Validate the pairing
+    int const nScans = static_cast<int>(manifest.scans.size());
+    if (!nScans) {
+        std::cerr << "[readScanManifest] " << path << " lists no scans\n";
+        return false;
+    }
+    if (manifest.hasParents()) {
+        int nRoots = 0;
+        for (ScanEntry const& entry : manifest.scans) {
+            if (entry.parent == -2 || entry.parent >= nScans) {
+                std::cerr << "[readScanManifest] " << path << ": " << entry.path
+                          << " needs a parent between -1 and " << nScans - 1 << ", as other scans have one\n";
+                return false;
+            }
+            nRoots += entry.parent == -1;
+        }
+        if (nRoots != 1) {
+            std::cerr << "[readScanManifest] " << path << ": expected one scan with parent -1, got " << nRoots << "\n";
+            return false;
+        }
+    } else if (manifest.reference < 0 || manifest.reference >= nScans) {
+        std::cerr << "[readScanManifest] " << path << ": reference " << manifest.reference
+                  << " is not one of the " << nScans << " scans\n";
+        return false;
+    }
+    return true;
+} //...readScanManifest()
+
+size_t
+loadManifestScans(
+    ScanManifest                const& manifest,
+    CloudManager                     & cloudManager,
+    int                         const  firstIndex,
+    std::vector<ReadStats>           * stats,
+    CloudManager::LoadCallbackT const& onLoaded,
+    TaskGraph                        * tasks
+) {
+    size_t const nScans = manifest.scans.size();
+    // Grow once up front, so the slots stay put while the tasks fill them
+    cloudManager.reserveClouds(firstIndex + static_cast<int>(nScans));
+
+    // Files and large files' chunks share all cores, the per-scan steps one thread per scan
+    unsigned const nWorkers        = manifest.nThreads ? manifest.nThreads : defaultThreadCount();
+    unsigned const nThreadsPerFile = std::max(nWorkers / static_cast<unsigned>(std::max<size_t>(std::min<size_t>(nScans, nWorkers), 1)), 1u);
+
+    TaskGraph localTasks;
+    TaskGraph &graph = tasks ? *tasks : localTasks;
+    graph.clear();
+
+    std::vector<ReadStats> fileStats(nScans);
+    std::atomic<size_t>    nFailed(0);
+    std::mutex             callbackMutex;
+    for (size_t scanId = 0; scanId != nScans; ++scanId) {
+        ScanEntry const& entry = manifest.scans[scanId];
+        int       const  slot  = firstIndex + static_cast<int>(scanId);
+
+        TaskGraph::TaskId const loadTask = graph.addTask("load " + std::to_string(scanId), [&, scanId, slot]() {
+            std::vector<ReadStats> scanStats;
+            nFailed += cloudManager.loadClouds(std::vector<std::string>(1, manifest.scans[scanId].path), slot, &scanStats,
+                                               CloudManager::LoadCallbackT(), nThreadsPerFile);
+            fileStats[scanId] = scanStats.front();
+            if (onLoaded) {
+                std::lock_guard<std::mutex> lock(callbackMutex);
+                onLoaded(scanId, fileStats[scanId]);
+            }
+        });
+
+        TaskGraph::TaskId const prepareTask = graph.addTask("prepare " + std::to_string(scanId), [&entry, &cloudManager, slot]() {
+            DecoratedCloud &cloud = cloudManager.getCloud(slot);
+            if (!cloud.getVertices().rows())
+                return;
+            if (entry.voxelSize > 0.)
+                cloud = downsampleCloud(cloud, entry.voxelSize);
+            // Once per scan, to size neighbourhoods with
+            cloud.estimateSpacing(DecoratedCloud::DEFAULT_SPACING_NEIGHBOURS, 1);
+            if (entry.normalNeighbours > 0) {
+                // Meshes have their neighbourhoods already
+                if (cloud.hasFaces())
+                    cloud.estimateNormalsFromFaces(FACE_WEIGHT_AREA, 1);
+                else
+                    cloud.estimateNormals(entry.normalNeighbours, std::sqrt(std::numeric_limits<float>::max()) - 1.f, 1);
+            }
+        });
+        graph.addDependency(loadTask, prepareTask);
+    } //...for scans
+
+    graph.run(manifest.getThreadCount());
+
+    if (stats)
+        stats->swap(fileStats);
+    return nFailed;
+} //...loadManifestScans()
+
+PoseT
+getInitialPose(
+    ScanEntry const& entry,
+    CloudT    const& vertices
+) {
+    if (!vertices.rows())
+        return entry.pose;
+
+    // Centre on the mean, then rotate, as mesh::rotate() does, also for a zero rotation
+    Eigen::Matrix3d const R =
+        (Eigen::AngleAxisd(entry.rotation(2), Eigen::Vector3d::UnitZ()) *
+         Eigen::AngleAxisd(entry.rotation(1), Eigen::Vector3d::UnitY()) *
+         Eigen::AngleAxisd(entry.rotation(0), Eigen::Vector3d::UnitX())).toRotationMatrix();
+    Eigen::Vector3d const mean = vertices.colwise().mean().transpose();
+
+    PoseT rotation(PoseT::Identity());
+    rotation.topLeftCorner<3, 3>()  = R;
+    rotation.topRightCorner<3, 1>() = -R * mean;
+    return entry.pose * rotation;
+} //...getInitialPose()
+
+void
+setupPipeline(
+    ScanManifest                       const& manifest,
+    std::vector<DecoratedCloud const*> const& scans,
+    RegistrationPipeline                    & pipeline
+) {
+    if (scans.size() != manifest.scans.size()) {
+        std::cerr << "[setupPipeline] Got " << scans.size() << " scans for a manifest of "
+                  << manifest.scans.size() << "\n";
+        throw new std::runtime_error("Scan count mismatch");
+    }
+
+    std::vector<int> parents;
+    for (size_t scanId = 0; scanId != scans.size(); ++scanId) {
+        pipeline.addScan(*scans[scanId], getInitialPose(manifest.scans[scanId], scans[scanId]->getVertices()));
+        parents.push_back(manifest.scans[scanId].parent);
+    }
+
+    if (manifest.hasParents())
+        pipeline.setSpanningTree(parents);
+    else
+        pipeline.setPairing(manifest.pairing, manifest.reference);
+    pipeline.setVoxelSize(manifest.modelVoxel);
+} //...setupPipeline()
+
+} //...ns acq
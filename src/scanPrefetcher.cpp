@@ -0,0 +1,183 @@
+#include "acq/scanPrefetcher.h"
+
+#include "acq/cloudIndex.h"
+#include "acq/impl/icp.hpp"
+
+#include "Eigen/LU"    // inverse()
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <unordered_set>
+
+namespace acq {
+
+PrefetchedScan::PrefetchedScan()
+    : scanId(0), ok(false), prepareTime(0.)
+{}
+
+PrefetchedScan::~PrefetchedScan() {}
+
+ScanPrefetcher::ScanPrefetcher(std::vector<std::string> const& paths, PrefetchParams const& params)
+    : _paths(paths), _params(params), _consumed(0), _stop(false), _waitTime(0.)
+{
+    _params.capacity = std::max(_params.capacity, size_t(1));
+    _thread = std::thread(&ScanPrefetcher::prefetch, this);
+}
+
+ScanPrefetcher::~ScanPrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _space.notify_all();
+    _thread.join();
+}
+
+std::unique_ptr<PrefetchedScan> ScanPrefetcher::next() {
+    typedef std::chrono::steady_clock ClockT;
+
+    if (_consumed == _paths.size())
+        return std::unique_ptr<PrefetchedScan>();
+
+    ClockT::time_point const start = ClockT::now();
+    std::unique_lock<std::mutex> lock(_mutex);
+    _ready.wait(lock, [this]() { return !_queue.empty(); });
+    std::unique_ptr<PrefetchedScan> scan(std::move(_queue.front()));
+    _queue.pop_front();
+    lock.unlock();
+    _space.notify_one();
+
+    _waitTime += std::chrono::duration<double>(ClockT::now() - start).count();
+    ++_consumed;
+    return scan;
+} //...ScanPrefetcher::next()
+
+void ScanPrefetcher::prefetch() {
+    typedef std::chrono::steady_clock ClockT;
+
+    for (size_t scanId = 0; scanId != _paths.size(); ++scanId) {
+        // Wait for space before reading, so at most capacity scans are prepared ahead
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _space.wait(lock, [this]() { return _stop || _queue.size() < _params.capacity; });
+            if (_stop)
+                return;
+        }
+
+        std::unique_ptr<PrefetchedScan> scan(new PrefetchedScan());
+        scan->scanId = scanId;
+        scan->path   = _paths[scanId];
+        scan->ok     = readMesh(scan->path, scan->cloud, &scan->readStats, _params.readThreads);
+        if (scan->ok) {
+            ClockT::time_point const start = ClockT::now();
+            if (_params.voxelSize > 0.)
+                scan->cloud = downsampleCloud(scan->cloud, _params.voxelSize);
+            // The scan lives on the heap, so the index can refer to its points
+            scan->index.reset(new CloudIndex(scan->cloud.getVertices(), _params.maxLeafs));
+            scan->prepareTime = std::chrono::duration<double>(ClockT::now() - start).count();
+        } else
+            scan->cloud = DecoratedCloud();
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queue.push_back(std::move(scan));
+        }
+        _ready.notify_one();
+    } //...for scans
+} //...ScanPrefetcher::prefetch()
+
+DecoratedCloud
+downsampleCloud(
+    DecoratedCloud const& cloud,
+    double         const  voxelSize
+) {
+    if (voxelSize <= 0.)
+        return cloud;
+
+    // Same keys as ModelAccumulator: 21 bits per axis
+    uint64_t const mask = (uint64_t(1) << 21) - 1;
+    CloudT const& vertices = cloud.getVertices();
+    std::unordered_set<uint64_t> voxels;
+    std::vector<Eigen::Index>    kept;
+    for (Eigen::Index row = 0; row != vertices.rows(); ++row) {
+        uint64_t key = 0;
+        for (int dim = 0; dim != 3; ++dim) {
+            int64_t const cell = static_cast<int64_t>(std::floor(vertices(row, dim) / voxelSize));
+            key |= (static_cast<uint64_t>(cell) & mask) << (21 * dim);
+        }
+        if (voxels.insert(key).second)
+            kept.push_back(row);
+    }
+    if (kept.size() == static_cast<size_t>(vertices.rows()))
+        return cloud;
+
+    CloudT   keptVertices(kept.size(), 3);
+    NormalsT keptNormals(cloud.hasNormals() ? kept.size() : 0, 3);
+    for (size_t keptId = 0; keptId != kept.size(); ++keptId) {
+        keptVertices.row(keptId) = vertices.row(kept[keptId]);
+        if (cloud.hasNormals())
+            keptNormals.row(keptId) = cloud.getNormals().row(kept[keptId]);
+    }
+    return DecoratedCloud(keptVertices, keptNormals);
+} //...downsampleCloud()
+
+PosesT
+registerSequence(
+    ScanPrefetcher                      & prefetcher,
+    IcpParams                      const& params,
+    PosesT                         const& initialPoses,
+    RegistrationPipeline::PairResultsT  * pairResults
+) {
+    typedef std::chrono::steady_clock ClockT;
+
+    size_t const nScans = prefetcher.size();
+    if (!initialPoses.empty() && initialPoses.size() != nScans) {
+        std::cerr << "[registerSequence] Got " << initialPoses.size() << " initial poses for "
+                  << nScans << " scans\n";
+        throw new std::runtime_error("Invalid initial poses");
+    }
+    PosesT const initial = initialPoses.empty() ? PosesT(nScans, PoseT::Identity()) : initialPoses;
+
+    if (pairResults)
+        pairResults->clear();
+    PosesT poses(nScans, PoseT::Identity());
+    std::unique_ptr<PrefetchedScan> target;
+    while (std::unique_ptr<PrefetchedScan> scan = prefetcher.next()) {
+        size_t const scanId = scan->scanId;
+        if (!target) {
+            poses[scanId] = initial[scanId];
+            if (scan->ok)
+                target = std::move(scan);
+            continue;
+        }
+        if (!scan->ok) {
+            poses[scanId] = poses[scanId - 1];
+            continue;
+        }
+
+        // The prefetcher keeps loading the next scans meanwhile
+        RegistrationPipeline::PairResult pair;
+        pair.source = static_cast<int>(scanId);
+        pair.target = static_cast<int>(target->scanId);
+        pair.cached = false;
+        ClockT::time_point const start = ClockT::now();
+        pair.icp = alignPointToPoint(
+            /*      Moving points: */ scan->cloud.getVertices(),
+            /*       Fixed points: */ *target->index,
+            /* Relative pose guess: */ PoseT(initial[pair.target].inverse() * initial[pair.source]),
+            /*           Settings: */ params);
+        pair.time = std::chrono::duration<double>(ClockT::now() - start).count();
+        poses[scanId] = poses[pair.target] * pair.icp.pose;
+
+        if (pairResults)
+            pairResults->push_back(pair);
+        // Frees the old target
+        target = std::move(scan);
+    } //...while scans
+
+    return poses;
+} //...registerSequence()
+
+} //...ns acq
@@ -0,0 +1,228 @@
+#include "acq/taskGraph.h"
+
+#include "acq/parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace acq {
+
+namespace {
+    /** \brief Ready tasks of a worker. The owner works at the back, thieves take from the front. */
+    struct WorkQueue {
+        std::mutex                    mutex;
+        std::deque<TaskGraph::TaskId> tasks;
+    }; //...struct WorkQueue
+} //...ns anonymous
+
+TaskGraph::TaskGraph() : _wallTime(0.) {}
+
+TaskGraph::TaskId TaskGraph::addTask(std::string const& name, WorkT const& work) {
+    Task task;
+    task.name         = name;
+    task.work         = work;
+    task.dependencies = 0;
+    _tasks.push_back(task);
+    return _tasks.size() - 1;
+} //...TaskGraph::addTask()
+
+void TaskGraph::addDependency(TaskId const before, TaskId const after) {
+    if (before >= _tasks.size() || after >= _tasks.size() || before == after) {
+        std::cerr << "[TaskGraph::addDependency] Invalid dependency " << before << " -> " << after
+                  << " for " << _tasks.size() << " tasks\n";
+        throw new std::runtime_error("Invalid task dependency");
+    }
+    _tasks[before].successors.push_back(after);
+    ++_tasks[after].dependencies;
+} //...TaskGraph::addDependency()
+
+void TaskGraph::clear() {
+    _tasks.clear();
+    _stats.clear();
+    _wallTime = 0.;
+} //...TaskGraph::clear()
+
+void TaskGraph::run(unsigned const nThreads) {
+    typedef std::chrono::steady_clock ClockT;
+
+    size_t const nTasks = _tasks.size();
+    _stats.assign(nTasks, TaskStats());
+    _wallTime = 0.;
+    if (!nTasks)
+        return;
+
+    // Check, that the graph is acyclic (Kahn), before any thread waits forever
+    {
+        std::vector<int>    pending(nTasks);
+        std::vector<TaskId> ready;
+        for (TaskId taskId = 0; taskId != nTasks; ++taskId) {
+            pending[taskId] = _tasks[taskId].dependencies;
+            if (!pending[taskId])
+                ready.push_back(taskId);
+        }
+        size_t nVisited = 0;
+        while (!ready.empty()) {
+            TaskId const taskId = ready.back();
+            ready.pop_back();
+            ++nVisited;
+            for (TaskId const successor : _tasks[taskId].successors)
+                if (!--pending[successor])
+                    ready.push_back(successor);
+        }
+        if (nVisited != nTasks) {
+            std::cerr << "[TaskGraph::run] " << nTasks - nVisited << " tasks are part of a cycle\n";
+            throw new std::runtime_error("Cyclic task graph");
+        }
+    } //...cycle check
+
+    unsigned const nWorkers =
+        static_cast<unsigned>(std::min<size_t>(nThreads ? nThreads : defaultThreadCount(), nTasks));
+
+    // Remaining dependencies of each task
+    std::unique_ptr<std::atomic<int>[]> pending(new std::atomic<int>[nTasks]);
+    // Ready tasks per worker
+    std::unique_ptr<WorkQueue[]> queues(new WorkQueue[nWorkers]);
+
+    std::atomic<size_t>     queued(0);       // Tasks in any queue
+    std::atomic<size_t>     remaining(nTasks);
+    std::mutex              idleMutex;
+    std::condition_variable wake;
+
+    // First error encountered, rethrown after joining
+    std::atomic<bool>  failed(false);
+    std::exception_ptr error;
+    std::mutex         errorMutex;
+
+    auto const push = [&](unsigned const workerId, TaskId const taskId) {
+        // Count first, so the counter never drops below the queued tasks
+        ++queued;
+        {
+            std::lock_guard<std::mutex> lock(queues[workerId].mutex);
+            queues[workerId].tasks.push_back(taskId);
+        }
+        std::lock_guard<std::mutex> lock(idleMutex);
+        wake.notify_one();
+    }; //...push
+
+    // Newest own task first, else oldest task of the next busy worker
+    auto const pop = [&](unsigned const workerId, TaskId &taskId) -> bool {
+        {
+            std::lock_guard<std::mutex> lock(queues[workerId].mutex);
+            if (!queues[workerId].tasks.empty()) {
+                taskId = queues[workerId].tasks.back();
+                queues[workerId].tasks.pop_back();
+                return true;
+            }
+        }
+        for (unsigned offset = 1; offset < nWorkers; ++offset) {
+            WorkQueue &victim = queues[(workerId + offset) % nWorkers];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                taskId = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }; //...pop
+
+    // Seed the queues round robin with the tasks without dependencies
+    unsigned nextWorker = 0;
+    for (TaskId taskId = 0; taskId != nTasks; ++taskId) {
+        pending[taskId].store(_tasks[taskId].dependencies);
+        if (!_tasks[taskId].dependencies) {
+            queues[nextWorker].tasks.push_back(taskId);
+            ++queued;
+            nextWorker = (nextWorker + 1) % nWorkers;
+        }
+    }
+
+    ClockT::time_point const start = ClockT::now();
+
+    auto const worker = [&](unsigned const workerId) {
+        for (;;) {
+            TaskId taskId;
+            if (!pop(workerId, taskId)) {
+                std::unique_lock<std::mutex> lock(idleMutex);
+                wake.wait(lock, [&]() { return queued.load() > 0 || remaining.load() == 0; });
+                if (remaining.load() == 0)
+                    return;
+                continue;
+            }
+            --queued;
+
+            // After an error, the remaining tasks are only released, not run
+            ClockT::time_point const taskStart = ClockT::now();
+            if (!failed.load()) {
+                try {
+                    _tasks[taskId].work();
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error)
+                        error = std::current_exception();
+                    failed.store(true);
+                }
+            }
+            TaskStats &stats = _stats[taskId];
+            stats.name     = _tasks[taskId].name;
+            stats.start    = std::chrono::duration<double>(taskStart - start).count();
+            stats.duration = std::chrono::duration<double>(ClockT::now() - taskStart).count();
+            stats.worker   = workerId;
+
+            for (TaskId const successor : _tasks[taskId].successors)
+                if (--pending[successor] == 0)
+                    push(workerId, successor);
+
+            if (--remaining == 0) {
+                std::lock_guard<std::mutex> lock(idleMutex);
+                wake.notify_all();
+            }
+        } //...for ever
+    }; //...worker
+
+    // Calling thread works too
+    std::vector<std::thread> threads;
+    threads.reserve(nWorkers - 1);
+    for (unsigned workerId = 1; workerId < nWorkers; ++workerId)
+        threads.emplace_back(worker, workerId);
+    worker(0);
+    for (std::thread &thread : threads)
+        thread.join();
+
+    _wallTime = std::chrono::duration<double>(ClockT::now() - start).count();
+
+    if (error)
+        std::rethrow_exception(error);
+} //...TaskGraph::run()
+
+void TaskGraph::printStats(std::ostream &os) const {
+    std::ios_base::fmtflags const flags     = os.flags();
+    std::streamsize         const precision = os.precision();
+
+    double   busy     = 0.;
+    unsigned nWorkers = 0;
+    for (TaskStats const& stats : _stats) {
+        os << std::setw(32) << std::left << stats.name << std::right
+           << " worker " << std::setw(2) << stats.worker
+           << "  start " << std::fixed << std::setprecision(3) << stats.start << " s"
+           << "  took " << stats.duration << " s\n";
+        busy    += stats.duration;
+        nWorkers = std::max(nWorkers, stats.worker + 1);
+    }
+    os << _stats.size() << " tasks on " << nWorkers << " workers, "
+       << busy << " s of work in " << _wallTime << " s" << std::endl;
+    os.flags(flags);
+    os.precision(precision);
+} //...TaskGraph::printStats()
+
+} //...ns acq
@@ -0,0 +1,230 @@
+#include "acq/tileCache.h"
+
+#include "acq/cloudIndex.h"
+#include "acq/impl/icp.hpp"
+#include "acq/impl/parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+namespace acq {
+
+namespace {
+    /** \brief Squared distance from \p point to the box [\p min, \p max], 0 inside. */
+    inline double getBoxDistSqr(Eigen::Vector3d const& point, Eigen::Vector3d const& min, Eigen::Vector3d const& max) {
+        return (min - point).cwiseMax(point - max).cwiseMax(Eigen::Vector3d::Zero()).squaredNorm();
+    }
+} //...ns anonymous
+
+TileCache::Tile::Tile() : bytes(0) {}
+
+TileCache::Tile::~Tile() {}
+
+TileCache::TileCache(TiledCloud const& cloud, size_t const budgetBytes, int const maxLeafs)
+    : _cloud(cloud), _budgetBytes(budgetBytes), _maxLeafs(maxLeafs),
+      _residentBytes(0), _peakBytes(0), _loads(0), _hits(0), _evictions(0)
+{}
+
+TileCache::~TileCache() {}
+
+std::shared_ptr<TileCache::Tile const> TileCache::acquire(int const tileId) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto const it = _entries.find(tileId);
+        if (it != _entries.end()) {
+            _usage.splice(_usage.end(), _usage, it->second.usage);
+            ++_hits;
+            return it->second.tile;
+        }
+    }
+
+    // Load without blocking the queries to resident tiles
+    std::shared_ptr<Tile> tile(new Tile());
+    std::string const path = _cloud.getTilePath(tileId);
+    if (!tile->file.open(path)) {
+        std::cerr << "[TileCache::acquire] Could not map tile " << tileId << " from " << path << "\n";
+        throw new std::runtime_error("Missing tile");
+    }
+    // Tiles written by TileWriter carry their tree
+    tile->index = tile->file.loadIndex(_maxLeafs);
+    if (!tile->index)
+        tile->index.reset(new CloudIndex(tile->file.getVertices(), _maxLeafs));
+    // Points, the permutation of the tree and roughly two nodes per leaf
+    size_t const nPoints = tile->index->size();
+    tile->bytes = nPoints * (3 * sizeof(double) + sizeof(size_t))
+                  + (nPoints / std::max(_maxLeafs, 1) + 1) * 2 * 64;
+    ++_loads;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    // Another thread may have loaded it meanwhile
+    auto const it = _entries.find(tileId);
+    if (it != _entries.end()) {
+        _usage.splice(_usage.end(), _usage, it->second.usage);
+        return it->second.tile;
+    }
+
+    Entry &entry = _entries[tileId];
+    entry.tile   = tile;
+    entry.usage  = _usage.insert(_usage.end(), tileId);
+    _residentBytes += tile->bytes;
+    _peakBytes      = std::max(_peakBytes, _residentBytes);
+
+    // Evict the least recently used tiles, keeping the new one
+    while (_residentBytes > _budgetBytes && _usage.size() > 1) {
+        auto const evicted = _entries.find(_usage.front());
+        _residentBytes -= evicted->second.tile->bytes;
+        _entries.erase(evicted);
+        _usage.pop_front();
+        ++_evictions;
+    }
+    return tile;
+} //...TileCache::acquire()
+
+bool TileCache::findNearest(
+    Eigen::Vector3d const& query,
+    double          const  maxDistSqr,
+    Eigen::Vector3d      & point,
+    double               & distSqr,
+    PinnedT              * pinned
+) {
+    TileInfosT const& tiles = _cloud.getTiles();
+    if (pinned && pinned->size() != tiles.size())
+        pinned->resize(tiles.size());
+    double best  = maxDistSqr;
+    bool   found = false;
+    auto const searchTile = [&](int const tileId) {
+        TileInfo const& info = tiles[tileId];
+        if (getBoxDistSqr(query, info.min, info.max) >= best)
+            return;
+        // Held tiles are used without the lock, or copying the shared count
+        std::shared_ptr<Tile const> acquired;
+        Tile const* tile;
+        if (pinned) {
+            std::shared_ptr<Tile const> &held = (*pinned)[tileId];
+            if (!held)
+                held = acquire(tileId);
+            tile = held.get();
+        } else {
+            acquired = acquire(tileId);
+            tile     = acquired.get();
+        }
+        size_t nearestId;
+        double nearestDistSqr;
+        if (tile->index->findNearest(query, nearestId, nearestDistSqr) && nearestDistSqr < best) {
+            best  = nearestDistSqr;
+            point = tile->index->getPoint(nearestId);
+            found = true;
+        }
+    };
+
+    // Own tile first, its neighbour is most likely the closest and prunes the others
+    double          const radius = std::sqrt(maxDistSqr);
+    Eigen::Vector3i const home   = _cloud.getCell(query);
+    Eigen::Vector3i const lo     = _cloud.getCell(query - Eigen::Vector3d::Constant(radius));
+    Eigen::Vector3i const hi     = _cloud.getCell(query + Eigen::Vector3d::Constant(radius));
+    int const homeTile = _cloud.findTile(home);
+    if (homeTile >= 0)
+        searchTile(homeTile);
+
+    double const nCells = double(hi(0) - lo(0) + 1) * (hi(1) - lo(1) + 1) * (hi(2) - lo(2) + 1);
+    if (nCells > tiles.size()) {
+        // Radius much larger than the tiles
+        for (int tileId = 0; tileId != static_cast<int>(tiles.size()); ++tileId)
+            if (tileId != homeTile)
+                searchTile(tileId);
+    } else {
+        Eigen::Vector3i cell;
+        for (cell(0) = lo(0); cell(0) <= hi(0); ++cell(0))
+            for (cell(1) = lo(1); cell(1) <= hi(1); ++cell(1))
+                for (cell(2) = lo(2); cell(2) <= hi(2); ++cell(2)) {
+                    int const tileId = cell == home ? -1 : _cloud.findTile(cell);
+                    if (tileId >= 0)
+                        searchTile(tileId);
+                }
+    }
+
+    if (found)
+        distSqr = best;
+    return found;
+} //...TileCache::findNearest()
+
+IcpResult
+alignTiled(
+    TiledCloud const& source,
+    TileCache       & target,
+    PoseT      const& initialPose,
+    IcpParams  const& params,
+    unsigned   const  nThreads
+) {
+    TileInfosT const& sourceTiles = source.getTiles();
+    TileInfosT const& targetTiles = target.getCloud().getTiles();
+    size_t const stepSize = static_cast<size_t>(std::max(params.stepSize, 1));
+    double const radius   = std::sqrt(params.maxDistSqr);
+
+    // Neighbouring source tiles one after the other, so they share resident target tiles
+    std::vector<size_t> order(sourceTiles.size());
+    for (size_t tileId = 0; tileId != order.size(); ++tileId)
+        order[tileId] = tileId;
+    std::sort(order.begin(), order.end(), [&sourceTiles](size_t const a, size_t const b) {
+        Eigen::Vector3i const& cellA = sourceTiles[a].cell;
+        Eigen::Vector3i const& cellB = sourceTiles[b].cell;
+        return std::lexicographical_compare(cellA.data(), cellA.data() + 3, cellB.data(), cellB.data() + 3);
+    });
+
+    return iterateIcp(initialPose, params, [&](PoseT const& pose) {
+        Eigen::Matrix3d const R = pose.topLeftCorner<3, 3>();
+        Eigen::Vector3d const t = pose.topRightCorner<3, 1>();
+
+        std::vector<CorrespondenceSums> tileSums(sourceTiles.size());
+        parallelFor(order.size(), [&](size_t const orderId) {
+            size_t   const  tileId = order[orderId];
+            TileInfo const& info   = sourceTiles[tileId];
+
+            // Moved bounding box, grown by the rejection distance
+            Eigen::Vector3d lo = Eigen::Vector3d::Constant( std::numeric_limits<double>::max());
+            Eigen::Vector3d hi = Eigen::Vector3d::Constant(-std::numeric_limits<double>::max());
+            for (int corner = 0; corner != 8; ++corner) {
+                Eigen::Vector3d const p = R * Eigen::Vector3d(corner & 1 ? info.max(0) : info.min(0),
+                                                              corner & 2 ? info.max(1) : info.min(1),
+                                                              corner & 4 ? info.max(2) : info.min(2)) + t;
+                lo = lo.cwiseMin(p);
+                hi = hi.cwiseMax(p);
+            }
+            lo.array() -= radius;
+            hi.array() += radius;
+            bool const nearTarget = std::any_of(targetTiles.begin(), targetTiles.end(), [&](TileInfo const& other) {
+                return (other.min.array() <= hi.array()).all() && (lo.array() <= other.max.array()).all();
+            });
+            if (!nearTarget)
+                return;
+
+            CloudFile const file(source.getTilePath(tileId));
+            if (!file.isOpen()) {
+                std::cerr << "[alignTiled] Could not map source tile " << tileId << "\n";
+                throw new std::runtime_error("Missing tile");
+            }
+            CloudFile::VerticesMapT const vertices = file.getVertices();
+            CorrespondenceSums &sums = tileSums[tileId];
+            // Target tiles near this one, locked once each
+            TileCache::PinnedT pinned;
+            for (size_t row = 0; row < static_cast<size_t>(vertices.rows()); row += stepSize) {
+                Eigen::Vector3d const p = R * vertices.row(row).transpose() + t;
+                Eigen::Vector3d q;
+                double          distSqr;
+                if (target.findNearest(p, params.maxDistSqr, q, distSqr, &pinned))
+                    sums.add(p, q, distSqr);
+            }
+        }, 1, nThreads);
+
+        // Same order every time, independent of the threads
+        CorrespondenceSums sums;
+        for (CorrespondenceSums const& tile : tileSums)
+            sums += tile;
+        return sums;
+    });
+} //...alignTiled()
+
+} //...ns acq
@@ -0,0 +1,259 @@
+#include "acq/tiledCloud.h"
+
+#include "acq/cloudFile.h"
+#include "acq/cloudIndex.h"
+#include "acq/meshIO.h"
+#include "acq/plyIO.h"
+#include "acq/impl/hash.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#ifdef _WIN32
+#   include <direct.h>
+#else
+#   include <sys/stat.h>
+#endif
+
+namespace acq {
+
+namespace {
+    //! Name of the manifest in a tile directory.
+    char const* const MANIFEST_NAME = "tiles.txt";
+    //! First line of the manifest.
+    char const* const MANIFEST_MAGIC = "acqtiles 1";
+
+    /** \brief File name of the tile in \p cell, without extension. */
+    std::string getTileName(Eigen::Vector3i const& cell) {
+        std::ostringstream name;
+        name << "tile_" << cell(0) << "_" << cell(1) << "_" << cell(2);
+        return name.str();
+    } //...getTileName()
+
+    /** \brief Grid cell of \p point for tiles of edge length \p tileSize. */
+    inline Eigen::Vector3i getGridCell(Eigen::Vector3d const& point, double const tileSize) {
+        return (point / tileSize).array().floor().cast<int>().matrix();
+    }
+} //...ns anonymous
+
+TileWriter::TileWriter(std::string const& directory, double const tileSize, size_t const bufferPoints)
+    : _directory(directory), _tileSize(tileSize), _bufferPoints(std::max(bufferPoints, size_t(1))),
+      _nBuffered(0), _nPoints(0), _ok(tileSize > 0.)
+{
+    if (!_ok)
+        std::cerr << "[TileWriter::TileWriter] Invalid tile size " << tileSize << "\n";
+#ifdef _WIN32
+    _mkdir(_directory.c_str());
+#else
+    mkdir(_directory.c_str(), 0755);
+#endif
+}
+
+std::string TileWriter::getSpillPath(size_t const tileId) const {
+    return _directory + "/" + getTileName(_tiles[tileId].cell) + ".raw";
+} //...TileWriter::getSpillPath()
+
+bool TileWriter::addPoints(Eigen::Ref<CloudT const> const& points) {
+    if (!_ok)
+        return false;
+
+    for (Eigen::Index row = 0; row != points.rows(); ++row) {
+        Eigen::Vector3d const point = points.row(row).transpose();
+        Eigen::Vector3i const cell  = getGridCell(point, _tileSize);
+
+        auto const inserted = _cells.insert(std::make_pair(getCellKey(cell), _tiles.size()));
+        size_t const tileId = inserted.first->second;
+        if (inserted.second) {
+            TileInfo tile;
+            tile.cell = cell;
+            tile.min  = point;
+            tile.max  = point;
+            tile.file = getTileName(cell) + ".acqc";
+            _tiles.push_back(tile);
+            _buffers.emplace_back();
+            _spilled.push_back(0);
+        }
+
+        TileInfo &tile = _tiles[tileId];
+        tile.min = tile.min.cwiseMin(point);
+        tile.max = tile.max.cwiseMax(point);
+        ++tile.count;
+
+        std::vector<double> &buffer = _buffers[tileId];
+        buffer.insert(buffer.end(), point.data(), point.data() + 3);
+        if (++_nBuffered >= _bufferPoints && !flush())
+            return false;
+    } //...for points
+
+    _nPoints += points.rows();
+    return true;
+} //...TileWriter::addPoints()
+
+bool TileWriter::flush() {
+    for (size_t tileId = 0; tileId != _buffers.size(); ++tileId) {
+        std::vector<double> &buffer = _buffers[tileId];
+        if (buffer.empty())
+            continue;
+
+        // Start over on the first spill, appending afterwards
+        std::ofstream file(getSpillPath(tileId),
+                           std::ios::binary | (_spilled[tileId] ? std::ios::app : std::ios::trunc));
+        file.write(reinterpret_cast<char const*>(buffer.data()), buffer.size() * sizeof(double));
+        if (!file) {
+            std::cerr << "[TileWriter::flush] Could not write " << getSpillPath(tileId) << "\n";
+            _ok = false;
+            return false;
+        }
+        _spilled[tileId] = 1;
+        // Release the memory, most tiles are not touched again soon
+        std::vector<double>().swap(buffer);
+    } //...for tiles
+
+    _nBuffered = 0;
+    return true;
+} //...TileWriter::flush()
+
+bool TileWriter::finish() {
+    if (!_ok || !flush())
+        return false;
+
+    // One tile in memory at a time
+    for (size_t tileId = 0; tileId != _tiles.size(); ++tileId) {
+        TileInfo const&   tile      = _tiles[tileId];
+        std::string const spillPath = getSpillPath(tileId);
+
+        std::vector<double> interleaved(tile.count * 3);
+        std::ifstream spill(spillPath, std::ios::binary);
+        spill.read(reinterpret_cast<char*>(interleaved.data()), interleaved.size() * sizeof(double));
+        if (!spill || spill.gcount() != static_cast<std::streamsize>(interleaved.size() * sizeof(double))) {
+            std::cerr << "[TileWriter::finish] Could not read " << spillPath << "\n";
+            return false;
+        }
+        spill.close();
+
+        CloudT const vertices = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> const>(
+            interleaved.data(), tile.count, 3);
+        std::string const indexData = CloudIndex(vertices, INDEX_MAX_LEAFS).save(hashMatrix(vertices));
+        if (!writeCloudFile(_directory + "/" + tile.file, vertices, FacesT(), NormalsT(), indexData))
+            return false;
+        std::remove(spillPath.c_str());
+    } //...for tiles
+
+    std::ofstream manifest(_directory + "/" + MANIFEST_NAME);
+    manifest << MANIFEST_MAGIC << "\n"
+             << std::setprecision(std::numeric_limits<double>::max_digits10)
+             << "tileSize " << _tileSize << "\n"
+             << "tiles " << _tiles.size() << "\n";
+    for (TileInfo const& tile : _tiles)
+        manifest << tile.cell.transpose() << " " << tile.count << " "
+                 << tile.min.transpose() << " " << tile.max.transpose() << " " << tile.file << "\n";
+    if (!manifest) {
+        std::cerr << "[TileWriter::finish] Could not write the manifest to " << _directory << "\n";
+        return false;
+    }
+    return true;
+} //...TileWriter::finish()
+
+TiledCloud::TiledCloud()
+    : _tileSize(0.), _nPoints(0)
+{}
+
+TiledCloud::TiledCloud(std::string const& directory)
+    : TiledCloud()
+{
+    open(directory);
+}
+
+bool TiledCloud::open(std::string const& directory) {
+    _directory = directory;
+    _tileSize  = 0.;
+    _nPoints   = 0;
+    _tiles.clear();
+    _cells.clear();
+
+    std::string const path = directory + "/" + MANIFEST_NAME;
+    std::ifstream manifest(path);
+    std::string magic, keyword;
+    size_t nTiles = 0;
+    std::getline(manifest, magic);
+    if (magic != MANIFEST_MAGIC
+        || !(manifest >> keyword >> _tileSize) || keyword != "tileSize" || _tileSize <= 0.
+        || !(manifest >> keyword >> nTiles) || keyword != "tiles") {
+        std::cerr << "[TiledCloud::open] " << path << " is missing or not a tile manifest\n";
+        _tiles.clear();
+        return false;
+    }
+
+    _tiles.resize(nTiles);
+    for (size_t tileId = 0; tileId != nTiles; ++tileId) {
+        TileInfo &tile = _tiles[tileId];
+        if (!(manifest >> tile.cell(0) >> tile.cell(1) >> tile.cell(2) >> tile.count
+                       >> tile.min(0) >> tile.min(1) >> tile.min(2)
+                       >> tile.max(0) >> tile.max(1) >> tile.max(2) >> tile.file)) {
+            std::cerr << "[TiledCloud::open] " << path << " ends after " << tileId << " of " << nTiles << " tiles\n";
+            _tiles.clear();
+            _cells.clear();
+            return false;
+        }
+        _cells[getCellKey(tile.cell)] = static_cast<int>(tileId);
+        _nPoints += tile.count;
+    }
+    return true;
+} //...TiledCloud::open()
+
+std::string TiledCloud::getTilePath(size_t const tileId) const {
+    return _directory + "/" + _tiles.at(tileId).file;
+} //...TiledCloud::getTilePath()
+
+Eigen::Vector3i TiledCloud::getCell(Eigen::Vector3d const& point) const {
+    return getGridCell(point, _tileSize);
+} //...TiledCloud::getCell()
+
+int TiledCloud::findTile(Eigen::Vector3i const& cell) const {
+    auto const it = _cells.find(getCellKey(cell));
+    return it != _cells.end() ? it->second : -1;
+} //...TiledCloud::findTile()
+
+bool
+tileCloudFile(
+    std::string const& input,
+    std::string const& directory,
+    double      const  tileSize,
+    size_t      const  bufferPoints
+) {
+    TileWriter writer(directory, tileSize, bufferPoints);
+    std::string const extension = getExtension(input);
+
+    if (extension == "ply") {
+        PlyReader reader;
+        bool writeOk = true;
+        bool const readOk = reader.open(input)
+                         && reader.read([&](PlyVertexChunk const& chunk) { writeOk = writer.addPoints(chunk.vertices) && writeOk; });
+        if (!readOk || !writeOk)
+            return false;
+    } else if (extension == "acqc") {
+        // Mapped, the pages of a slice can be dropped once it was sorted
+        CloudFile file(input);
+        if (!file.isOpen())
+            return false;
+        CloudFile::VerticesMapT const vertices = file.getVertices();
+        Eigen::Index const sliceSize = Eigen::Index(1) << 20;
+        for (Eigen::Index first = 0; first < vertices.rows(); first += sliceSize)
+            if (!writer.addPoints(vertices.middleRows(first, std::min(sliceSize, vertices.rows() - first))))
+                return false;
+    } else {
+        DecoratedCloud cloud;
+        if (!readMesh(input, cloud) || !writer.addPoints(cloud.getVertices()))
+            return false;
+    }
+
+    return writer.finish();
+} //...tileCloudFile()
+
+} //...ns acq